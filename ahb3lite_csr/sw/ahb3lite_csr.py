@@ -364,7 +364,8 @@ class CSRGen:
             files = [{file     : {'file_type' : 'verilogSource'}},
                      {file[:-2]+'vh' : {'is_include_file' : True,
                                         'file_type' : 'verilogSource'}},
-                     {file[:-2]+'h' : {'file_type' : 'user', 'copyto' : file[:-2]+'h'}}
+                     {file[:-2]+'h' : {'file_type' : 'user', 'copyto' : file[:-2]+'h'}},
+                     {file[:-2]+'hpp' : {'file_type' : 'user', 'copyto' : file[:-2]+'hpp'}}
             ]
             coredata = {'name' : vlnv,
                         'targets' : {'default' : {}},
@@ -378,6 +379,9 @@ class CSRGen:
         # Write CPP header
         self.cppwriter.write (file[:-2]+'h')
 
+        # Write typed C++ field header
+        self.cppwriter.write_fields (file[:-2]+'hpp')
+
 if __name__ == "__main__":
     if len(sys.argv) == 4:
       name = sys.argv[3]
@@ -13,6 +13,175 @@ from ahb3lite_csr import Field, Reg
 #class FieldIter:
 #    def __init__(self):
 #        self.
+
+# Field templates shared by all generated .hpp headers
+CSR_TEMPLATES = '''#ifndef CSR_FIELD_TEMPLATES
+#define CSR_FIELD_TEMPLATES
+
+namespace csr {
+
+enum access_t { RW, RO, WO, W1C };
+
+// Compile time field descriptor, REGBITS covers every field in the register
+template <uint32_t OFF, uint32_t SHT, uint32_t WIDTH, access_t TYPE, uint32_t REGBITS, bool STROBE=false>
+struct field {
+	static constexpr uint32_t off = OFF;
+	static constexpr uint32_t sht = SHT;
+	static constexpr uint32_t msk = (WIDTH == 32) ? 0xffffffff : ((1u << WIDTH) - 1);
+	static constexpr uint32_t bits = msk << SHT;
+	static constexpr access_t type = TYPE;
+	static constexpr uint32_t regbits = REGBITS;
+	static constexpr bool strobe = STROBE;
+
+	// Host written rw fields without access side effects can be shadowed
+	static constexpr bool cached = (TYPE == RW) && !STROBE;
+
+	// Value when used in a coalesced write
+	uint32_t val;
+	constexpr field (uint32_t val) : val (val) {}
+};
+
+// Fields merged into a single register write
+template <typename... F> struct fields;
+template <typename F>
+struct fields<F> {
+	static constexpr uint32_t off = F::off;
+	static constexpr uint32_t bits = F::bits;
+	static constexpr access_t type = F::type;
+	static constexpr uint32_t regbits = F::regbits;
+	static constexpr bool cached = F::cached;
+	static uint32_t pack (F f) { return (f.val & F::msk) << F::sht; }
+};
+template <typename F, typename... R>
+struct fields<F, R...> {
+	static_assert (F::off == fields<R...>::off, "Coalesced fields must share a register");
+	static_assert ((F::bits & fields<R...>::bits) == 0, "Field repeated in write");
+	static constexpr uint32_t off = F::off;
+	static constexpr uint32_t bits = F::bits | fields<R...>::bits;
+	static constexpr access_t type = F::type;
+	static constexpr uint32_t regbits = F::regbits;
+	static constexpr bool cached = F::cached;
+	static uint32_t pack (F f, R... r) { return ((f.val & F::msk) << F::sht) | fields<R...>::pack (r...); }
+};
+
+// Bus access through the same callbacks as the generated host class
+class bus {
+  protected:
+	uint32_t (*rd)(uint32_t);
+	void (*wr)(uint32_t, uint32_t);
+	uint32_t base;
+  public:
+	bus (uint32_t base, uint32_t (*rd)(uint32_t), void (*wr)(uint32_t, uint32_t)) :
+		rd (rd), wr (wr), base (base) {}
+
+	template <typename F> uint32_t read (void) {
+		static_assert (F::type != WO, "Field is write only");
+		return (rd (base + F::off) >> F::sht) & F::msk;
+	}
+
+	// One bus write for all fields, only rw registers with other fields are read first
+	template <typename... F> void write (F... f) {
+		typedef fields<F...> R;
+		static_assert (R::type != RO, "Field is read only");
+		uint32_t val = R::pack (f...);
+		if ((R::type == RW) && (R::bits != R::regbits))
+			val |= rd (base + R::off) & ~R::bits;
+		wr (base + R::off, val);
+	}
+	template <typename F> void write (uint32_t val) { write (F (val)); }
+
+	// Nothing held back
+	void flush (void) {}
+	void invalidate (void) {}
+};
+
+// Write-back shadow of rw registers. Cached fields are read from
+// hardware once and written back by flush() in one batch, sync is
+// called after each batch (ie HostMaster::Flush). ro/w1c reads and
+// wo/w1c/strobe writes always reach hardware, dirty registers are
+// flushed first to keep bus order. Hardware updates to rw fields are
+// not seen until invalidate().
+template <unsigned NREGS>
+class shadow : public bus {
+  private:
+	uint32_t val[NREGS];
+	bool valid[NREGS], dirty[NREGS];
+	void (*sync)(void);
+
+	unsigned writeback (void) {
+		unsigned i, n = 0;
+		for (i = 0; i < NREGS; i++)
+			if (dirty[i]) {
+				wr (base + (i * 4), val[i]);
+				dirty[i] = false;
+				n++;
+			}
+		writebacks += n;
+		return n;
+	}
+  public:
+	uint64_t hits, misses, writebacks;
+
+	shadow (uint32_t base, uint32_t (*rd)(uint32_t), void (*wr)(uint32_t, uint32_t), void (*sync)(void)=NULL) :
+		bus (base, rd, wr), sync (sync), hits (0), misses (0), writebacks (0) {
+		for (unsigned i = 0; i < NREGS; i++)
+			valid[i] = dirty[i] = false;
+	}
+
+	template <typename F> uint32_t read (void) {
+		static_assert (F::type != WO, "Field is write only");
+		if (!F::cached)
+			return bus::read<F> ();
+		if (valid[F::off / 4])
+			hits++;
+		else {
+			val[F::off / 4] = rd (base + F::off);
+			valid[F::off / 4] = true;
+			misses++;
+		}
+		return (val[F::off / 4] >> F::sht) & F::msk;
+	}
+
+	template <typename... F> void write (F... f) {
+		typedef fields<F...> R;
+		static_assert (R::type != RO, "Field is read only");
+		if (!R::cached) {
+			writeback ();
+			bus::write (f...);
+			if (sync)
+				sync ();
+			return;
+		}
+
+		// Other fields must be known before merging
+		if (!valid[R::off / 4] && (R::bits != R::regbits)) {
+			val[R::off / 4] = rd (base + R::off);
+			misses++;
+		}
+		val[R::off / 4] = (val[R::off / 4] & ~R::bits) | R::pack (f...);
+		valid[R::off / 4] = dirty[R::off / 4] = true;
+	}
+	template <typename F> void write (uint32_t val) { write (F (val)); }
+
+	// Write back dirty registers in one batch
+	void flush (void) {
+		if (writeback () && sync)
+			sync ();
+	}
+
+	// Write back then reload everything on next access
+	void invalidate (void) {
+		flush ();
+		for (unsigned i = 0; i < NREGS; i++)
+			valid[i] = false;
+	}
+};
+
+} /* namespace csr */
+
+#endif /* CSR_FIELD_TEMPLATES */
+'''
+
 class CPPWriter:
     def __init__(self, name, field):
         self.name = name
@@ -158,4 +327,61 @@ class CPPWriter:
 
             # Write footer
             fh.write (self.footer (cid))
-            
+
+    def write_fields(self, filename):
+        cid = filename.replace ('.', '_').upper ()
+        access = {'rw' : 'csr::RW', 'ro' : 'csr::RO', 'wo' : 'csr::WO', 'w1c' : 'csr::W1C'}
+
+        # Same CRC as the crc32 register, bits used per register
+        crc = 0
+        regbits = {}
+        for f in self.field:
+            crc = zlib.crc32 (str(f).encode('ascii'), crc) & 0xffffffff
+            for r in f.rptr:
+                regbits[r.reg.address] = regbits.get (r.reg.address, 0) | ((2 ** f.width - 1) << r.offset)
+
+        def desc (f, off, sht):
+            return ('csr::field<' + off + ', ' + sht + ', ' + str(f.width) + ', ' + access[f.rtype] +
+                    ', ' + hex (regbits[f.rptr[0].reg.address]) + ', ' + str(f.strobe).lower() + '>')
+
+        with open (filename, 'w') as fh:
+            s =  '// This file is autogenerated by csrgen - DO NOT EDIT\n'
+            s += '#ifndef ' + cid + '\n'
+            s += '#define ' + cid + '\n'
+            s += '#include <stdint.h>\n'
+            s += '#include <stddef.h>\n\n'
+            s += CSR_TEMPLATES + '\n'
+
+            # Register class with field descriptors
+            s += 'template <class BUS>\n'
+            s += 'class ' + self.name + '_regs : public BUS {\n'
+            s += '  public:\n'
+            s += '\tstatic constexpr uint32_t crc = ' + hex (crc) + ';\n'
+            s += '\tstatic constexpr uint32_t regs = ' + str(len (regbits)) + ';\n\n'
+            for f in self.field:
+                if f.count == 1:
+                    s += '\ttypedef ' + desc (f, str(f.rptr[0].reg.address), str(f.rptr[0].offset)) + ' ' + f.name + ';\n'
+                else:
+                    # Indexed fields look up register and shift per index
+                    s += '\tstatic constexpr uint32_t ' + f.name + '_off[' + str(f.count) + '] = {'
+                    s += ', '.join ([str(r.reg.address) for r in f.rptr]) + '};\n'
+                    s += '\tstatic constexpr uint32_t ' + f.name + '_sht[' + str(f.count) + '] = {'
+                    s += ', '.join ([str(r.offset) for r in f.rptr]) + '};\n'
+                    s += '\tstatic constexpr uint32_t ' + f.name + '_reg[' + str(f.count) + '] = {'
+                    s += ', '.join ([hex (regbits[r.reg.address]) for r in f.rptr]) + '};\n'
+                    s += '\ttemplate <unsigned N> using ' + f.name + ' = '
+                    s += ('csr::field<' + f.name + '_off[N], ' + f.name + '_sht[N], ' + str(f.width) + ', ' +
+                          access[f.rtype] + ', ' + f.name + '_reg[N], ' + str(f.strobe).lower() + '>;\n')
+            s += '\n'
+            s += '\ttemplate <typename... A> ' + self.name + '_regs (A... a) : BUS (a...) {}\n\n'
+            s += '\t// Call once after connecting - false if SV and header differ\n'
+            s += '\tbool connect (void) {\n'
+            s += '\t\tthis->invalidate ();\n'
+            s += '\t\treturn this->template read<crc32> () == crc;\n'
+            s += '\t}\n'
+            s += '};\n\n'
+            s += '// Direct and write-back cached access\n'
+            s += 'typedef ' + self.name + '_regs<csr::bus> ' + self.name + '_csr;\n'
+            s += 'typedef ' + self.name + '_regs<csr::shadow<' + str(len (regbits)) + '>> ' + self.name + '_shadow;\n\n'
+            s += '#endif /* ' + cid + ' */\n'
+            fh.write (s)
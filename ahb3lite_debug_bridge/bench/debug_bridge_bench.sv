@@ -0,0 +1,146 @@
+/**
+ *  Bench wrapper - ahb3lite_debug_bridge in front of adiv5_mux. The
+ *  AHB master and IRQ FIFOs are driven by the C++ bench. The ADIv5
+ *  FIFO is shared with the bench for link setup while the bridge is
+ *  disabled.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+import adiv5_pkg::*;
+
+module debug_bridge_bench
+  #(parameter READ_WINDOW = 4,
+    parameter IRQ_BATCH = 3)
+  (
+   // System and PHY clock
+   input                               CLK,
+   input                               RESETn,
+   input                               PHY_CLK,
+   input                               PHY_CLKn,
+   // Select interface
+   input                               JTAGnSWD,
+   // Bridge control
+   input                               ENABLE,
+   input                               SEQ,
+   input [$clog2 (READ_WINDOW)-1:0]    PREFETCH,
+   output [2:0]                        STAT,
+   output [2:0] [31:0]                 SKIPCNT,
+   // IRQ scan
+   input                               IRQSCAN,
+   input [31:0]                        IRQBASE,
+   input [15:0]                        IRQ_PERIOD,
+   output [31:0]                       IRQCNT,
+   output [2:0] [31:0]                 IRQLAT,
+   output [7:0]                        IRQ_WRDATA,
+   output                              IRQ_WREN,
+   input [7:0]                         IRQ_RDDATA,
+   input                               IRQ_RDEMPTY,
+   output                              IRQ_RDEN,
+   // Bench ADIv5 FIFO interface, bridge disabled
+   input [ADIv5_CMD_WIDTH-1:0]         ADIv5_WRDATA,
+   input                               ADIv5_WREN,
+   output                              ADIv5_WRFULL,
+   output [ADIv5_RESP_WIDTH-1:0]       ADIv5_RDDATA,
+   input                               ADIv5_RDEN,
+   output                              ADIv5_RDEMPTY,
+   // AHB master
+   input                               HSEL,
+   input                               HWRITE,
+   input [1:0]                         HTRANS,
+   input [2:0]                         HSIZE,
+   input [31:0]                        HADDR,
+   input [2:0]                         HBURST,
+   input [31:0]                        HWDATA,
+   output                              HREADYOUT,
+   output [31:0]                       HRDATA,
+   output                              HRESP,
+   // PHY signals
+   output                              TCK,
+   output                              TDI,
+   output                              TMSOUT,
+   output                              TMSOE,
+   input                               TMSIN,
+   input                               TDO
+   );
+
+   // Bridge side of ADIv5 FIFO
+   logic [ADIv5_CMD_WIDTH-1:0]         brg_WRDATA;
+   logic                               brg_WREN, brg_RDEN;
+
+   // Shared ADIv5 FIFO
+   logic [ADIv5_CMD_WIDTH-1:0]         adiv5_WRDATA;
+   logic                               adiv5_WREN, adiv5_RDEN, adiv5_RDEMPTY;
+
+   // Bridge owns the FIFO once enabled
+   assign adiv5_WRDATA = ENABLE ? brg_WRDATA : ADIv5_WRDATA;
+   assign adiv5_WREN = ENABLE ? brg_WREN : ADIv5_WREN;
+   assign adiv5_RDEN = ENABLE ? brg_RDEN : ADIv5_RDEN;
+   assign ADIv5_RDEMPTY = adiv5_RDEMPTY | ENABLE;
+
+   ahb3lite_debug_bridge
+     #(.READ_WINDOW (READ_WINDOW),
+       .IRQ_BATCH   (IRQ_BATCH))
+   u_bridge (
+             .CLK           (CLK),
+             .RESETn        (RESETn),
+             .ENABLE        (ENABLE),
+             .SEQ           (SEQ),
+             .PREFETCH      (PREFETCH),
+             .STAT          (STAT),
+             .APSEL         (8'h0),
+             .IRQSCAN       (IRQSCAN),
+             .IRQBASE       (IRQBASE),
+             .IRQCNT        (IRQCNT),
+             .IRQ_PERIOD    (IRQ_PERIOD),
+             .IRQLAT        (IRQLAT),
+             .SKIPCNT       (SKIPCNT),
+             .HREADY        (HREADYOUT),
+             .HWRITE        (HWRITE),
+             .HSEL          (HSEL),
+             .HTRANS        (HTRANS),
+             .HSIZE         (HSIZE),
+             .HADDR         (HADDR),
+             .HBURST        (HBURST),
+             .HPROT         (4'h3),
+             .HWDATA        (HWDATA),
+             .HREADYOUT     (HREADYOUT),
+             .HRDATA        (HRDATA),
+             .HRESP         (HRESP),
+             .ADIv5_WRDATA  (brg_WRDATA),
+             .ADIv5_WREN    (brg_WREN),
+             .ADIv5_WRFULL  (ADIv5_WRFULL),
+             .ADIv5_RDDATA  (ADIv5_RDDATA),
+             .ADIv5_RDEN    (brg_RDEN),
+             .ADIv5_RDEMPTY (adiv5_RDEMPTY | !ENABLE),
+             .IRQ_WRDATA    (IRQ_WRDATA),
+             .IRQ_WREN      (IRQ_WREN),
+             .IRQ_WRFULL    (1'b0),
+             .IRQ_RDDATA    (IRQ_RDDATA),
+             .IRQ_RDEMPTY   (IRQ_RDEMPTY),
+             .IRQ_RDEN      (IRQ_RDEN)
+             );
+
+   adiv5_mux u_adiv5_mux (
+                          .CLK           (CLK),
+                          .SYS_RESETn    (RESETn),
+                          .PHY_CLK       (PHY_CLK),
+                          .PHY_CLKn      (PHY_CLKn),
+                          .PHY_RESETn    (RESETn),
+                          .JTAGnSWD      (JTAGnSWD),
+                          .ADIv5_WRDATA  (adiv5_WRDATA),
+                          .ADIv5_WREN    (adiv5_WREN),
+                          .ADIv5_WRFULL  (ADIv5_WRFULL),
+                          .ADIv5_RDDATA  (ADIv5_RDDATA),
+                          .ADIv5_RDEN    (adiv5_RDEN),
+                          .ADIv5_RDEMPTY (adiv5_RDEMPTY),
+                          .TCK           (TCK),
+                          .TDI           (TDI),
+                          .TMSOUT        (TMSOUT),
+                          .TMSOE         (TMSOE),
+                          .TMSIN         (TMSIN),
+                          .TDO           (TDO)
+                          );
+
+endmodule // debug_bridge_bench
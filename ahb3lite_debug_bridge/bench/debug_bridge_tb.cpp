@@ -0,0 +1,376 @@
+/**
+ *  Verilator bench on top of debug_bridge_bench.sv - memcpy style
+ *  remote reads through ahb3lite_debug_bridge against the ADIv5 target
+ *  model. Reports cycles per word for single reads, single reads with
+ *  prefetch and INCR4 bursts, against direct FIFO block reads as the
+ *  PHY bound, and the setup writes skipped by the bridge.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <signal.h>
+#include <argp.h>
+#include <verilator_utils.h>
+#include <ADIv5Driver.h>
+#include <err.h>
+
+#include "Vdebug_bridge_bench.h"
+
+#define RESET_TIME   10
+static bool done = false;
+
+// Defaults
+#define BENCH_WORDS     256
+#define BENCH_ADDR      0x20000200
+#define BENCH_GAP       2
+#define BENCH_PREFETCH  3
+
+// Long options, short keys taken by verilator_utils
+#define OPT_GAP         600
+#define OPT_SWD         601
+
+// Bridge init after enable
+#define INIT_CYCLES     2000
+
+// AHB3
+#define HTRANS_IDLE     0
+#define HTRANS_NONSEQ   2
+#define HTRANS_SEQ      3
+#define HBURST_SINGLE   0
+#define HBURST_INCR4    3
+#define HSIZE_WORD      2
+
+static void INTHandler (int signal)
+{
+  printf("\nCaught ctrl-c\n");
+  done = true;
+}
+
+// Read modes
+enum {
+  MODE_PHY,
+  MODE_SINGLE,
+  MODE_PREFETCH,
+  MODE_INCR4,
+  MODE_CNT
+};
+static const char *mode_name[MODE_CNT] = { "phy", "single", "prefetch", "incr4" };
+
+class debug_bridge_tb : public VerilatorUtils {
+
+private:
+  bool _doCycle (void);
+
+public:
+  Vdebug_bridge_bench *top;
+  debug_bridge_tb ();
+  ~debug_bridge_tb ();
+  bool doCycle (void);
+
+  // Link setup while bridge is disabled
+  ADIv5Driver<debug_bridge_tb> *adiv5;
+
+  // Options
+  int words, gap, prefetch;
+  bool swd;
+
+  int Setup (void);
+  void Enable (bool en);
+  int Burst (bool write, uint32_t addr, uint32_t *data, int cnt);
+  int Transfer (bool write, uint32_t addr, uint32_t *data, bool burst);
+  int Measure (int mode, const uint32_t *out, double *cpw);
+  void Skipped (const uint32_t *start);
+};
+
+static int parse_opt (int key, char *arg, struct argp_state *state)
+{
+  debug_bridge_tb *tb = (debug_bridge_tb *)state->input;
+
+  switch (key) {
+    case ARGP_KEY_INIT:
+      state->child_inputs[0] = state->input;
+      break;
+    case 'w':
+      tb->words = strtol (arg, NULL, 0) & ~3;
+      break;
+    case OPT_GAP:
+      tb->gap = strtol (arg, NULL, 0);
+      break;
+    case 'p':
+      tb->prefetch = strtol (arg, NULL, 0);
+      break;
+    case OPT_SWD:
+      tb->swd = true;
+      break;
+  }
+  return 0;
+}
+
+static int parse_args (int argc, char **argv, debug_bridge_tb *tb)
+{
+  struct argp_option options[] =
+    {
+     { "words", 'w', "CNT", 0, "Words per block, multiple of 4" },
+     { "gap", OPT_GAP, "CYCLES", 0, "Idle cycles between transfers (memcpy store)" },
+     { "prefetch", 'p', "WORDS", 0, "Read-ahead depth for prefetch mode" },
+     { "swd", OPT_SWD, 0, 0, "Use SWD instead of JTAG" },
+     { 0 }
+  };
+  struct argp_child child_parsers[] =
+    {
+     { &verilator_utils_argp, 0, "", 0 },
+     { 0 }
+  };
+  struct argp argp = { options, parse_opt, 0, 0, child_parsers };
+  return argp_parse (&argp, argc, argv, 0, 0, tb);
+}
+
+debug_bridge_tb::debug_bridge_tb (void) : VerilatorUtils (NULL)
+{
+  top = new Vdebug_bridge_bench;
+  ADIv5Pins<> pins = { &top->ADIv5_WRDATA, &top->ADIv5_WREN, &top->ADIv5_WRFULL,
+                       &top->ADIv5_RDDATA, &top->ADIv5_RDEN, &top->ADIv5_RDEMPTY };
+  adiv5 = new ADIv5Driver<debug_bridge_tb> (this, pins);
+  words = BENCH_WORDS;
+  gap = BENCH_GAP;
+  prefetch = BENCH_PREFETCH;
+  swd = false;
+
+  // No IRQ scan, no host ACKs
+  top->IRQ_RDEMPTY = 1;
+
+  // Enable trace
+  top->trace (tfp, 99);
+}
+
+debug_bridge_tb::~debug_bridge_tb ()
+{
+  delete adiv5;
+  delete top;
+}
+
+bool debug_bridge_tb::_doCycle (void)
+{
+  // Call base function
+  if (!VerilatorUtils::doCycle() || done)
+    exit (-1);
+
+  // Control reset
+  if (getTime () > RESET_TIME)
+    top->RESETn = 1;
+  else
+    top->RESETn = 0;
+
+  // Eval
+  top->eval ();
+
+  // Flip clocks
+  top->CLK = !top->CLK;
+  top->PHY_CLK = !top->PHY_CLK;
+  top->PHY_CLKn = !top->PHY_CLK;
+
+  // Call JTAG client function
+  doJTAGClient (top->TCK, &top->TDO, top->TDI, top->TMSOE ? &top->TMSOUT : &top->TMSIN, top->TMSOE);
+
+  // Continue
+  return true;
+}
+
+bool debug_bridge_tb::doCycle (void)
+{
+  // Two half cycles
+  if (!_doCycle ()) return false;
+  return _doCycle ();
+}
+
+int debug_bridge_tb::Setup (void)
+{
+  int i;
+
+  top->JTAGnSWD = !swd;
+  doCycle ();
+
+  // Reset and switch protocol
+  adiv5->Reset ();
+  adiv5->Switch ();
+  if (adiv5->DPRead (DP_IDCODE) == 0)
+    return -1;
+
+  // Enable AP/DBGPWR
+  adiv5->DPWrite (DP_CTRL_STAT, 0x50000000);
+  for (i = 0; i < 100; i++)
+    if ((adiv5->DPRead (DP_CTRL_STAT) & 0xf0000000) == 0xf0000000)
+      break;
+
+  // Halt core, bridge inherits CSW
+  adiv5->APWrite (0, AP_CSW, CSW_DEFAULT | CSW_SIZE32);
+  adiv5->APWrite (0, AP_TAR, 0xE000EDF0);
+  adiv5->APWrite (0, AP_DRW, 0xA05F0003);
+  return (adiv5->Sync () == SWJ_OK) ? 0 : -1;
+}
+
+void debug_bridge_tb::Enable (bool en)
+{
+  int i;
+
+  // Bridge caches SELECT/CSW on enable
+  top->SEQ = 1;
+  top->ENABLE = en;
+  for (i = 0; i < INIT_CYCLES; i++)
+    doCycle ();
+  adiv5->Invalidate ();
+}
+
+// Beats back to back, next address phase overlaps data phase
+int debug_bridge_tb::Burst (bool write, uint32_t addr, uint32_t *data, int cnt)
+{
+  int i, err = 0;
+  bool rdy;
+
+  for (i = 0; i <= cnt; i++) {
+
+    // Address phase, IDLE after last beat
+    if (i < cnt) {
+      top->HSEL = 1;
+      top->HWRITE = write;
+      top->HSIZE = HSIZE_WORD;
+      top->HADDR = addr + (i * 4);
+      top->HBURST = (cnt == 4) ? HBURST_INCR4 : HBURST_SINGLE;
+      top->HTRANS = i ? HTRANS_SEQ : HTRANS_NONSEQ;
+    }
+    else
+      top->HTRANS = HTRANS_IDLE;
+
+    // Previous data phase completes on HREADY
+    do {
+      rdy = top->HREADYOUT;
+      if (rdy && i) {
+        if (!write)
+          data[i - 1] = top->HRDATA;
+        err |= top->HRESP;
+      }
+      doCycle ();
+    } while (!rdy);
+
+    // Write data follows address
+    if (write && (i < cnt))
+      top->HWDATA = data[i];
+  }
+  top->HSEL = 0;
+  return err;
+}
+
+int debug_bridge_tb::Transfer (bool write, uint32_t addr, uint32_t *data, bool burst)
+{
+  int i, j, n = burst ? 4 : 1, err = 0;
+
+  for (i = 0; i < words; i += n) {
+    err |= Burst (write, addr + (i * 4), &data[i], n);
+
+    // Local store and loop overhead
+    for (j = 0; j < gap; j++)
+      doCycle ();
+  }
+  return err;
+}
+
+// Setup writes skipped since start - SELECT/CSW/TAR
+void debug_bridge_tb::Skipped (const uint32_t *start)
+{
+  printf ("%8s skipped: sel %u csw %u tar %u\n", "",
+          top->SKIPCNT[0] - start[0], top->SKIPCNT[1] - start[1], top->SKIPCNT[2] - start[2]);
+}
+
+int debug_bridge_tb::Measure (int mode, const uint32_t *out, double *cpw)
+{
+  uint32_t *in = new uint32_t[words];
+  uint32_t skip[3];
+  uint64_t start, cycles;
+  int i, err = 0;
+
+  for (i = 0; i < words; i++)
+    in[i] = 0;
+
+  // Two ticks per cycle
+  top->PREFETCH = (mode == MODE_PREFETCH) ? prefetch : 0;
+  for (i = 0; i < 3; i++)
+    skip[i] = top->SKIPCNT[i];
+  start = getTime ();
+  if (mode == MODE_PHY)
+    err |= adiv5->MemReadBlock (0, BENCH_ADDR, in, words) != SWJ_OK;
+  else
+    err |= Transfer (false, BENCH_ADDR, in, mode == MODE_INCR4);
+  cycles = (getTime () - start) / 2;
+  *cpw = (double)cycles / words;
+
+  for (i = 0; i < words; i++)
+    if (in[i] != out[i]) {
+      printf ("Mismatch @ %08X: %08X != %08X\n", BENCH_ADDR + (i * 4), in[i], out[i]);
+      err = 1;
+      break;
+    }
+  printf ("%-8s read %8lu cycles %7.2f cycles/word%s\n", mode_name[mode],
+          (unsigned long)cycles, *cpw, err ? " FAILED" : "");
+  if (mode != MODE_PHY)
+    Skipped (skip);
+  delete[] in;
+  return err;
+}
+
+int main (int argc, char **argv)
+{
+  int i, fails = 0;
+  uint32_t *out, skip[3];
+  uint64_t start, cycles;
+  double cpw[MODE_CNT];
+  debug_bridge_tb *dut = new debug_bridge_tb;
+
+  // Parse args
+  parse_args (argc, argv, dut);
+
+  // Setup interrupt handler
+  signal (SIGINT, &INTHandler);
+
+  // Run through reset
+  for (i = 0; i < RESET_TIME * 2; i++)
+    dut->doCycle ();
+  if (dut->Setup ())
+    fail ("%s: no connection", dut->swd ? "SWD" : "JTAG");
+
+  out = new uint32_t[dut->words];
+  for (i = 0; i < dut->words; i++)
+    out[i] = 0x9e3779b9 * (i + 1);
+
+  // Direct FIFO block read is the PHY bound
+  fails += dut->adiv5->MemWriteBlock (0, BENCH_ADDR, out, dut->words) != SWJ_OK;
+  fails += dut->Measure (MODE_PHY, out, &cpw[MODE_PHY]);
+
+  // Posted writes through the bridge
+  dut->Enable (true);
+  for (i = 0; i < dut->words; i++)
+    out[i] ^= 0x5a5a5a5a;
+  for (i = 0; i < 3; i++)
+    skip[i] = dut->top->SKIPCNT[i];
+  start = dut->getTime ();
+  fails += dut->Transfer (true, BENCH_ADDR, out, false);
+  cycles = (dut->getTime () - start) / 2;
+  printf ("%-8s write %7lu cycles %7.2f cycles/word\n", "posted",
+          (unsigned long)cycles, (double)cycles / dut->words);
+  dut->Skipped (skip);
+
+  for (i = MODE_SINGLE; i < MODE_CNT; i++)
+    fails += dut->Measure (i, out, &cpw[i]);
+  for (i = MODE_PREFETCH; i < MODE_CNT; i++)
+    printf ("%s speedup: %.2fx (%.0f%% of PHY bound)\n", mode_name[i],
+            cpw[MODE_SINGLE] / cpw[i], 100.0 * cpw[MODE_PHY] / cpw[i]);
+  if (dut->top->STAT != SWJ_OK)
+    fails++;
+  printf ("%s\n", fails ? "FAILED" : "PASSED");
+
+  // Done
+  delete[] out;
+  delete dut;
+  return fails ? -1 : 0;
+}
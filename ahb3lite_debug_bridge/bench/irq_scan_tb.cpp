@@ -0,0 +1,468 @@
+/**
+ *  Verilator bench on top of debug_bridge_bench.sv - IRQ forwarding
+ *  latency through the ahb3lite_debug_bridge IRQ scan. The bench plays
+ *  the target firmware, posting IRQ records through the ADIv5 model
+ *  backdoor, and the host, ACKing IRQs from the FIFO. Reports cycles
+ *  from record posted to IRQ in the FIFO with AHB idle, and under
+ *  AHB read load with and without IRQ_PERIOD.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <signal.h>
+#include <argp.h>
+#include <deque>
+#include <verilator_utils.h>
+#include <ADIv5Driver.h>
+#include <err.h>
+
+#include "Vdebug_bridge_bench.h"
+
+#define RESET_TIME   10
+static bool done = false;
+
+// Defaults
+#define BENCH_IRQS      32
+#define BENCH_INTERVAL  4000
+#define BENCH_PERIOD    1000
+#define BENCH_GAP       2
+#define BENCH_CYCLES    1000000
+#define BENCH_ADDR      0x20000200
+#define BENCH_WORDS     64
+
+// Long options, short keys taken by verilator_utils
+#define OPT_GAP         600
+#define OPT_SWD         601
+
+// Record block, BD1 is the ACK word
+#define IRQ_BASE        0x20001000
+#define IRQ_ACK         (IRQ_BASE + 4)
+
+// Matches bench wrapper
+#define IRQ_BATCH       3
+
+// D1 header {0001, record[1], lane, record[0]}
+#define IRQ_HDR(c)      (((c) & 0xf0) == 0x10)
+#define IRQ_REC(hdr)    ((((hdr) >> 2) & 2) | ((hdr) & 1))
+
+// Bridge init after enable
+#define INIT_CYCLES     2000
+
+// AHB3
+#define HTRANS_IDLE     0
+#define HTRANS_NONSEQ   2
+#define HBURST_SINGLE   0
+#define HSIZE_WORD      2
+
+static void INTHandler (int signal)
+{
+  printf("\nCaught ctrl-c\n");
+  done = true;
+}
+
+// AHB load
+enum {
+  MODE_IDLE,
+  MODE_LOAD,
+  MODE_PERIOD,
+  MODE_CNT
+};
+static const char *mode_name[MODE_CNT] = { "idle", "load", "period" };
+
+// Records at BD0, BD2, BD3
+static uint32_t rec_addr (int rec)
+{
+  return IRQ_BASE + (rec ? (rec + 1) * 4 : 0);
+}
+
+class irq_scan_tb : public VerilatorUtils {
+
+private:
+  bool _doCycle (void);
+  void Firmware (void);
+
+  // Firmware model
+  uint64_t posted[IRQ_BATCH], next;
+  uint32_t rng;
+  uint8_t irq;
+
+  // Host model
+  std::deque<uint8_t> acks;
+  uint8_t hdr;
+  bool in_irq;
+
+public:
+  Vdebug_bridge_bench *top;
+  irq_scan_tb ();
+  ~irq_scan_tb ();
+  bool doCycle (void);
+
+  // Link setup while bridge is disabled
+  ADIv5Driver<irq_scan_tb> *adiv5;
+
+  // Options
+  int irqs, interval, period, gap, cycles;
+  bool swd;
+
+  // Stats
+  uint64_t cycle, lat_sum, lat_min, lat_max;
+  int sent, recvd, errors;
+  bool post;
+
+  int Setup (void);
+  void Enable (bool en);
+  int Read (uint32_t addr, uint32_t *data);
+  int Measure (int mode, const uint32_t *out);
+};
+
+static int parse_opt (int key, char *arg, struct argp_state *state)
+{
+  irq_scan_tb *tb = (irq_scan_tb *)state->input;
+
+  switch (key) {
+    case ARGP_KEY_INIT:
+      state->child_inputs[0] = state->input;
+      break;
+    case 'n':
+      tb->irqs = strtol (arg, NULL, 0);
+      break;
+    case 'i':
+      tb->interval = strtol (arg, NULL, 0);
+      break;
+    case 'p':
+      tb->period = strtol (arg, NULL, 0);
+      break;
+    case OPT_GAP:
+      tb->gap = strtol (arg, NULL, 0);
+      break;
+    case 'c':
+      tb->cycles = strtol (arg, NULL, 0);
+      break;
+    case OPT_SWD:
+      tb->swd = true;
+      break;
+  }
+  return 0;
+}
+
+static int parse_args (int argc, char **argv, irq_scan_tb *tb)
+{
+  struct argp_option options[] =
+    {
+     { "irqs", 'n', "CNT", 0, "IRQs posted per mode" },
+     { "interval", 'i', "CYCLES", 0, "Mean cycles between IRQs" },
+     { "period", 'p', "CYCLES", 0, "IRQ_PERIOD for period mode" },
+     { "gap", OPT_GAP, "CYCLES", 0, "Idle cycles between AHB reads" },
+     { "cycles", 'c', "CYCLES", 0, "Give up on a mode after" },
+     { "swd", OPT_SWD, 0, 0, "Use SWD instead of JTAG" },
+     { 0 }
+  };
+  struct argp_child child_parsers[] =
+    {
+     { &verilator_utils_argp, 0, "", 0 },
+     { 0 }
+  };
+  struct argp argp = { options, parse_opt, 0, 0, child_parsers };
+  return argp_parse (&argp, argc, argv, 0, 0, tb);
+}
+
+irq_scan_tb::irq_scan_tb (void) : VerilatorUtils (NULL)
+{
+  int i;
+
+  top = new Vdebug_bridge_bench;
+  ADIv5Pins<> pins = { &top->ADIv5_WRDATA, &top->ADIv5_WREN, &top->ADIv5_WRFULL,
+                       &top->ADIv5_RDDATA, &top->ADIv5_RDEN, &top->ADIv5_RDEMPTY };
+  adiv5 = new ADIv5Driver<irq_scan_tb> (this, pins);
+  irqs = BENCH_IRQS;
+  interval = BENCH_INTERVAL;
+  period = BENCH_PERIOD;
+  gap = BENCH_GAP;
+  cycles = BENCH_CYCLES;
+  swd = false;
+
+  for (i = 0; i < IRQ_BATCH; i++)
+    posted[i] = 0;
+  cycle = next = 0;
+  rng = 1;
+  irq = 1;
+  in_irq = post = false;
+  sent = recvd = errors = 0;
+  top->IRQBASE = IRQ_BASE;
+  top->IRQ_RDEMPTY = 1;
+
+  // Enable trace
+  top->trace (tfp, 99);
+}
+
+irq_scan_tb::~irq_scan_tb ()
+{
+  delete adiv5;
+  delete top;
+}
+
+bool irq_scan_tb::_doCycle (void)
+{
+  // Call base function
+  if (!VerilatorUtils::doCycle() || done)
+    exit (-1);
+
+  // Control reset
+  if (getTime () > RESET_TIME)
+    top->RESETn = 1;
+  else
+    top->RESETn = 0;
+
+  // Eval
+  top->eval ();
+
+  // Flip clocks
+  top->CLK = !top->CLK;
+  top->PHY_CLK = !top->PHY_CLK;
+  top->PHY_CLKn = !top->PHY_CLK;
+
+  // Call JTAG client function
+  doJTAGClient (top->TCK, &top->TDO, top->TDI, top->TMSOE ? &top->TMSOUT : &top->TMSIN, top->TMSOE);
+
+  // Continue
+  return true;
+}
+
+// Single IRQ per record in lane 1, ACK is bit [record] of lane 0
+void irq_scan_tb::Firmware (void)
+{
+  uint32_t ack = adiv5_target->Read32 (IRQ_ACK);
+  int i;
+
+  for (i = 0; i < IRQ_BATCH; i++) {
+
+    // ACKed - service and reenable
+    if (adiv5_target->Read32 (rec_addr (i))) {
+      if (ack & (1 << i))
+        adiv5_target->Write32 (rec_addr (i), 0);
+    }
+    // Post once bridge cleared the ACK
+    else if (post && (sent < irqs) && (cycle >= next) && !(ack & (1 << i))) {
+      adiv5_target->Write32 (rec_addr (i), irq << 8);
+      posted[i] = cycle;
+      irq = (irq % 255) + 1;
+      sent++;
+
+      // xorshift32
+      rng ^= rng << 13;
+      rng ^= rng >> 17;
+      rng ^= rng << 5;
+      next = cycle + (interval / 2) + (rng % interval);
+    }
+  }
+}
+
+bool irq_scan_tb::doCycle (void)
+{
+  uint64_t lat;
+  bool rden;
+  uint8_t c;
+
+  // Settle before rising edge
+  if (!_doCycle ()) return false;
+
+  // Sample strobes
+  rden = top->IRQ_RDEN && !acks.empty ();
+  if (top->IRQ_WREN) {
+    c = top->IRQ_WRDATA;
+
+    // IRQ follows its header
+    if (in_irq) {
+      lat = cycle - posted[IRQ_REC (hdr)];
+      lat_sum += lat;
+      if (lat < lat_min)
+        lat_min = lat;
+      if (lat > lat_max)
+        lat_max = lat;
+      recvd++;
+      in_irq = false;
+      acks.push_back (hdr);
+    }
+    else if (IRQ_HDR (c)) {
+      hdr = c;
+      in_irq = true;
+    }
+    else
+      errors++;
+  }
+
+  // Rising edge
+  if (!_doCycle ()) return false;
+  cycle++;
+
+  // ACK data valid the cycle after RDEN
+  if (rden) {
+    top->IRQ_RDDATA = acks.front ();
+    acks.pop_front ();
+  }
+  top->IRQ_RDEMPTY = acks.empty ();
+
+  Firmware ();
+  return true;
+}
+
+int irq_scan_tb::Setup (void)
+{
+  int i;
+
+  top->JTAGnSWD = !swd;
+  doCycle ();
+
+  // Reset and switch protocol
+  adiv5->Reset ();
+  adiv5->Switch ();
+  if (adiv5->DPRead (DP_IDCODE) == 0)
+    return -1;
+
+  // Enable AP/DBGPWR
+  adiv5->DPWrite (DP_CTRL_STAT, 0x50000000);
+  for (i = 0; i < 100; i++)
+    if ((adiv5->DPRead (DP_CTRL_STAT) & 0xf0000000) == 0xf0000000)
+      break;
+
+  // Bridge inherits CSW
+  adiv5->APWrite (0, AP_CSW, CSW_DEFAULT | CSW_SIZE32);
+  return (adiv5->Sync () == SWJ_OK) ? 0 : -1;
+}
+
+void irq_scan_tb::Enable (bool en)
+{
+  int i;
+
+  // Bridge caches SELECT/CSW on enable
+  top->SEQ = 1;
+  top->ENABLE = en;
+  for (i = 0; i < INIT_CYCLES; i++)
+    doCycle ();
+  adiv5->Invalidate ();
+}
+
+// Single AHB read
+int irq_scan_tb::Read (uint32_t addr, uint32_t *data)
+{
+  int err;
+
+  top->HSEL = 1;
+  top->HWRITE = 0;
+  top->HSIZE = HSIZE_WORD;
+  top->HADDR = addr;
+  top->HBURST = HBURST_SINGLE;
+  top->HTRANS = HTRANS_NONSEQ;
+  do
+    doCycle ();
+  while (!top->HREADYOUT);
+
+  // Data phase
+  top->HTRANS = HTRANS_IDLE;
+  do
+    doCycle ();
+  while (!top->HREADYOUT);
+  *data = top->HRDATA;
+  err = top->HRESP;
+  top->HSEL = 0;
+  return err;
+}
+
+int irq_scan_tb::Measure (int mode, const uint32_t *out)
+{
+  uint64_t start, scans, gaps, gap_max;
+  uint32_t in;
+  int i, j, err = 0;
+
+  lat_sum = lat_max = 0;
+  lat_min = ~0ULL;
+  sent = recvd = 0;
+  next = cycle;
+  post = true;
+  top->IRQ_PERIOD = (mode == MODE_PERIOD) ? period : 0;
+
+  // IRQLAT - passes, cycles between passes, longest gap
+  scans = top->IRQLAT[0];
+  gaps = top->IRQLAT[1];
+  gap_max = top->IRQLAT[2];
+
+  start = cycle;
+  for (i = 0; (recvd < irqs) && (cycle - start < (uint64_t)cycles); i++) {
+    if (mode == MODE_IDLE)
+      doCycle ();
+
+    // Read loop, gap is the local work per word
+    else {
+      err |= Read (BENCH_ADDR + (i % BENCH_WORDS) * 4, &in);
+      if (in != out[i % BENCH_WORDS])
+        err = 1;
+      for (j = 0; j < gap; j++)
+        doCycle ();
+    }
+  }
+  post = false;
+  scans = top->IRQLAT[0] - scans;
+  gaps = top->IRQLAT[1] - gaps;
+
+  if (recvd)
+    printf ("%-6s %3d/%-3d IRQs latency min %lu avg %.0f max %lu cycles",
+            mode_name[mode], recvd, sent, (unsigned long)lat_min,
+            (double)lat_sum / recvd, (unsigned long)lat_max);
+  else
+    printf ("%-6s %3d/%-3d IRQs", mode_name[mode], recvd, sent);
+  printf (", %lu scans avg gap %.0f max %u cycles%s\n", (unsigned long)scans,
+          scans ? (double)gaps / scans : 0.0,
+          (top->IRQLAT[2] > gap_max) ? top->IRQLAT[2] : (uint32_t)gap_max,
+          err ? " FAILED" : "");
+
+  // Let outstanding IRQs drain with AHB idle
+  top->IRQ_PERIOD = 0;
+  for (i = 0; (recvd < sent) && (i < cycles); i++)
+    doCycle ();
+  return err;
+}
+
+int main (int argc, char **argv)
+{
+  int i, fails = 0;
+  uint32_t out[BENCH_WORDS];
+  irq_scan_tb *dut = new irq_scan_tb;
+
+  // Parse args
+  parse_args (argc, argv, dut);
+
+  // Setup interrupt handler
+  signal (SIGINT, &INTHandler);
+
+  // Run through reset
+  for (i = 0; i < RESET_TIME * 2; i++)
+    dut->doCycle ();
+  if (dut->Setup ())
+    fail ("%s: no connection", dut->swd ? "SWD" : "JTAG");
+
+  // Load data
+  for (i = 0; i < BENCH_WORDS; i++)
+    out[i] = 0x9e3779b9 * (i + 1);
+  fails += dut->adiv5->MemWriteBlock (0, BENCH_ADDR, out, BENCH_WORDS) != SWJ_OK;
+
+  // Scan from enable
+  dut->top->IRQSCAN = 1;
+  dut->Enable (true);
+
+  // Without IRQ_PERIOD load may starve the scan, only report
+  for (i = 0; i < MODE_CNT; i++) {
+    fails += dut->Measure (i, out);
+    if ((i != MODE_LOAD) && (dut->recvd != dut->irqs))
+      fails++;
+  }
+  printf ("%u IRQs forwarded, %d bad FIFO bytes\n", dut->top->IRQCNT, dut->errors);
+  if (dut->errors || (dut->top->STAT != SWJ_OK))
+    fails++;
+  printf ("%s\n", fails ? "FAILED" : "PASSED");
+
+  // Done
+  delete dut;
+  return fails ? -1 : 0;
+}
@@ -17,6 +17,43 @@
  *    - Continuously scan DCRDR for changes.
  *    - Calculate new IRQ count from 8lsb counter.
  *    - Push new IRQs to FIFO to forward to host.
+ *
+ *  The 16 byte block at IRQBASE holds the record at BD0 and the ACK
+ *  word at BD1. With IRQ_BATCH > 1 further records at BD2/BD3 are
+ *  read in the same pass. Each IRQ is sent to the host as a D1 header
+ *  {4'b0001, record[1], lane, record[0]} and the IRQ byte. The host
+ *  echoes the header as ACK - a single record sets the whole ACK byte
+ *  for the lane, batched records set bit [record] of it.
+ *
+ *  Scans start once AHB has been quiet for 16 cycles, so short gaps
+ *  between accesses don't thrash TAR/bank setup. A non-zero
+ *  IRQ_PERIOD holds off AHB for one pass once that many cycles passed
+ *  since the last, to bound latency under load. IRQLAT counts passes
+ *  [0], cycles between passes [1] and the longest gap [2].
+ *
+ *  Posted writes
+ *    With POSTED_WRITES the AHB write completes as soon as the DRW/BDn
+ *    write is queued to the PHY. A failed write sets STAT and the next
+ *    AHB access returns ERROR.
+ *
+ *  Read window
+ *    INCR4/8/16 read bursts with SEQ set keep up to READ_WINDOW DRW
+ *    reads in flight. Beats are returned in order as responses arrive.
+ *    Anything other than the next beat drains the window first.
+ *
+ *  Prefetch
+ *    With SEQ set and PREFETCH non-zero any other DRW read also keeps
+ *    PREFETCH words read ahead, stopping at the 1KB TAR boundary.
+ *    Sequential reads are returned from the window. Prefetched data is
+ *    dropped on any other access, and is never reported as an error
+ *    unless its beat is actually returned. Only enable for side effect
+ *    free memory - a speculative FAULT still sets the target STICKYERR.
+ *
+ *  Setup caching
+ *    The AP bank, CSW width and TAR (following autoincrement within
+ *    the 1KB wrap) are tracked and only written when they change.
+ *    SKIPCNT counts setup writes avoided per AHB access, for mapping
+ *    into a CSR: [0] SELECT, [1] CSW, [2] TAR.
  *    
  *  All rights reserved.
  *  Tiny Labs Inc
@@ -26,7 +63,15 @@
 import adiv5_pkg::*;
 import ahb3lite_pkg::*;
 
-module ahb3lite_debug_bridge 
+module ahb3lite_debug_bridge
+  #(
+    // Complete writes once queued
+    parameter POSTED_WRITES = 1,
+    // Burst reads in flight, power of 2 below 2^CTR_WIDTH
+    parameter READ_WINDOW = 4,
+    // IRQ records read per scan, 1-3
+    parameter IRQ_BATCH = 1
+    )
    (
     // Core signals
     input                              CLK,
@@ -41,8 +86,12 @@ module ahb3lite_debug_bridge
     // Keyhole access disables auto-increment to allow
     // continuous access of 4 word bank using BDn.
     input                              SEQ,
+
+    // Sequential read-ahead in words, 0 disables
+    input [$clog2 (READ_WINDOW)-1:0]   PREFETCH,
     
     // Side channel stat if failure
+    // Sticky, includes failed posted writes
     output logic [2:0]                 STAT,
 
     // Select AP - Required as DPv1+ does
@@ -53,8 +102,16 @@ module ahb3lite_debug_bridge
     // This requires target setups and
     // cooperation from the host
     input                              IRQSCAN,
+    input [31:0]                       IRQBASE,
     output logic [31:0]                IRQCNT,
-    output logic [31:0]                IRQBASE,
+
+    // Max cycles between scans under AHB load, 0 scans when idle
+    input [15:0]                       IRQ_PERIOD,
+    // Scan passes/cycles between passes/longest gap
+    output logic [2:0] [31:0]          IRQLAT,
+
+    // Setup writes skipped - SELECT/CSW/TAR
+    output logic [2:0] [31:0]          SKIPCNT,
     
     // Transparent AHB slave bridge
     input                              HREADY,
@@ -134,11 +191,14 @@ module ahb3lite_debug_bridge
                              STATE_COREREG_ACCESS,        // 18: registers directly via CSR if
                              STATE_COREREG_POLL_DHCSR,    // 19: needed.
                              STATE_COREREG_READ_DCRDR,    // 20:
-                             STATE_COREREG_DCRDR_LATCH    // 21:
+                             STATE_COREREG_DCRDR_LATCH,   // 21:
+                             STATE_WINDOW_RESP,           // 22: Return burst beats
+                             STATE_WINDOW_FLUSH,          // 23: Drain burst reads
+                             STATE_IRQSCAN_CHECK          // 24: Push changed records
                              } brg_state_t;
    brg_state_t state;
 // Track state for debug
-`ifndef SYNTHESIS
+`ifdef DEBUG_BRIDGE
    brg_state_t pstate;
 `endif
 
@@ -150,6 +210,8 @@ module ahb3lite_debug_bridge
    logic               ahb_pending;    // AHB transaction pending
    logic               ahb_latch_data; // Latch data next cycle
    logic [2:0]         ahb_req_sz;     // Requested size
+   logic [4:0]         ahb_beats;      // Beats in defined length burst
+   logic [3:0]         ahb_idle;       // Cycles AHB has been quiet
 
    // Track commands pending/received
    parameter CTR_WIDTH = 3;
@@ -196,6 +258,25 @@ module ahb3lite_debug_bridge
    adiv5_dp_sel        sel;
    logic [31:0]        tar;
 
+   // Setup writes issued for current access
+   localparam SKIP_SEL = 0;
+   localparam SKIP_CSW = 1;
+   localparam SKIP_TAR = 2;
+   logic [2:0]         setup_wr;
+
+   // Next TAR after autoincrement, unknown past 1KB wrap
+   function logic [31:0] tar_inc (logic [31:0] addr, logic [2:0] width);
+      tar_inc = addr + (1 << width);
+      if (tar_inc[31:10] != addr[31:10])
+        tar_inc = -1;
+   endfunction // tar_inc
+
+   // Saturating count of setup writes skipped
+   function logic [2:0] [31:0] skip_count (logic [2:0] [31:0] cnt, logic [2:0] wr);
+      for (int n = 0; n < 3; n++)
+        skip_count[n] = (wr[n] | (&cnt[n])) ? cnt[n] : cnt[n] + 1;
+   endfunction // skip_count
+
    // IRQ scan accounting
    logic               irq_scan_active;
    logic               irq_scan_error;
@@ -204,19 +285,28 @@ module ahb3lite_debug_bridge
    logic               irq_cmd;
    logic               irq_scan_en;
    logic               irq_check_ack;
+   logic               irq_ack_pend;   // ACK word changed, not written
+   logic               irq_clear;      // All records cleared, reset ACKs
+   logic               irq_access;     // Setup for scan, not AHB
+   logic               irq_force;      // Scan overdue
+   logic               irq_empty;      // No records set
+   logic               irq_seen;       // Records pushed since clear
+   logic [1:0]         irq_idx;        // Record being read/checked
+   logic [31:0]        irq_age;        // Cycles since last pass
    logic [2:0]         irq_new_cnt;
-   logic [31:0]        irq_prev;
+   logic [31:0]        irq_prev [IRQ_BATCH];
+   logic [31:0]        irq_rec [IRQ_BATCH];
    logic [31:0]        irq_ack;
    
-   // IRQ fifo interface
-   logic [31:0]        irq_fifo_wrdata, irq_fifo_rddata;
+   // IRQ fifo interface, record index above data
+   logic [33:0]        irq_fifo_wrdata, irq_fifo_rddata;
    logic               irq_fifo_wren, irq_fifo_rden;
    logic               irq_fifo_wrfull, irq_fifo_rdempty;
    
    // Instantiate an internal fifo for processing IRQs
    fifo #(
           .DEPTH_WIDTH  (3), // 8 slots in fifo
-          .DATA_WIDTH   (32)
+          .DATA_WIDTH   (34)
           ) u_irq_fifo
      (
       .clk        (CLK),
@@ -232,6 +322,44 @@ module ahb3lite_debug_bridge
    // Get max
    parameter CTR_MAX = CTR_WIDTH'($rtoi($pow (2, CTR_WIDTH) - 1));
    
+   // Burst read window
+   localparam WIN_WIDTH = $clog2 (READ_WINDOW);
+   logic [4:0]           win_issue;      // Reads left to issue
+   logic [WIN_WIDTH:0]   win_cnt;        // Issued, not returned to AHB
+   logic [WIN_WIDTH:0]   win_wp, win_rp; // Response buffer pointers
+   logic [31:0]          win_addr;       // Next beat address
+   logic                 win_err;        // Beat failed, error after drain
+   logic                 win_fail;       // Window read failed, TAR unknown
+   logic                 win_spec;       // Open ended read-ahead
+   logic [3:0]           win_idle;       // Quiet cycles before giving way
+   logic                 win_issue_en, win_serve;
+   logic [CTR_MAX:0]     win_tag;        // Response slot is a window read
+   adiv5_resp_t          win_buf [READ_WINDOW];
+
+   // Response slot is an IRQ record read
+   logic [CTR_MAX:0]     irq_tag;
+   logic [1:0]           irq_slot [CTR_MAX+1];
+
+   // Setup target, scan block or AHB access
+   logic [31:0]          req_addr;
+   logic [2:0]           req_sz;
+   assign req_addr = irq_access ? IRQBASE : ahb_addr;
+   assign req_sz = irq_access ? CSW_WIDTH_WORD : ahb_req_sz;
+
+   // Records follow BD1 ACK word
+   function logic [5:0] irq_bd (logic [1:0] idx);
+      return AP_ADDR_BD0 | {4'h0, (idx == 0) ? 2'd0 : idx + 2'd1};
+   endfunction // irq_bd
+
+   function logic [4:0] burst_beats (logic [2:0] hburst);
+      case (hburst)
+        HBURST_INCR4:  return 4;
+        HBURST_INCR8:  return 8;
+        HBURST_INCR16: return 16;
+        default:       return 1;
+      endcase
+   endfunction // burst_beats
+
    // Calculate previous response
    logic [CTR_WIDTH-1:0] resp_pending_next; //resp_pending_prev
    //assign resp_pending_prev = (resp_pending == 0) ? CTR_MAX : resp_pending - 1;
@@ -244,12 +372,37 @@ module ahb3lite_debug_bridge
    
    // Command is complete when we've received all responses
    assign cmd_complete = (resp_pending == resp_recvd);
+
+   // Issue next read while beats are returned
+   // Read-ahead stops at TAR wrap
+   assign win_issue_en = (state == STATE_WINDOW_RESP) & !ADIv5_INHIBIT &
+                         (win_spec ? ((win_cnt <= PREFETCH) & (tar != -1)) :
+                          ((win_issue != 0) & (win_cnt < READ_WINDOW)));
+
+   // Next beat waiting at the same size and its response is in
+   assign win_serve = (state == STATE_WINDOW_RESP) & !slv_HREADYOUT & !ahb_wnr &
+                      (ahb_addr == win_addr) & (ahb_req_sz == csw.width) & (win_wp != win_rp);
  
    // Always read responses while available
    assign ADIv5_RDEN = !ADIv5_RDEMPTY;
 
    // Alway process IRQ FIFO when data is available
-   assign irq_fifo_rden = !irq_fifo_rdempty & !irq_processing;
+   assign irq_fifo_rden = !irq_fifo_rdempty & !irq_processing & !irq_fifo_check_resp;
+
+   // Scan pass overdue under AHB load
+   assign irq_force = (IRQ_PERIOD != 0) & (irq_age >= IRQ_PERIOD);
+
+   // Record state across batch
+   always_comb
+     begin
+        irq_empty = 1;
+        irq_seen = 0;
+        for (int n = 0; n < IRQ_BATCH; n++)
+          begin
+             irq_empty &= (irq_rec[n] == 0);
+             irq_seen |= (irq_prev[n] != 0);
+          end
+     end
 
    // Read IRQ acks
    assign IRQ_RDEN = !IRQ_RDEMPTY;
@@ -261,6 +414,8 @@ module ahb3lite_debug_bridge
           begin
              state <= STATE_DISABLED;
              IRQCNT <= 0;
+             IRQLAT <= 0;
+             SKIPCNT <= 0;
           end
         
         // Main processing
@@ -268,7 +423,7 @@ module ahb3lite_debug_bridge
           begin
 
              // Debug only
-             `ifndef SYNTHESIS
+             `ifdef DEBUG_BRIDGE
              pstate <= state;
              if (state != pstate)
                $display ("%s", state.name);
@@ -277,23 +432,35 @@ module ahb3lite_debug_bridge
              // Check if scan becoming active
              if (!irq_scan_en & IRQSCAN)
                begin
-                  // Here we co-opt the system to make
-                  // the required request.
-                  // BANKSEL->SET_TAR->READ BD0
-                  ahb_req_sz <= CSW_WIDTH_WORD;
-                  // IRQ base address
-                  ahb_addr <= IRQBASE;
-                  // Read operation
-                  ahb_wnr <= 0;
-
                   // Clear irq variables
-                  irq_prev <= 32'h0;
+                  for (int n = 0; n < IRQ_BATCH; n++)
+                    begin
+                       irq_prev[n] <= 32'h0;
+                       irq_rec[n] <= 32'h0;
+                    end
                   irq_ack <= 32'h0;
-                  irq_check_ack <= 1;
+                  irq_ack_pend <= 0;
+                  irq_clear <= 0;
+                  irq_idx <= 0;
                end // if (!irq_scan_en & IRQSCAN)
 
              // Lags one cycle
              irq_scan_en <= IRQSCAN;
+
+             // Time since last scan pass
+             if (!IRQSCAN | irq_scan_error)
+               irq_age <= 0;
+             else if (~&irq_age)
+               irq_age <= irq_age + 1;
+
+             // Only pushed from scan states
+             irq_fifo_wren <= 0;
+
+             // AHB quiet time before idle scan
+             if (!slv_HREADYOUT | ahb_pending)
+               ahb_idle <= 0;
+             else if (~&ahb_idle)
+               ahb_idle <= ahb_idle + 1;
              
              // Latch data
              if (ADIv5_RDEN)
@@ -309,12 +476,32 @@ module ahb3lite_debug_bridge
                   // Get response
                   resp <= ADIv5_RDDATA;
                   resp_recvd <= resp_recvd + 1;
+
+                  // Save IRQ records for check
+                  if (irq_tag[resp_recvd])
+                    begin
+                       if (ADIv5_RDDATA[2:0] == STAT_OK)
+                         irq_rec[irq_slot[resp_recvd]] <= ADIv5_RDDATA[ADIv5_RESP_WIDTH-1:3];
+                       irq_tag[resp_recvd] <= 0;
+                    end
+
+                  // Buffer window reads for AHB side
+                  if (win_tag[resp_recvd])
+                    begin
+                       win_buf[win_wp[WIN_WIDTH-1:0]] <= ADIv5_RDDATA;
+                       win_wp <= win_wp + 1;
+                       win_tag[resp_recvd] <= 0;
+                    end
                   //$display ("state=%s resp=%h", state.name, ADIv5_RDDATA[ADIv5_RESP_WIDTH-1:3]);
 
                   // Set sticky STAT reg if failure
                   if (ADIv5_RDDATA[2:0] != STAT_OK)
                     begin
-                       STAT <= ADIv5_RDDATA[2:0];
+                       // Window reads report when their beat is returned
+                       if (win_tag[resp_recvd])
+                         win_fail <= 1;
+                       else
+                         STAT <= ADIv5_RDDATA[2:0];
                        // Assume TAR is no longer valid if autoinc
                        // in case it was a failed write
                        tar <= -1;
@@ -341,25 +528,28 @@ module ahb3lite_debug_bridge
                   if (!IRQ_RDEN)
                     irq_check_ack <= 0;
 
-                  // OR in to current ack
-                  irq_ack <= irq_ack | (32'hFF << (8 * IRQ_RDDATA[2:1]));
-                  state <= STATE_IRQSCAN_ACK;
+                  // OR in to current ack, written on next scan
+                  if (IRQ_BATCH == 1)
+                    irq_ack <= irq_ack | (32'hFF << (8 * IRQ_RDDATA[2:1]));
+                  else
+                    irq_ack <= irq_ack | (32'h1 << ((8 * IRQ_RDDATA[2:1]) + {IRQ_RDDATA[3], IRQ_RDDATA[0]}));
+                  irq_ack_pend <= 1;
                end
              
              // Decode IRQs from internal FIFO
              if (irq_fifo_rden)
-               begin
-                  irq_fifo_check_resp <= 1;
-                  irq_processing <= 1;
-                  irq_cmd <= 0;
-               end
+               irq_fifo_check_resp <= 1;
              
              // Decode IRQ fifo data
              if (irq_fifo_check_resp)
                begin
+                  // Output starts once count is known
+                  irq_processing <= 1;
+                  irq_cmd <= 0;
+
                   // Calculate new IRQs
                   // Up to 4 IRQs come in the following lanes
-                  casez (irq_fifo_rddata)
+                  casez (irq_fifo_rddata[31:0])
                     32'h0000??00: begin irq_new_cnt <= 1; IRQCNT <= IRQCNT + 1; end
                     32'h00????00: begin irq_new_cnt <= 2; IRQCNT <= IRQCNT + 2; end
                     32'h??????00: begin irq_new_cnt <= 3; IRQCNT <= IRQCNT + 3; end
@@ -403,7 +593,7 @@ module ahb3lite_debug_bridge
                        else
                        begin
                           // Write command header
-                          IRQ_WRDATA <= {4'b0001, 3'(32'(irq_new_cnt) - 1), 1'b0};
+                          IRQ_WRDATA <= {4'b0001, irq_fifo_rddata[33], 2'(32'(irq_new_cnt) - 1), irq_fifo_rddata[32]};
                           IRQ_WREN <= 1;
                           irq_cmd <= 1;
                        end
@@ -412,7 +602,9 @@ module ahb3lite_debug_bridge
              // Latch ahb data next cycle
              if (ahb_latch_data)
                begin
+                  `ifdef DEBUG_BRIDGE
                   $display ("%H", HWDATA);
+                  `endif
                   ahb_data <= HWDATA;
                   ahb_latch_data <= 0;
                end                    
@@ -445,6 +637,23 @@ module ahb3lite_debug_bridge
                     irq_scan_error <= 0;
                     irq_processing <= 0;
                     irq_fifo_check_resp <= 0;
+                    irq_check_ack <= 0;
+                    irq_access <= 0;
+                    irq_tag <= 0;
+                    irq_idx <= 0;
+                    irq_fifo_wren <= 0;
+                    IRQ_WREN <= 0;
+                    ahb_beats <= 1;
+                    ahb_idle <= 0;
+                    win_tag <= 0;
+                    win_cnt <= 0;
+                    win_issue <= 0;
+                    win_wp <= 0;
+                    win_rp <= 0;
+                    win_err <= 0;
+                    win_fail <= 0;
+                    win_spec <= 0;
+                    win_idle <= 0;
                  end
             end
           
@@ -457,17 +666,49 @@ module ahb3lite_debug_bridge
                slv_HRESP <= HRESP_OKAY;
 
                // If autoincrement changed then update csw
+               // Skip SELECT if CSW bank is still selected, not an AHB
+               // access so the next DRW/BDn access counts the skip
                if (SEQ != csw.autoinc[0])
-                 state <= STATE_WRITE_DPSELECT;
+                 begin
+                    if (init_complete & (sel.apsel == APSEL) & bank_match (sel, AP_ADDR_CSW))
+                      state <= STATE_UPDATE_APCSW;
+                    else
+                      state <= STATE_WRITE_DPSELECT;
+                 end
+
+               // Scan when AHB is idle or scan is overdue
+               // Setup CSW/TAR/bank for IRQBASE block
+               else if (IRQSCAN & !irq_scan_error & ((!ahb_pending & (&ahb_idle)) | irq_force))
+                 begin
+                    irq_access <= 1;
+                    if (csw.width != CSW_WIDTH_WORD)
+                      begin
+                         if (bank_match (sel, AP_ADDR_CSW))
+                           state <= STATE_SET_CSW;
+                         else
+                           state <= STATE_SELECT_APBANK_0;
+                      end
+                    else if (IRQBASE[31:4] != tar[31:4])
+                      begin
+                         if (bank_match (sel, AP_ADDR_TAR))
+                           state <= STATE_SET_TAR;
+                         else
+                           state <= STATE_SELECT_APBANK_0;
+                      end
+                    else if (!bank_match (sel, AP_ADDR_BD0))
+                      state <= STATE_SELECT_APBANK_1;
+                    else
+                      state <= STATE_IRQSCAN;
+                 end
 
                // Complete AHB transaction
-               // Same path for initiating IRQSCAN
-               else if (ahb_pending | (IRQSCAN & !irq_scan_error))
+               else if (ahb_pending)
                  begin
                     
                     // Clear pending for AHB access
-                    if (!IRQSCAN)
-                      ahb_pending <= 0;
+                    ahb_pending <= 0;
+                    irq_access <= 0;
+                    setup_wr <= 0;
                     
                     // Determine how to most efficiently handle the request
                     // This is actually a somewhat complicated decision tree.
@@ -484,8 +725,7 @@ module ahb3lite_debug_bridge
                            state <= STATE_SELECT_APBANK_0;
                       end
                     // If TAR exact match and width is correct then access DRW
-                    // For IRQSCAN we want to access via BDn
-                    else if ((ahb_addr == tar) & !IRQSCAN)
+                    else if (ahb_addr == tar)
                       begin
                          if (bank_match (sel, AP_ADDR_DRW))
                            state <= STATE_ACCESS_DRW;
@@ -524,63 +764,105 @@ module ahb3lite_debug_bridge
 
             end // case: STATE_IDLE
 
+          // Read IRQ records back to back, one pass
           STATE_IRQSCAN:
             begin
-               // Cancel if AHB request pending or scan deasserted
-               if (ahb_pending | !IRQSCAN)
+               // Between passes give way to AHB unless overdue
+               if ((irq_idx == 0) & (!IRQSCAN | (ahb_pending & !irq_force)))
                  begin
                     state <= STATE_IDLE;
                     ADIv5_WREN <= 0;
-                    irq_fifo_wren <= 0;
                  end
-               // Keep one command issued in queue
-               else if (!ADIv5_INHIBIT & cmd_complete)
+               // Forward host ACKs first
+               else if ((irq_idx == 0) & irq_ack_pend)
+                 begin
+                    state <= STATE_IRQSCAN_ACK;
+                    ADIv5_WREN <= 0;
+                 end
+               // Previous pass complete or batch in progress
+               else if (!ADIv5_INHIBIT & (cmd_complete | (irq_idx != 0)))
                  begin
                     // Set IRQ scan as active
                     irq_scan_active <= 1;
+                    ADIv5_WREN <= 1;
+                    resp_pending <= resp_pending + 1;
 
                     // If we were processing but all IRQs have
                     // now cleared then clear all ACKs and continue
                     // scanning
-                    if (|irq_prev & (resp.data == 0))
+                    if ((irq_idx == 0) & irq_clear)
                       begin
                          ADIv5_WRDATA <= AP_REG_WRITE (AP_ADDR_BD1, 32'h0);
                          irq_ack <= 32'h0;
+                         irq_clear <= 0;
+                         for (int n = 0; n < IRQ_BATCH; n++)
+                           irq_prev[n] <= 32'h0;
                       end
                     else
-                      // Write READ request to BD0 continuously.
-                      // The results will be checked in parallel
-                      ADIv5_WRDATA <= AP_REG_READ (AP_ADDR_BD0);
-                    ADIv5_WREN <= 1;
-                    resp_pending <= resp_pending + 1;
-                    
-                    // Check previous results
-                    // If theres a change push into fifo
-                    if (|resp.data && (irq_prev != resp.data))
                       begin
-                         // Error if FIFO fills up
-                         if (irq_fifo_wrfull & irq_fifo_wren)
+                         ADIv5_WRDATA <= AP_REG_READ (irq_bd (irq_idx));
+                         irq_tag[resp_pending] <= 1;
+                         irq_slot[resp_pending] <= irq_idx;
+
+                         // Account time between passes
+                         if (irq_idx == 0)
                            begin
-                              state <= STATE_IRQSCAN_ERROR;
-                              IRQ_WRDATA <= 8'h01;
-                              IRQ_WREN <= 1;
+                              IRQLAT[0] <= IRQLAT[0] + 1;
+                              IRQLAT[1] <= IRQLAT[1] + irq_age;
+                              if (irq_age > IRQLAT[2])
+                                IRQLAT[2] <= irq_age;
+                              irq_age <= 0;
                            end
-                         // Push data onto internal FIFO for parallel processing
-                         else
+
+                         // Check records once all are in
+                         if (irq_idx == 2'(IRQ_BATCH - 1))
                            begin
-                              irq_prev <= resp.data;
-                              irq_fifo_wrdata <= resp.data;
-                              irq_fifo_wren <= 1;
+                              irq_idx <= 0;
+                              state <= STATE_IRQSCAN_CHECK;
                            end
+                         else
+                           irq_idx <= irq_idx + 1;
                       end
-                    else
-                      irq_fifo_wren <= 0;
                  end
-               // Terminate write if FIFO full
                else
+                 ADIv5_WREN <= 0;
+            end
+
+          // Push changed records to internal FIFO, one per cycle
+          STATE_IRQSCAN_CHECK:
+            begin
+               ADIv5_WREN <= 0;
+               if (cmd_complete)
                  begin
-                    irq_fifo_wren <= 0;
-                    ADIv5_WREN <= 0;
+                    if (|irq_rec[irq_idx] && (irq_prev[irq_idx] != irq_rec[irq_idx]) && irq_fifo_wrfull)
+                      begin
+                         // Error if FIFO fills up
+                         state <= STATE_IRQSCAN_ERROR;
+                         IRQ_WRDATA <= 8'h01;
+                         IRQ_WREN <= 1;
+                      end
+                    else
+                      begin
+                         // Push data onto internal FIFO for parallel processing
+                         if (|irq_rec[irq_idx] && (irq_prev[irq_idx] != irq_rec[irq_idx]))
+                           begin
+                              irq_prev[irq_idx] <= irq_rec[irq_idx];
+                              irq_fifo_wrdata <= {irq_idx, irq_rec[irq_idx]};
+                              irq_fifo_wren <= 1;
+                           end
+
+                         if (irq_idx == 2'(IRQ_BATCH - 1))
+                           begin
+                              irq_idx <= 0;
+                              irq_clear <= irq_empty & irq_seen;
+                              if (ahb_pending | !IRQSCAN)
+                                state <= STATE_IDLE;
+                              else
+                                state <= STATE_IRQSCAN;
+                           end
+                         else
+                           irq_idx <= irq_idx + 1;
+                      end
                  end
             end
 
@@ -596,6 +878,7 @@ module ahb3lite_debug_bridge
 
                     // Move back to scanning state
                     // if new ack not coming in
+                    irq_ack_pend <= irq_check_ack;
                     if (!irq_check_ack)
                       state <= STATE_IRQSCAN;
                  end
@@ -611,8 +894,10 @@ module ahb3lite_debug_bridge
                // Update flags
                irq_scan_active <= 0;
                irq_scan_error <= 1;
+               irq_idx <= 0;
                state <= STATE_IDLE;
                IRQ_WREN <= 0;
+               ADIv5_WREN <= 0;
             end
 
           // Write data to core reg
@@ -778,15 +1063,45 @@ module ahb3lite_debug_bridge
                  ADIv5_WREN <= 1;
                  resp_pending <= resp_pending + 1;
                  if (ahb_wnr)
+                   ADIv5_WRDATA <= AP_REG_WRITE (AP_ADDR_DRW, ahb_data);
+                 else
+                   ADIv5_WRDATA <= AP_REG_READ (AP_ADDR_DRW);
+
+                 // Increment TAR if enabled
+                 if (csw.autoinc == CSW_INC_SINGLE)
+                   tar <= tar_inc (tar, csw.width);
+
+                 // Count setup writes not needed
+                 SKIPCNT <= skip_count (SKIPCNT, setup_wr);
+
+                 // Posted write completes once queued
+                 if (ahb_wnr & POSTED_WRITES)
                    begin
-                      ADIv5_WRDATA <= AP_REG_WRITE (AP_ADDR_DRW, ahb_data);
-                      // Increment TAR if enabled
-                      if (csw.autoinc == CSW_INC_SINGLE)
-                        tar <= tar + (1 << csw.width);
+                      // Report earlier failure now
+                      if (STAT != STAT_OK)
+                        begin
+                           slv_HRESP <= HRESP_ERROR;
+                           state <= STATE_AHB_ERROR_WAIT;
+                        end
+                      else
+                        begin
+                           slv_HREADYOUT <= 1;
+                           state <= STATE_IDLE;
+                        end
+                   end
+                 // Defined length burst or read-ahead, keep reads in flight
+                 else if (!ahb_wnr & (csw.autoinc == CSW_INC_SINGLE) &
+                          ((ahb_beats > 1) | (PREFETCH != 0)))
+                   begin
+                      win_spec <= (ahb_beats == 1);
+                      win_tag[resp_pending] <= 1;
+                      win_cnt <= 1;
+                      win_issue <= ahb_beats - 1;
+                      win_addr <= ahb_addr;
+                      state <= STATE_WINDOW_RESP;
                    end
                  else
-                   ADIv5_WRDATA <= AP_REG_READ (AP_ADDR_DRW);
-                 state <= STATE_AHB_RESP;
+                   state <= STATE_AHB_RESP;
               end
             else
               ADIv5_WREN <= 0;
@@ -801,11 +1116,25 @@ module ahb3lite_debug_bridge
                    ADIv5_WRDATA <= AP_REG_WRITE (AP_ADDR_BD0 | {4'h0, ahb_addr[3:2]}, ahb_data);
                  else
                    ADIv5_WRDATA <= AP_REG_READ (AP_ADDR_BD0 | {4'h0, ahb_addr[3:2]});
-                 // If not handling AHB req enter IRQSCAN
-                 if (!slv_HREADYOUT)
-                   state <= STATE_AHB_RESP;
+                 // Count setup writes not needed
+                 SKIPCNT <= skip_count (SKIPCNT, setup_wr);
+
+                 // Posted write completes once queued
+                 if (ahb_wnr & POSTED_WRITES)
+                   begin
+                      if (STAT != STAT_OK)
+                        begin
+                           slv_HRESP <= HRESP_ERROR;
+                           state <= STATE_AHB_ERROR_WAIT;
+                        end
+                      else
+                        begin
+                           slv_HREADYOUT <= 1;
+                           state <= STATE_IDLE;
+                        end
+                   end
                  else
-                   state <= STATE_IRQSCAN;
+                   state <= STATE_AHB_RESP;
               end
             else
               ADIv5_WREN <= 0;
@@ -815,14 +1144,15 @@ module ahb3lite_debug_bridge
             if (!ADIv5_INHIBIT)
               begin
                  sel.apbank <= 0;
+                 setup_wr[SKIP_SEL] <= 1;
                  ADIv5_WRDATA <= DP_REG_WRITE (DP_ADDR_SELECT, {sel[31:8], 4'h0, 4'h0});
                  ADIv5_WREN <= 1;
                  resp_pending <= resp_pending + 1;
                  
                  // If access size doesn't match set CSW
-                 if (csw.width != ahb_req_sz)
+                 if (csw.width != req_sz)
                    state <= STATE_SET_CSW;
-                 else if (ahb_addr == tar)
+                 else if ((ahb_addr == tar) & !irq_access)
                    state <= STATE_ACCESS_DRW;
                  // Otherwise set TAR
                  else
@@ -836,12 +1166,13 @@ module ahb3lite_debug_bridge
             if (!ADIv5_INHIBIT)
               begin
                  sel.apbank <= 1;
+                 setup_wr[SKIP_SEL] <= 1;
                  ADIv5_WRDATA <= DP_REG_WRITE (DP_ADDR_SELECT, {sel[31:8], 4'h1, 4'h0});
                  ADIv5_WREN <= 1;
                  resp_pending <= resp_pending + 1;
                  
                  // If we're handling an AHB3 request access BDn
-                 if (!slv_HREADYOUT)
+                 if (!irq_access)
                    state <= STATE_ACCESS_BDn;
                  // Otherwise move to IRQ scan
                  else
@@ -855,12 +1186,13 @@ module ahb3lite_debug_bridge
             if (!ADIv5_INHIBIT)
               begin
                  // Save new size
-                 csw.width <= csw_f_width'(ahb_req_sz);
-                 ADIv5_WRDATA <= AP_REG_WRITE (AP_ADDR_CSW, {csw[31:3], ahb_req_sz});
+                 csw.width <= csw_f_width'(req_sz);
+                 setup_wr[SKIP_CSW] <= 1;
+                 ADIv5_WRDATA <= AP_REG_WRITE (AP_ADDR_CSW, {csw[31:3], req_sz});
                  ADIv5_WREN <= 1;
                  resp_pending <= resp_pending + 1;
                  // If TAR already matches
-                 if ((ahb_addr == tar) && !slv_HREADYOUT)
+                 if ((ahb_addr == tar) && !irq_access)
                    state <= STATE_ACCESS_DRW;
                  // else set TAR
                  else
@@ -873,13 +1205,14 @@ module ahb3lite_debug_bridge
           STATE_SET_TAR:
             if (!ADIv5_INHIBIT)
               begin
-                 tar <= ahb_addr;
-                 ADIv5_WRDATA <= AP_REG_WRITE (AP_ADDR_TAR, ahb_addr);
+                 tar <= req_addr;
+                 setup_wr[SKIP_TAR] <= 1;
+                 ADIv5_WRDATA <= AP_REG_WRITE (AP_ADDR_TAR, req_addr);
                  ADIv5_WREN <= 1;
                  resp_pending <= resp_pending + 1;
 
                  // If we're handling an AHB3 request access DRW
-                 if (!slv_HREADYOUT)
+                 if (!irq_access)
                    state <= STATE_ACCESS_DRW;
                  // Otherwise we are IRQ scanning.
                  // Select APBANK1 for scanning BDn
@@ -903,7 +1236,9 @@ module ahb3lite_debug_bridge
                     if (!ahb_wnr)
                       begin
                          slv_HRDATA <= resp.data;
+                         `ifdef DEBUG_BRIDGE
                          $display ("%H", resp.data);
+                         `endif
                       end
 
                     // Set response as OKAY/ERROR
@@ -928,6 +1263,89 @@ module ahb3lite_debug_bridge
                  end
             end // case: STATE_AHB_RESP
           
+          // Return burst beats in order, keep window full
+          STATE_WINDOW_RESP:
+            begin
+               if (win_issue_en)
+                 begin
+                    ADIv5_WRDATA <= AP_REG_READ (AP_ADDR_DRW);
+                    ADIv5_WREN <= 1;
+                    resp_pending <= resp_pending + 1;
+                    win_tag[resp_pending] <= 1;
+                    if (!win_spec)
+                      win_issue <= win_issue - 1;
+                    tar <= tar_inc (tar, csw.width);
+                 end
+               else
+                 ADIv5_WREN <= 0;
+               win_cnt <= win_cnt + win_issue_en - win_serve;
+
+               if (win_serve)
+                 begin
+                    ahb_pending <= 0;
+                    win_idle <= 0;
+                    win_rp <= win_rp + 1;
+                    win_addr <= win_addr + (1 << csw.width);
+                    slv_HRDATA <= win_buf[win_rp[WIN_WIDTH-1:0]].data;
+
+                    // Error once remaining reads drain
+                    if (win_buf[win_rp[WIN_WIDTH-1:0]].stat != STAT_OK)
+                      begin
+                         STAT <= win_buf[win_rp[WIN_WIDTH-1:0]].stat;
+                         win_err <= 1;
+                         state <= STATE_WINDOW_FLUSH;
+                      end
+                    else
+                      begin
+                         slv_HREADYOUT <= 1;
+                         if (!win_spec & (win_cnt == 1) & (win_issue == 0))
+                           state <= STATE_IDLE;
+                      end
+                 end
+               // Not the next beat or nothing left in flight, handle it from IDLE
+               else if (!slv_HREADYOUT & ahb_pending &
+                        (ahb_wnr | (ahb_addr != win_addr) | (ahb_req_sz != csw.width) | (win_cnt == 0)))
+                 state <= STATE_WINDOW_FLUSH;
+               // Overdue scan preempts read-ahead
+               else if (win_spec & IRQSCAN & !irq_scan_error & irq_force)
+                 state <= STATE_WINDOW_FLUSH;
+               // Give way to IRQ scan and control changes once AHB goes quiet
+               else if (win_spec & slv_HREADYOUT &
+                        (IRQSCAN | (SEQ != csw.autoinc[0]) | (PREFETCH == 0)))
+                 begin
+                    win_idle <= win_idle + 1;
+                    if (&win_idle)
+                      state <= STATE_WINDOW_FLUSH;
+                 end
+            end
+
+          // Discard reads still in flight
+          STATE_WINDOW_FLUSH:
+            begin
+               ADIv5_WREN <= 0;
+               if (cmd_complete)
+                 begin
+                    win_cnt <= 0;
+                    win_issue <= 0;
+                    win_rp <= win_wp;
+                    win_err <= 0;
+                    win_fail <= 0;
+                    win_spec <= 0;
+                    win_idle <= 0;
+
+                    // TAR no longer known after failure
+                    if (win_fail)
+                      tar <= -1;
+                    if (win_err)
+                      begin
+                         slv_HRESP <= HRESP_ERROR;
+                         state <= STATE_AHB_ERROR_WAIT;
+                      end
+                    else
+                      state <= STATE_IDLE;
+                 end
+            end
+
           // HRESP must be asserted for two cycles during an error
           STATE_AHB_ERROR_WAIT:
             begin
@@ -959,6 +1377,9 @@ module ahb3lite_debug_bridge
              
              // Save transaction size
              ahb_req_sz <= {1'b0, HSIZE[1:0]};
+
+             // Beats known up front for INCR4/8/16
+             ahb_beats <= (HTRANS == HTRANS_NONSEQ) ? burst_beats (HBURST) : 1;
              
              // If write latch data next cycle
              if (HWRITE)
@@ -968,9 +1389,11 @@ module ahb3lite_debug_bridge
              ahb_pending <= 1;
 
              // Debug display
+             `ifdef DEBUG_BRIDGE
              $write ("%s%s:%H: ", HWRITE ? "W" : "R", 
                      (HSIZE[1:0] == 0) ? "B" : 
                      ((HSIZE[1:0] == 1) ? "H" : "W"), HADDR);
+             `endif
              
           end // if (HSEL &...
      end // always @ (posedge CLK)
@@ -0,0 +1,80 @@
+/**
+ *  Bench wrapper - ahb3lite_host_master driving a zero wait state
+ *  SRAM. The host FIFO is modelled by the C++ bench, the bus signals
+ *  are brought out to count bus cycles.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+module host_master_bench
+  #(parameter MEM_SIZE = 65536)
+  (
+   input               CLK,
+   input               RESETn,
+   // Host FIFO interface
+   output              RDEN,
+   input               RDEMPTY,
+   output              WREN,
+   input               WRFULL,
+   input [7:0]         RDDATA,
+   output [7:0]        WRDATA,
+   // Bus monitor
+   output [1:0]        HTRANS,
+   output [2:0]        HBURST,
+   output              HREADY
+   );
+
+   logic               HWRITE, HRESP;
+   logic [2:0]         HSIZE;
+   logic [3:0]         HPROT;
+   logic [31:0]        HADDR, HWDATA, HRDATA;
+
+   ahb3lite_host_master u_host_master (
+                                       .CLK     (CLK),
+                                       .RESETn  (RESETn),
+                                       .RDEN    (RDEN),
+                                       .RDEMPTY (RDEMPTY),
+                                       .WREN    (WREN),
+                                       .WRFULL  (WRFULL),
+                                       .RDDATA  (RDDATA),
+                                       .WRDATA  (WRDATA),
+                                       .HWRITE  (HWRITE),
+                                       .HTRANS  (HTRANS),
+                                       .HSIZE   (HSIZE),
+                                       .HADDR   (HADDR),
+                                       .HBURST  (HBURST),
+                                       .HPROT   (HPROT),
+                                       .HWDATA  (HWDATA),
+                                       .HREADY  (HREADY),
+                                       .HRDATA  (HRDATA),
+                                       .HRESP   (HRESP)
+                                       );
+
+   // Mirrored across address space
+   ahb3lite_sram1rw
+     #(
+       .MEM_SIZE (MEM_SIZE),
+       .HADDR_SIZE (32),
+       .HDATA_SIZE (32),
+       .TECHNOLOGY ("GENERIC"),
+       .REGISTERED_OUTPUT ("NO")
+       ) u_ram (
+                .HCLK      (CLK),
+                .HRESETn   (RESETn),
+                .HSEL      (1'b1),
+                .HADDR     (HADDR),
+                .HWDATA    (HWDATA),
+                .HRDATA    (HRDATA),
+                .HWRITE    (HWRITE),
+                .HSIZE     (HSIZE),
+                .HBURST    (HBURST),
+                .HPROT     (HPROT),
+                .HTRANS    (HTRANS),
+                .HREADYOUT (HREADY),
+                .HREADY    (HREADY),
+                .HRESP     (HRESP)
+                );
+
+endmodule // host_master_bench
@@ -0,0 +1,298 @@
+/**
+ *  Verilator bench on top of host_master_bench.sv - HostMaster block
+ *  transfers through the host FIFO into SRAM. Reports host FIFO
+ *  cycles per word and bus cycles per word for single beat commands,
+ *  INCR4 bursts and extended frame streams, and payload against raw
+ *  FIFO bytes.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <signal.h>
+#include <argp.h>
+#include <string.h>
+#include <deque>
+#include <verilator_utils.h>
+#include <err.h>
+
+#include "Vhost_master_bench.h"
+#include "HostLink.h"
+#include "HostMaster.h"
+
+#define RESET_TIME   10
+static bool done = false;
+
+// Defaults
+#define BENCH_WORDS  1024
+#define BENCH_ADDR   0x1000
+
+// Long options, short keys taken by verilator_utils
+#define OPT_ADDR     600
+
+// FIFO model never fills, let the whole block queue
+#define BENCH_WINDOW (1 << 20)
+
+// AHB3 HTRANS
+#define HTRANS_IDLE  0
+
+static void INTHandler (int signal)
+{
+  printf("\nCaught ctrl-c\n");
+  done = true;
+}
+
+// Transfer modes
+enum {
+  MODE_SINGLE,
+  MODE_BURST,
+  MODE_STREAM,
+  MODE_CNT
+};
+static const char *mode_name[MODE_CNT] = { "single", "burst", "stream" };
+
+// Cycle counters
+typedef struct {
+  uint64_t cycles, bus, beats, cmds, link;
+} mark_t;
+
+class host_master_tb : public VerilatorUtils {
+
+private:
+  bool _doCycle (void);
+
+  // Host FIFO model
+  std::deque<uint8_t> fifo;
+
+  // Bus monitor
+  uint64_t bus, beats;
+  bool active;
+
+public:
+  Vhost_master_bench *top;
+  SimLink *link;
+  HostMaster *host;
+  host_master_tb ();
+  ~host_master_tb ();
+  bool doCycle (void);
+
+  // Options
+  int words;
+  uint32_t addr;
+
+  void Mark (mark_t *m);
+  double Report (int mode, const char *test, mark_t *start);
+  int Measure (int mode, double *cpw);
+};
+
+static void pump (void *arg)
+{
+  ((host_master_tb *)arg)->doCycle ();
+}
+
+static int parse_opt (int key, char *arg, struct argp_state *state)
+{
+  host_master_tb *tb = (host_master_tb *)state->input;
+
+  switch (key) {
+    case ARGP_KEY_INIT:
+      state->child_inputs[0] = state->input;
+      break;
+    case 'w':
+      tb->words = strtol (arg, NULL, 0);
+      break;
+    case OPT_ADDR:
+      tb->addr = strtoul (arg, NULL, 0) & ~3;
+      break;
+  }
+  return 0;
+}
+
+static int parse_args (int argc, char **argv, host_master_tb *tb)
+{
+  struct argp_option options[] =
+    {
+     { "words", 'w', "CNT", 0, "Words per block transfer" },
+     { "addr", OPT_ADDR, "ADDR", 0, "Block start address" },
+     { 0 }
+  };
+  struct argp_child child_parsers[] =
+    {
+     { &verilator_utils_argp, 0, "", 0 },
+     { 0 }
+  };
+  struct argp argp = { options, parse_opt, 0, 0, child_parsers };
+  return argp_parse (&argp, argc, argv, 0, 0, tb);
+}
+
+host_master_tb::host_master_tb (void) : VerilatorUtils (NULL)
+{
+  top = new Vhost_master_bench;
+  link = new SimLink (pump, this);
+  host = new HostMaster (link, 0, BENCH_WINDOW);
+  words = BENCH_WORDS;
+  addr = BENCH_ADDR;
+  bus = beats = 0;
+  active = false;
+  top->RDEMPTY = 1;
+  top->WRFULL = 0;
+
+  // Enable trace
+  top->trace (tfp, 99);
+}
+
+host_master_tb::~host_master_tb ()
+{
+  delete host;
+  delete link;
+  delete top;
+}
+
+bool host_master_tb::_doCycle (void)
+{
+  // Call base function
+  if (!VerilatorUtils::doCycle() || done)
+    exit (-1);
+
+  // Control reset
+  if (getTime () > RESET_TIME)
+    top->RESETn = 1;
+  else
+    top->RESETn = 0;
+
+  // Eval
+  top->eval ();
+
+  // Flip clock
+  top->CLK = !top->CLK;
+
+  // Continue
+  return true;
+}
+
+bool host_master_tb::doCycle (void)
+{
+  uint8_t c;
+  bool rden;
+
+  // Settle before rising edge
+  if (!_doCycle ()) return false;
+
+  // Sample strobes
+  rden = top->RDEN && !fifo.empty ();
+  if (top->WREN)
+    link->Put (top->WRDATA);
+
+  // Address phase accepted or data phase in progress
+  if (top->HREADY && (top->HTRANS != HTRANS_IDLE))
+    beats++;
+  if (active || (top->HTRANS != HTRANS_IDLE))
+    bus++;
+  active = top->HTRANS != HTRANS_IDLE;
+
+  // Rising edge
+  if (!_doCycle ()) return false;
+
+  // Read data valid the cycle after RDEN
+  if (rden) {
+    top->RDDATA = fifo.front ();
+    fifo.pop_front ();
+  }
+
+  // One byte per cycle from host
+  if (link->Get (&c))
+    fifo.push_back (c);
+  top->RDEMPTY = fifo.empty ();
+  return true;
+}
+
+void host_master_tb::Mark (mark_t *m)
+{
+  // Two ticks per cycle
+  m->cycles = getTime () / 2;
+  m->bus = bus;
+  m->beats = beats;
+  m->cmds = host->cmds;
+  m->link = host->tx_bytes + host->rx_bytes;
+}
+
+double host_master_tb::Report (int mode, const char *test, mark_t *start)
+{
+  mark_t end;
+  double cpw;
+
+  Mark (&end);
+  cpw = (double)(end.cycles - start->cycles) / words;
+  printf ("%-6s %-5s %8lu cycles %6.2f cycles/word %5.2f bus cycles/word "
+          "%lu beats %lu cmds %3.0f%% link payload\n",
+          mode_name[mode], test, (unsigned long)(end.cycles - start->cycles), cpw,
+          (double)(end.bus - start->bus) / words, (unsigned long)(end.beats - start->beats),
+          (unsigned long)(end.cmds - start->cmds), 100.0 * words * 4 / (end.link - start->link));
+  return cpw;
+}
+
+int host_master_tb::Measure (int mode, double *cpw)
+{
+  uint32_t *out, *in;
+  mark_t start;
+  int i, err = 0;
+
+  out = new uint32_t[words];
+  in = new uint32_t[words];
+  for (i = 0; i < words; i++) {
+    out[i] = (0x9e3779b9 * (i + 1)) ^ mode;
+    in[i] = 0;
+  }
+
+  // Start without autoincrement
+  host->burst = (mode == MODE_BURST);
+  host->stream = (mode == MODE_STREAM);
+  host->Invalidate ();
+
+  Mark (&start);
+  err |= host->WriteBlock (addr, (uint8_t *)out, words * 4) != 0;
+  cpw[0] = Report (mode, "write", &start);
+  Mark (&start);
+  err |= host->ReadBlock (addr, (uint8_t *)in, words * 4) != 0;
+  cpw[1] = Report (mode, "read", &start);
+
+  for (i = 0; i < words; i++)
+    if (in[i] != out[i]) {
+      printf ("Mismatch @ %08X: %08X != %08X\n", addr + (i * 4), in[i], out[i]);
+      err = 1;
+      break;
+    }
+  delete[] out;
+  delete[] in;
+  return err;
+}
+
+int main (int argc, char **argv)
+{
+  int i, fails = 0;
+  double cpw[MODE_CNT][2];
+  host_master_tb *dut = new host_master_tb;
+
+  // Parse args
+  parse_args (argc, argv, dut);
+
+  // Setup interrupt handler
+  signal (SIGINT, &INTHandler);
+
+  // Run through reset
+  for (i = 0; i < RESET_TIME * 2; i++)
+    dut->doCycle ();
+
+  // Single beat autoincrement, INCR4 bursts then streams
+  for (i = 0; i < MODE_CNT; i++)
+    fails += dut->Measure (i, cpw[i]);
+  for (i = MODE_BURST; i < MODE_CNT; i++)
+    printf ("%s speedup: write %.2fx read %.2fx\n", mode_name[i],
+            cpw[MODE_SINGLE][0] / cpw[i][0], cpw[MODE_SINGLE][1] / cpw[i][1]);
+  printf ("%s\n", fails ? "FAILED" : "PASSED");
+
+  // Done
+  delete dut;
+  return fails ? -1 : 0;
+}
@@ -1,6 +1,17 @@
 /**
  *  ahb3lite_host_master connects a host PC to the AHB3 bus as a master. This 
  *  allows initiating transactions on the bus, reading/writing memory, etc.
+ *
+ *  The next command is received while the current one is on the bus and
+ *  its response is shifted out. Transfer size 11 runs a four word INCR4
+ *  burst (INCR when not 16 byte aligned) with address and data phases
+ *  overlapped - reads take a D4 address or autoincrement, writes must
+ *  autoincrement with D16 data. Response is D16 with beat 0 first.
+ *
+ *  Extended frames (host_fifo_pkg) stream autoincrement bursts:
+ *    write: {A,D2,1111} LEN data[LEN] - LEN/16 bursts, D0 response
+ *    read:  {A,D2,0111} 0x0002 CNT - response {A,D2,0111} CNT/16*16+1
+ *           followed by the data and a status byte (err bit0)
  * 
  *  All rights reserved.
  *  Tiny Labs Inc
@@ -38,42 +49,101 @@ module ahb3lite_host_master
    // Import fifo constants
    import host_fifo_pkg::*;
    
-   // Simple AHB master state machine
+   // Bus state machine - runs while the next command is received
    typedef enum logic [1:0] {
-                             IDLE = 0, // Waiting for cmd
-                             ADDR,     // ADDR phase
-                             WAIT,     // Wait one cycle
-                             DATA      // DATA phase
+                             BIDLE = 0, // Waiting for command
+                             BUS,       // Overlapped ADDR/DATA phases
+                             RESP       // Queue response to host
                              } state_t;
 
-   // Local buffer sizes
-   localparam IWIDTH = 64;
-   localparam OWIDTH = 32;
+   // Local buffer sizes - room for a four word burst
+   localparam IWIDTH = 128;
+   localparam OWIDTH = 128;
+
+   // EE=11 is a four word INCR4 burst
+   localparam SIZE_BURST = 2'b11;
    
-   // Buffer for command and data
-   logic [31:0]                   addr;   // Save address for autoincrement
-   logic [7:0]                    cmd;    // Command to execute
+   // Incoming command
+   logic [7:0]                    cmd;    // Command being received
    logic [FIFO_PAYLOAD_WIDTH-1:0] icnt;   // Data in count
-   logic [$clog2(OWIDTH/8):0]     ocnt;   // Data out count
    logic [IWIDTH-1:0]             dati;   // Data in
-   logic [OWIDTH-1:0]             dato;   // Data out
+   logic                          have;   // Command byte received
+   logic                          full;   // Command complete, waiting for bus
    logic                          dvalid; // Is fifo data valid
+   logic                          stream; // Receiving extended payload
+   logic [FIFO_EXT_WIDTH-1:0]     scnt;   // Extended bytes left
+   logic                          sdata;  // Handoff carries 16 byte chunk
+   logic                          slast;  // Handoff ends command
+   wire                           last;   // Last byte of handoff valid
    wire                           busy;   // Suppress incoming data when needed
-   wire                           block;  // Block incoming while outgoing saturated
-   state_t                        state;  // State machine
+
+   // Command on bus
+   logic [31:0]                   addr;   // Last beat address for autoincrement
+   logic [7:0]                    bcmd;   // Command executing
+   logic [1:0]                    acnt;   // Address phases left to issue
+   logic [1:0]                    dcnt;   // Current data phase beat
+   logic                          dphase; // Data phase in progress
+   logic [1:0]                    daddr;  // Data phase byte lane
+   logic                          berr;   // Bus error during command
+   logic [IWIDTH-1:0]             wdat;   // Write beats, next in top word
+   logic [OWIDTH-1:0]             rdat;   // Read beats in host byte order
+   state_t                        state;  // Bus state machine
+
+   // Extended command on bus
+   logic                          bext;   // Extended command
+   logic                          bquiet; // Write chunk without response
+   logic [FIFO_EXT_WIDTH-5:0]     xcnt;   // Read chunks left to issue
+   logic                          xstat;  // Read status byte due
+   logic                          xerr;   // Error in earlier chunk
+
+   // Outgoing response
+   logic [$clog2(OWIDTH/8):0]     ocnt;   // Data out count
+   logic [OWIDTH-1:0]             dato;   // Data out
+   wire                           oready; // Room to load response
+
+   // Decoded command at handoff
+   wire                           burst;  // Four word burst
+   wire                           ext;    // Extended frame
+   wire [31:0]                    step;   // Autoincrement step
+   logic [31:0]                   start;  // First beat address
+   wire [FIFO_EXT_WIDTH-1:0]      xlen;   // Extended read response length
+
+   // Bursts step by word
+   assign burst = (cmd[1:0] == SIZE_BURST);
+   assign ext = fifo_ext (cmd[6:4], cmd);
+   assign step = burst ? 4 : (1 << cmd[1:0]);
+
+   // Whole chunks plus status
+   assign xlen = {dati[15:4], 4'h0} + 1;
    
-   // Assign busy signal
-   assign busy = (state != IDLE) || ((icnt <= 1) & dvalid);
+   // Last byte of command or write chunk on RDDATA
+   assign last = dvalid & (stream ? ((scnt == 1) | (cmd[3] & (scnt[3:0] == 1))) :
+                           have ? (icnt == 1) : (fifo_payload (RDDATA[6:4]) == 0));
    
-   // Block while outgoing saturated
-   assign block = WRFULL | (WREN & (ocnt != 0));
+   // Stop reading once a command is complete until the bus takes it
+   assign busy = full | last;
 
    // Always read when not busy and data is available
-   assign RDEN = !RDEMPTY & !busy & !block;
+   assign RDEN = !RDEMPTY & !busy;
 
    // Write when data is available and not full
    assign WREN = (ocnt != 0) & !WRFULL;
 
+   // Last byte leaving this cycle
+   assign oready = (ocnt == 0) | ((ocnt == 1) & WREN);
+
+   // Start address for command
+   always_comb
+     case (cmd[3:2])
+       2'b00: start = dati[31:0];
+       2'b10:
+         casez (cmd[1:0])
+           2'b00: start = dati[39:8];
+           2'b01: start = dati[47:16];
+           default: start = dati[63:32];
+         endcase
+       default: start = addr + step;
+     endcase
    
    always @(posedge CLK)
      if (!RESETn)
@@ -81,9 +151,18 @@ module ahb3lite_host_master
           dvalid <= 0;
           cmd <= 0;
           icnt <= 0;
+          have <= 0;
+          full <= 0;
+          stream <= 0;
           ocnt <= 0;
-          state <= IDLE;
+          state <= BIDLE;
           HTRANS <= HTRANS_IDLE;
+          dphase <= 0;
+          bext <= 0;
+          bquiet <= 0;
+          xcnt <= 0;
+          xstat <= 0;
+          xerr <= 0;
           addr <= 0;
           dati <= 0;
           dato <= 0;
@@ -106,178 +185,295 @@ module ahb3lite_host_master
                WRDATA <= dato[7:0];
                dato[OWIDTH-8-1:0] <= dato[OWIDTH-1:8];
             end
+
+          //
+          // INCOMING DATA FROM HOST FIFO
+          //
+          if (dvalid)
+            begin
+
+               // Extended payload
+               if (stream)
+                 begin
+                    dati <= {dati[IWIDTH-8-1:0], RDDATA};
+                    scnt <= scnt - 1;
+
+                    // Hand over each write chunk, then the end of stream
+                    if ((scnt == 1) | (cmd[3] & (scnt[3:0] == 1)))
+                      begin
+                         full <= 1;
+                         sdata <= cmd[3] & (scnt[3:0] == 1);
+                         slast <= (scnt == 1);
+                      end
+                    if (scnt == 1)
+                      stream <= 0;
+                 end
+               // First byte is command
+               else if (!have)
+                 begin
+                    // Save command
+                    cmd <= RDDATA;
+                    sdata <= 0;
+                    slast <= 1;
+                    
+                    // Decode payload count
+                    icnt <= fifo_payload (RDDATA[6:4]);
+
+                    // Zero byte command is complete
+                    if (RDDATA[6:4] == 0)
+                      full <= 1;
+                    else
+                      have <= 1;
+                 end
+               // Following icnt data is all payload
+               else
+                 begin
+                    // Shift in payload, decrement icnt
+                    dati <= {dati[IWIDTH-8-1:0], RDDATA};
+                    icnt <= icnt - 1;
+                    
+                    // All data is in
+                    if (icnt == 1)
+                      begin
+                         have <= 0;
+
+                         // Extended length follows
+                         if (ext & ({dati[7:0], RDDATA} != 0))
+                           begin
+                              stream <= 1;
+                              scnt <= {dati[7:0], RDDATA};
+                           end
+                         else
+                           full <= 1;
+                      end
+                 end
+            end // if (dvalid)
           
-          // State machine
+          // Bus state machine
           case (state)
-            IDLE:
-              //
-              // INCOMING DATA FROM HOST FIFO
-              //
-              if (dvalid)
+
+            //
+            // PROCESS HOST COMMAND
+            //
+            BIDLE:
+              // Next chunk of extended read
+              if (xcnt != 0)
                 begin
-                   
-                   // First byte is command
-                   if (icnt == 0)
+                   xcnt <= xcnt - 1;
+                   berr <= 0;
+                   dcnt <= 0;
+                   rdat <= 0;
+                   addr <= addr + 16;
+                   HWRITE <= 0;
+                   HADDR  <= addr + 4;
+                   HSIZE  <= HSIZE_WORD;
+                   HBURST <= (addr[3:0] == 4'hc) ? HBURST_INCR4 : HBURST_INCR;
+                   HTRANS <= HTRANS_NONSEQ;
+                   acnt   <= 3;
+                   state  <= BUS;
+                end
+              // Extended read header goes out first
+              else if (full & !(ext & !cmd[3] & !oready))
+                begin
+
+                   // Decode command: ABBBCDEE
+                   // 
+                   // A=interface (0/1) - ignore
+                   // BBB=data size
+                   // C=Read (0)/Write (1)
+                   // D=autoincrement (Autoincrement previously accessed address)
+                   // EE=transfer size
+                   //   00=byte
+                   //   01=hwrd
+                   //   10=word
+                   //   11=four word burst
+                   //
+                   full <= 0;
+                   bcmd <= cmd;
+                   bext <= ext;
+                   bquiet <= ext & cmd[3] & !slast;
+                   berr <= 0;
+                   dcnt <= 0;
+                   rdat <= 0;
+
+                   // Write data, top word first
+                   // NOTE: We only support aligned access
+                   casez (cmd[1:0])
+                     2'b00: wdat <= {{4{dati[7:0]}}, 96'h0};
+                     2'b01: wdat <= {{2{dati[15:0]}}, 96'h0};
+                     2'b10: wdat <= {dati[31:0], 96'h0};
+                     2'b11: wdat <= dati;
+                   endcase
+
+                   // Extended read - header then chunks from BIDLE
+                   if (ext & !cmd[3])
+                     begin
+                        WRDATA <= {cmd[7], FIFO_D2, FIFO_EXT_MASK[3:0]};
+                        dato[15:0] <= {xlen[7:0], xlen[15:8]};
+                        ocnt <= 3;
+                        xcnt <= dati[15:4];
+                        if (dati[15:4] == 0)
+                          begin
+                             xstat <= 1;
+                             state <= RESP;
+                          end
+                     end
+                   // Extended write without a chunk, or burst write
+                   // without autoincrement
+                   else if ((ext & !sdata) | (burst & (cmd[3:2] == 2'b10)))
                      begin
-                        // Save command
-                        cmd <= RDDATA;
-                        
-                        // Decode payload count
-                        icnt <= fifo_payload (RDDATA[6:4]);
-
-                        // If zero byte command we must switch states here
-                        if (RDDATA[6:4] == 0)
-                          state <= ADDR;
-                        
+                        berr <= !ext;
+                        state <= RESP;
                      end
-                   // Following icnt data is all payload
                    else
                      begin
-                        // Shift in payload, decrement icnt
-                        dati <= {dati[IWIDTH-8-1:0], RDDATA};
-                        icnt <= icnt - 1;
-                        
-                        // All data is in make state
-                        if (icnt == 1)
-                          state <= ADDR;                    
+                        // Autoincrement continues from the last beat
+                        addr <= burst ? start + 12 : start;
+
+                        // First address phase
+                        HWRITE <= cmd[3];
+                        HADDR  <= start;
+                        HPROT  <= 4'h3;
+                        HTRANS <= HTRANS_NONSEQ;
+                        if (burst)
+                          begin
+                             HSIZE  <= HSIZE_WORD;
+                             HBURST <= (start[3:0] == 0) ? HBURST_INCR4 : HBURST_INCR;
+                             acnt   <= 3;
+                          end
+                        else
+                          begin
+                             HSIZE  <= {1'b0, cmd[1:0]};
+                             HBURST <= HBURST_SINGLE;
+                             acnt   <= 0;
+                          end
+                        state <= BUS;
                      end
-                end // if (dvalid)
-            
+                end
+
             //
-            // PROCESS HOST COMMAND
+            // Overlap address phase N+1 with data phase N
             //
-            ADDR:
-              begin
-
-                 // Decode command: ABBBCDEE
-                 // 
-                 // A=interface (0/1) - ignore
-                 // BBB=data size
-                 // C=Read (0)/Write (1)
-                 // D=autoincrement (Autoincrement previously accessed address)
-                 // EE=transfer size
-                 //   00=byte
-                 //   01=hwrd
-                 //   10=word
-                 //
-                 case (cmd[3:2])
-                   2'b00: /* Read no autoincrement */
-                     begin
-                        HWRITE <= 0;
-                        HADDR  <= dati[31:0];
-                        addr   <= dati[31:0];
-                     end
-                   2'b01: /* Read w/ autoincrement*/
+            BUS:
+              if (HREADY)
+                begin
+
+                   // Data phase completes
+                   if (dphase)
                      begin
-                        HWRITE <= 0;
-                        HADDR  <= addr + (1 << cmd[1:0]);
-                        addr   <= addr + (1 << cmd[1:0]);
+                        if (HRESP == HRESP_ERROR)
+                          berr <= 1;
+                        else if (!HWRITE)
+                          casez (bcmd[1:0])
+                            2'b00:
+                              case (daddr)
+                                2'b00: rdat[7:0] <= HRDATA[7:0];
+                                2'b01: rdat[7:0] <= HRDATA[15:8];
+                                2'b10: rdat[7:0] <= HRDATA[23:16];
+                                2'b11: rdat[7:0] <= HRDATA[31:24];
+                              endcase
+                            2'b01:
+                              if (daddr[1])
+                                rdat[15:0] <= {HRDATA[23:16], HRDATA[31:24]};
+                              else
+                                rdat[15:0] <= {HRDATA[7:0], HRDATA[15:8]};
+                            default:
+                              rdat[dcnt*32 +: 32] <= {HRDATA[7:0], HRDATA[15:8], HRDATA[23:16], HRDATA[31:24]};
+                          endcase
+                        dcnt <= dcnt + 1;
                      end
-                   2'b10: /* Write no autoincrement */
+
+                   // Address phase moves to data phase
+                   dphase <= (HTRANS != HTRANS_IDLE);
+                   if (HTRANS != HTRANS_IDLE)
                      begin
-                        HWRITE <= 1;
-                        casez (cmd[1:0])
-                          2'b00: begin HADDR <= dati[39:8];  addr <= dati[39:8];  end
-                          2'b01: begin HADDR <= dati[47:16]; addr <= dati[47:16]; end
-                          2'b1?: begin HADDR <= dati[63:32]; addr <= dati[63:32]; end
-                        endcase
+                        daddr <= HADDR[1:0];
+                        HWDATA <= wdat[IWIDTH-1:IWIDTH-32];
+                        wdat <= {wdat[IWIDTH-32-1:0], 32'h0};
                      end
-                   2'b11: /* Write w/ autoincrement*/
+
+                   // Issue next beat, restart burst at 1KB boundary
+                   if ((HTRANS != HTRANS_IDLE) & (acnt != 0))
                      begin
-                        HWRITE <= 1;
-                        HADDR  <= addr + (1 << cmd[1:0]);
-                        addr   <= addr + (1 << cmd[1:0]);
+                        HADDR <= HADDR + 4;
+                        HTRANS <= (HADDR[9:2] == 8'hff) ? HTRANS_NONSEQ : HTRANS_SEQ;
+                        acnt <= acnt - 1;
                      end
-                 endcase // casez (cmd[3:0])
-                 
-                 // Common bus signals
-                 HBURST <= 0;
-                 HPROT  <= 4'h3;
-                 HTRANS <= HTRANS_NONSEQ;
-                 HSIZE  <= {1'b0, cmd[1:0]};
-                 
-                 // Move to data state
-                 state <= WAIT;
-              end // case: ADDR
+                   else
+                     HTRANS <= HTRANS_IDLE;
 
-            //
-            // Wait for transaction to latch
-            WAIT:
-              begin
-                 // Put data on bus regardless of slave HREADY
-                 // NOTE: We only support aligned access
-                 if (HWRITE)
-                   // Replicate across lanes
-                   casez (cmd[1:0])
-                     2'b00: HWDATA <= {dati[7:0], dati[7:0], dati[7:0], dati[7:0]};
-                     2'b01: HWDATA <= {dati[15:0], dati[15:0]};
-                     2'b1?: HWDATA <= dati[31:0];
-                   endcase
+                   // Last data phase done
+                   if (dphase & (HTRANS == HTRANS_IDLE))
+                     state <= RESP;
+                end
+              // Cancel remaining beats on first error cycle
+              else if (dphase & (HRESP == HRESP_ERROR))
+                begin
+                   HTRANS <= HTRANS_IDLE;
+                   acnt <= 0;
+                   berr <= 1;
+                end
 
-                 // Change bus state to IDLE
-                 HTRANS <= HTRANS_IDLE;
-                 state <= DATA;
-              end
-            
             //
-            // DATA state
+            // Queue response once previous is leaving
             //
-            DATA:
-              begin
-                 
-                 // Once client is ready check for error
-                 // Save data is no error
-                 if (HREADY)
-                   begin
-                      
-                      // Check for error
-                      if (HRESP == HRESP_ERROR)
-                        begin
-                           // Respond with error
-                           WRDATA <= {cmd[7], FIFO_D0, 3'h0, 1'b1};
-                           ocnt <= 1;
-                        end
-                      // Read data from bus, send to host
-                      else if (~HWRITE)
-                        begin
-                           casez (cmd[1:0])
-                             2'b00: begin
-                                case (HADDR[1:0])
-                                  2'b00: dato[7:0] <= HRDATA[7:0];
-                                  2'b01: dato[7:0] <= HRDATA[15:8];
-                                  2'b10: dato[7:0] <= HRDATA[23:16];
-                                  2'b11: dato[7:0] <= HRDATA[31:24];
-                                endcase // case (HADDR[1:0])
-                                WRDATA <= {cmd[7], FIFO_D1, 4'h0};
-                                ocnt <= 2; 
-                             end
-                             2'b01: begin
-                                if (HADDR[1])
-                                  dato[15:0] <= {HRDATA[23:16], HRDATA[31:24]};
-                                else
-                                  dato[15:0] <= {HRDATA[7:0], HRDATA[15:8]};
-                                WRDATA <= {cmd[7], FIFO_D2, 4'h0};
-                                ocnt <= 3; 
-                             end
-                             2'b1?: begin
-                                dato <= {HRDATA[7:0], HRDATA[15:8], HRDATA[23:16], HRDATA[31:24]};
-                                WRDATA <= {cmd[7], FIFO_D4, 4'h0};
-                                ocnt <= 5; 
-                             end
-                           endcase // casez (cmd[1:0])
-                        end
-                      else
-                        begin
-                           // Successful write, return success
-                           WRDATA <= {cmd[7], FIFO_D0, 4'h0};
-                           ocnt <= 1;
-                        end
- 
-                      // Move to response state
-                      state <= IDLE;
-                   end
-              end // case: DATA
-            default: state <= IDLE;
+            RESP:
+              // Extended write chunk, error reported at end
+              if (bquiet)
+                begin
+                   xerr <= xerr | berr;
+                   state <= BIDLE;
+                end
+              else if (oready)
+                begin
+                   // Extended read status after last chunk
+                   if (xstat)
+                     begin
+                        WRDATA <= {7'h0, xerr};
+                        ocnt <= 1;
+                        xerr <= 0;
+                        xstat <= 0;
+                        bext <= 0;
+                     end
+                   // Extended read chunk without header
+                   else if (bext & !bcmd[3])
+                     begin
+                        WRDATA <= rdat[7:0];
+                        dato <= {8'h0, rdat[OWIDTH-1:8]};
+                        ocnt <= 16;
+                        xerr <= xerr | berr;
+                        xstat <= (xcnt == 0);
+                     end
+                   // Respond with error
+                   else if (berr | xerr)
+                     begin
+                        WRDATA <= {bcmd[7], FIFO_D0, 3'h0, 1'b1};
+                        ocnt <= 1;
+                        xerr <= 0;
+                     end
+                   // Successful write, return success
+                   else if (bcmd[3])
+                     begin
+                        WRDATA <= {bcmd[7], FIFO_D0, 4'h0};
+                        ocnt <= 1;
+                     end
+                   // Read data from bus, send to host
+                   else
+                     begin
+                        dato <= rdat;
+                        case (bcmd[1:0])
+                          2'b00: begin WRDATA <= {bcmd[7], FIFO_D1, 4'h0};  ocnt <= 2;  end
+                          2'b01: begin WRDATA <= {bcmd[7], FIFO_D2, 4'h0};  ocnt <= 3;  end
+                          2'b10: begin WRDATA <= {bcmd[7], FIFO_D4, 4'h0};  ocnt <= 5;  end
+                          2'b11: begin WRDATA <= {bcmd[7], FIFO_D16, 4'h0}; ocnt <= 17; end
+                        endcase
+                     end
+
+                   // Status follows last chunk
+                   if (!(bext & !bcmd[3] & !xstat & (xcnt == 0)))
+                     state <= BIDLE;
+                end
+            default: state <= BIDLE;
               
           endcase // case (state)
        end /* !RESETn */
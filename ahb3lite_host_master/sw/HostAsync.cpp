@@ -0,0 +1,241 @@
+/**
+ *  Asynchronous client for ahb3lite_host_master.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <string.h>
+
+#include "HostAsync.h"
+#include "err.h"
+
+bool HostFuture::Ready (void)
+{
+  return f.wait_for (std::chrono::seconds (0)) == std::future_status::ready;
+}
+
+uint32_t HostFuture::Get (int *err)
+{
+  host_result_t r;
+
+  // Command may still be sitting in the batch
+  if (!Ready ())
+    host->Kick ();
+  r = f.get ();
+  if (err)
+    *err = r.err;
+  return r.val;
+}
+
+HostAsync::HostAsync (HostLink *link, uint8_t iface, int window, int batch)
+{
+  this->link = link;
+  this->iface = iface;
+  this->window = window;
+  this->batch = batch;
+  outstanding = unsent = inflight = errors = 0;
+  last = 0;
+  valid = false;
+  stop = false;
+  cmds = autoinc = tx_bytes = rx_bytes = 0;
+  peak = 0;
+  pthread_mutex_init (&lock, NULL);
+  pthread_mutex_init (&tx_lock, NULL);
+  pthread_cond_init (&cond, NULL);
+  if (pthread_create (&thread_id, NULL, [](void *arg) -> void * {
+        ((HostAsync *)arg)->Receive ();
+        return NULL;
+      }, this))
+    fail ("HostAsync: failed to start receive thread");
+}
+
+HostAsync::~HostAsync ()
+{
+  // Drain then stop receive thread
+  Flush ();
+  pthread_mutex_lock (&lock);
+  stop = true;
+  pthread_cond_broadcast (&cond);
+  pthread_mutex_unlock (&lock);
+  pthread_join (thread_id, NULL);
+  pthread_cond_destroy (&cond);
+  pthread_mutex_destroy (&tx_lock);
+  pthread_mutex_destroy (&lock);
+}
+
+void HostAsync::Queue (bool write, uint32_t addr, uint8_t size, uint32_t data, completion_t c)
+{
+  int n = 1 << size;
+  int resp = HOST_RESP_LEN (write, size);
+  uint8_t buf[HOST_CMD_MAX];
+  bool inc, kick;
+
+  // Only aligned byte/hword/word supported
+  if ((size > HOST_WORD) || (addr & (n - 1)))
+    fail ("HostAsync: bad access %08X size=%d", addr, size);
+
+  // Wait for window credit
+  pthread_mutex_lock (&lock);
+  while (outstanding && (outstanding + resp > window)) {
+    if (unsent) {
+      pthread_mutex_unlock (&lock);
+      Kick ();
+      pthread_mutex_lock (&lock);
+      continue;
+    }
+    pthread_cond_wait (&cond, &lock);
+  }
+
+  // host_master adds the current size to the previous address
+  inc = valid && (addr == last + n);
+  if (inc)
+    autoinc++;
+  obuf.insert (obuf.end (), buf, buf + HostCommand (buf, iface, write, inc, addr, size, data));
+  last = addr;
+  valid = true;
+
+  // Add to completion queue
+  c.size = size;
+  c.write = write;
+  cq.push_back (c);
+  outstanding += resp;
+  if (outstanding > peak)
+    peak = outstanding;
+  unsent++;
+  cmds++;
+  kick = ((int)obuf.size () >= batch);
+  pthread_mutex_unlock (&lock);
+
+  if (kick)
+    Kick ();
+}
+
+void HostAsync::Kick (void)
+{
+  std::vector<uint8_t> out;
+
+  // Keep link order matching completion order
+  pthread_mutex_lock (&tx_lock);
+  pthread_mutex_lock (&lock);
+  out.swap (obuf);
+  inflight += unsent;
+  unsent = 0;
+  pthread_cond_broadcast (&cond);
+  pthread_mutex_unlock (&lock);
+  if (!out.empty ()) {
+    link->Send (out.data (), out.size ());
+    tx_bytes += out.size ();
+  }
+  pthread_mutex_unlock (&tx_lock);
+}
+
+void HostAsync::Receive (void)
+{
+  uint8_t buf[256];
+  uint32_t val;
+  completion_t c;
+  int i, n, len = 0;
+
+  while (1) {
+
+    // Sleep until something is on the wire
+    pthread_mutex_lock (&lock);
+    while (!inflight && !stop)
+      pthread_cond_wait (&cond, &lock);
+    if (!inflight) {
+      pthread_mutex_unlock (&lock);
+      break;
+    }
+    pthread_mutex_unlock (&lock);
+
+    n = link->Recv (&buf[len], sizeof (buf) - len);
+    len += n;
+    rx_bytes += n;
+
+    // Complete whole responses in order
+    while (len) {
+      pthread_mutex_lock (&lock);
+      if (!inflight)
+        fail ("HostAsync: unsolicited response %02X", buf[0]);
+      n = HostResponse (buf[0], iface, cq.front ().write, cq.front ().size);
+      if (n < 0)
+        fail ("HostAsync: unexpected response %02X", buf[0]);
+      if (len < n + 1) {
+        pthread_mutex_unlock (&lock);
+        break;
+      }
+      c = cq.front ();
+      pthread_mutex_unlock (&lock);
+
+      // Big endian data
+      for (val = 0, i = 1; i <= n; i++)
+        val = (val << 8) | buf[i];
+      if (c.cb)
+        c.cb (c.arg, val, buf[0] & RESP_ERR);
+      else if (c.p) {
+        c.p->set_value ((host_result_t){ val, buf[0] & RESP_ERR });
+        delete c.p;
+      }
+
+      // Retire after completion so Flush covers callbacks
+      pthread_mutex_lock (&lock);
+      cq.pop_front ();
+      inflight--;
+      outstanding -= HOST_RESP_LEN (c.write, c.size);
+      if (buf[0] & RESP_ERR)
+        errors++;
+      pthread_cond_broadcast (&cond);
+      pthread_mutex_unlock (&lock);
+
+      // Shift remaining
+      len -= n + 1;
+      memmove (buf, &buf[n + 1], len);
+    }
+  }
+}
+
+HostFuture HostAsync::Read (uint32_t addr, uint8_t size)
+{
+  completion_t c = { 0, false, new std::promise<host_result_t>, NULL, NULL };
+  HostFuture f (this, c.p->get_future ());
+
+  Queue (false, addr, size, 0, c);
+  return f;
+}
+
+HostFuture HostAsync::Write (uint32_t addr, uint8_t size, uint32_t data)
+{
+  completion_t c = { 0, true, new std::promise<host_result_t>, NULL, NULL };
+  HostFuture f (this, c.p->get_future ());
+
+  Queue (true, addr, size, data, c);
+  return f;
+}
+
+void HostAsync::Read (uint32_t addr, uint8_t size, host_cb_t cb, void *arg)
+{
+  completion_t c = { 0, false, NULL, cb, arg };
+  Queue (false, addr, size, 0, c);
+}
+
+void HostAsync::Write (uint32_t addr, uint8_t size, uint32_t data, host_cb_t cb, void *arg)
+{
+  completion_t c = { 0, true, NULL, cb, arg };
+  Queue (true, addr, size, data, c);
+}
+
+int HostAsync::Flush (void)
+{
+  int ret;
+
+  Kick ();
+  pthread_mutex_lock (&lock);
+  while (!cq.empty ())
+    pthread_cond_wait (&cond, &lock);
+  ret = errors;
+  errors = 0;
+  pthread_mutex_unlock (&lock);
+  return ret;
+}
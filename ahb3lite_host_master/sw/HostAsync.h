@@ -0,0 +1,116 @@
+/**
+ *  Asynchronous client for ahb3lite_host_master. Accesses return a
+ *  future (or run a callback) instead of waiting for their response.
+ *  Response bytes in flight are bounded by window, which must fit the
+ *  FPGA TX FIFO - the HOST_WINDOW default of 64 bytes keeps about a
+ *  dozen reads outstanding, issue blocks once it is full. A receive
+ *  thread matches responses against a completion queue kept in command
+ *  order.
+ *
+ *  Issue from a single thread, callbacks run on the receive thread.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+#ifndef HOSTASYNC_H
+#define HOSTASYNC_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <deque>
+#include <vector>
+#include <future>
+
+#include "HostLink.h"
+#include "HostMaster.h"
+
+// Queued command bytes before they are sent
+#define HOST_BATCH    256
+
+// Completed access
+typedef struct {
+  uint32_t val;
+  int err;
+} host_result_t;
+
+// Completion callback
+typedef void (*host_cb_t)(void *arg, uint32_t val, int err);
+
+class HostAsync;
+
+class HostFuture {
+
+ private:
+  HostAsync *host;
+  std::future<host_result_t> f;
+
+ public:
+  HostFuture (HostAsync *host, std::future<host_result_t> &&f) : host (host), f (std::move (f)) {}
+  bool Ready (void);
+
+  // Send anything queued and wait for result
+  uint32_t Get (int *err=NULL);
+};
+
+class HostAsync {
+
+ private:
+  HostLink *link;
+  uint8_t iface;
+  int window, batch;
+
+  // Completion queue in command order
+  typedef struct {
+    uint8_t size;
+    bool write;
+    std::promise<host_result_t> *p;
+    host_cb_t cb;
+    void *arg;
+  } completion_t;
+  std::deque<completion_t> cq;
+
+  // Commands not yet sent
+  std::vector<uint8_t> obuf;
+
+  // Response bytes reserved, commands queued/sent but not complete
+  int outstanding, unsent, inflight, errors;
+
+  // Autoincrement tracking
+  uint32_t last;
+  bool valid;
+
+  // Receive thread
+  bool stop;
+  pthread_t thread_id;
+  pthread_mutex_t lock, tx_lock;
+  pthread_cond_t cond;
+
+  void Queue (bool write, uint32_t addr, uint8_t size, uint32_t data, completion_t c);
+  void Receive (void);
+
+ public:
+  // Statistics
+  uint64_t cmds, autoinc, tx_bytes, rx_bytes;
+  int peak;
+
+  // window - response bytes in flight, batch - command bytes queued per send
+  HostAsync (HostLink *link, uint8_t iface=0, int window=HOST_WINDOW, int batch=HOST_BATCH);
+  ~HostAsync ();
+
+  // Future based access
+  HostFuture Read (uint32_t addr, uint8_t size);
+  HostFuture Write (uint32_t addr, uint8_t size, uint32_t data);
+
+  // Callback based access, cb may be NULL
+  void Read (uint32_t addr, uint8_t size, host_cb_t cb, void *arg);
+  void Write (uint32_t addr, uint8_t size, uint32_t data, host_cb_t cb, void *arg);
+
+  // Send queued commands
+  void Kick (void);
+
+  // Wait for all completions, return bus error count
+  int Flush (void);
+};
+
+#endif /* HOSTASYNC_H */
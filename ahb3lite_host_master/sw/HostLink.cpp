@@ -0,0 +1,191 @@
+/**
+ *  Byte transports between host software and the FPGA host FIFO.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+
+#include "HostLink.h"
+#include "Socket.h"
+#include "err.h"
+
+FDLink::~FDLink ()
+{
+  if (fd >= 0)
+    close (fd);
+}
+
+void FDLink::Send (const uint8_t *buf, int len)
+{
+  int n;
+
+  while (len) {
+    n = write (fd, buf, len);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      fail ("HostLink write failed: %d", errno);
+    }
+    buf += n;
+    len -= n;
+  }
+}
+
+int FDLink::Recv (uint8_t *buf, int max)
+{
+  int n;
+
+  do {
+    n = read (fd, buf, max);
+  } while ((n < 0) && (errno == EINTR));
+  if (n <= 0)
+    fail ("HostLink closed");
+  return n;
+}
+
+SerialLink::SerialLink (const char *dev, int baud)
+{
+  struct termios2 tio;
+
+  fd = open (dev, O_RDWR | O_NOCTTY);
+  if (fd < 0)
+    fail ("Failed to open %s", dev);
+
+  // Raw 8N1, BOTHER allows non-standard rates
+  if (ioctl (fd, TCGETS2, &tio) < 0)
+    fail ("TCGETS2 failed on %s", dev);
+  tio.c_iflag = 0;
+  tio.c_oflag = 0;
+  tio.c_lflag = 0;
+  tio.c_cflag = CS8 | CREAD | CLOCAL | BOTHER;
+  tio.c_ispeed = tio.c_ospeed = baud;
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+  if (ioctl (fd, TCSETS2, &tio) < 0)
+    fail ("Failed to set %d baud on %s", baud, dev);
+
+  // Drop stale bytes
+  ioctl (fd, TCFLSH, TCIOFLUSH);
+}
+
+SocketLink::SocketLink (const char *endpoint)
+{
+  fd = SocketConnect (endpoint);
+  if (fd < 0)
+    fail ("Failed to connect to %s", endpoint);
+}
+
+SimLink::SimLink (void (*pump)(void *arg), void *arg, int timeout)
+{
+  this->pump = pump;
+  this->arg = arg;
+  this->timeout = timeout;
+  pthread_mutex_init (&lock, NULL);
+}
+
+SimLink::~SimLink ()
+{
+  pthread_mutex_destroy (&lock);
+}
+
+// Send may run on a different thread than Recv/pump
+void SimLink::Send (const uint8_t *buf, int len)
+{
+  pthread_mutex_lock (&lock);
+  tx.insert (tx.end (), buf, buf + len);
+  pthread_mutex_unlock (&lock);
+}
+
+int SimLink::Recv (uint8_t *buf, int max)
+{
+  int i;
+
+  // Run simulation until response shows up
+  for (i = 0; rx.empty (); i++) {
+    if (timeout && (i == timeout))
+      fail ("SimLink timeout");
+    pump (arg);
+  }
+  for (i = 0; (i < max) && !rx.empty (); i++) {
+    buf[i] = rx.front ();
+    rx.pop_front ();
+  }
+  return i;
+}
+
+bool SimLink::Get (uint8_t *c)
+{
+  bool ret = false;
+
+  pthread_mutex_lock (&lock);
+  if (!tx.empty ()) {
+    *c = tx.front ();
+    tx.pop_front ();
+    ret = true;
+  }
+  pthread_mutex_unlock (&lock);
+  return ret;
+}
+
+void SimLink::Put (uint8_t c)
+{
+  rx.push_back (c);
+}
+
+HostWindow::HostWindow (HostLink *link, int window, int isize)
+{
+  this->link = link;
+  this->window = window;
+  outstanding = 0;
+  ibuf.resize (isize);
+  ilen = 0;
+  tx_bytes = rx_bytes = 0;
+}
+
+void HostWindow::Reserve (int resp)
+{
+  // Keep response bytes in flight bounded
+  if (outstanding && (outstanding + resp > window)) {
+    Send ();
+    Collect (window / 2);
+  }
+  outstanding += resp;
+}
+
+void HostWindow::Send (void)
+{
+  if (obuf.empty ())
+    return;
+  link->Send (obuf.data (), obuf.size ());
+  tx_bytes += obuf.size ();
+  obuf.clear ();
+}
+
+void HostWindow::Collect (int keep)
+{
+  int n;
+
+  while (1) {
+
+    // Consume complete responses
+    while (ilen && ((n = Consume ()) > 0)) {
+      ilen -= n;
+      memmove (&ibuf[0], &ibuf[n], ilen);
+    }
+    if (outstanding <= keep)
+      break;
+
+    // Wait for more
+    n = link->Recv (&ibuf[ilen], ibuf.size () - ilen);
+    ilen += n;
+    rx_bytes += n;
+  }
+}
@@ -0,0 +1,116 @@
+/**
+ *  Byte transports between host software and the FPGA host FIFO. The
+ *  same client code runs against a serial device, a TCP/Unix endpoint
+ *  exported by UARTServer or an in-process simulation.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+#ifndef HOSTLINK_H
+#define HOSTLINK_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+// Response bytes in flight, must fit the FPGA TX FIFO
+#define HOST_WINDOW   64
+
+class HostLink {
+
+ public:
+  virtual ~HostLink () {}
+
+  // Send all bytes
+  virtual void Send (const uint8_t *buf, int len) = 0;
+
+  // Block until at least one byte arrives, return count
+  virtual int Recv (uint8_t *buf, int max) = 0;
+};
+
+// File descriptor backed link
+class FDLink : public HostLink {
+
+ protected:
+  int fd;
+
+ public:
+  FDLink () : fd (-1) {}
+  ~FDLink ();
+  void Send (const uint8_t *buf, int len);
+  int Recv (uint8_t *buf, int max);
+};
+
+// Serial device in raw mode, arbitrary baud (ie 12000000)
+class SerialLink : public FDLink {
+
+ public:
+  SerialLink (const char *dev, int baud);
+};
+
+// Endpoint exported by UARTServer - "2345" or "unix:/path"
+class SocketLink : public FDLink {
+
+ public:
+  SocketLink (const char *endpoint);
+};
+
+// In-process link - pump advances the simulation
+class SimLink : public HostLink {
+
+ private:
+  std::deque<uint8_t> tx, rx;
+  pthread_mutex_t lock;
+  void (*pump)(void *arg);
+  void *arg;
+  int timeout;
+
+ public:
+  // timeout in pump calls, 0 waits forever
+  SimLink (void (*pump)(void *arg), void *arg, int timeout=1000000);
+  ~SimLink ();
+  void Send (const uint8_t *buf, int len);
+  int Recv (uint8_t *buf, int max);
+
+  // Bench side - take byte headed to the FPGA, return byte to host
+  bool Get (uint8_t *c);
+  void Put (uint8_t c);
+};
+
+// Command/response client on a link. Commands are queued and sent in
+// one write, the response bytes in flight are kept within window.
+class HostWindow {
+
+ protected:
+  HostLink *link;
+  int window, outstanding;
+
+  // Commands not yet sent
+  std::vector<uint8_t> obuf;
+
+  // Partially received response
+  std::vector<uint8_t> ibuf;
+  int ilen;
+
+  HostWindow (HostLink *link, int window, int isize);
+  virtual ~HostWindow () {}
+
+  // Reserve resp bytes before queueing a command, long responses go alone
+  void Reserve (int resp);
+  void Send (void);
+
+  // Wait until at most keep response bytes are in flight
+  void Collect (int keep);
+
+  // Match the response at the head of ibuf, return bytes used or 0 if
+  // incomplete. Releases its reserved bytes.
+  virtual int Consume (void) = 0;
+
+ public:
+  // Statistics
+  uint64_t tx_bytes, rx_bytes;
+};
+
+#endif /* HOSTLINK_H */
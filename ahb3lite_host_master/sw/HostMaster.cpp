@@ -0,0 +1,365 @@
+/**
+ *  Host client for ahb3lite_host_master.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <string.h>
+
+#include "HostMaster.h"
+#include "err.h"
+
+// Payload bytes for BBB - host_fifo_pkg::fifo_payload
+const int fifo_payload[8] = { 0, 1, 2, 4, 5, 6, 8, 16 };
+
+// Data only payload for autoincrement writes
+static const uint8_t data_code[3] = { FIFO_D1, FIFO_D2, FIFO_D4 };
+
+// Address + data payload
+static const uint8_t addr_data_code[3] = { FIFO_D5, FIFO_D6, FIFO_D8 };
+
+// Widest aligned access which fits, return bytes
+int HostMaster::NextSize (uint32_t addr, int len, bool write, uint8_t *size)
+{
+  // Streams and write bursts only autoincrement, first word sets the address
+  bool inc = valid && (addr == last + 4);
+
+  if (stream && inc && !(addr & 3) && (len >= 32)) {
+    *size = HOST_STREAM;
+    return (len > HOST_STREAM_MAX) ? HOST_STREAM_MAX : len & ~15;
+  }
+  if (burst && !(addr & 3) && (len >= 16) && (!write || inc))
+    *size = HOST_BURST;
+  else if (!(addr & 3) && (len >= 4))
+    *size = HOST_WORD;
+  else if (!(addr & 1) && (len >= 2))
+    *size = HOST_HWORD;
+  else
+    *size = HOST_BYTE;
+  return HOST_BYTES (*size);
+}
+
+HostMaster::HostMaster (HostLink *link, uint8_t iface, int window)
+  : HostWindow (link, window, HOST_STREAM_MAX + 256)
+{
+  this->iface = iface;
+  last = 0;
+  valid = false;
+  errors = 0;
+  cmds = autoinc = bursts = streams = 0;
+  burst = stream = false;
+}
+
+int HostCommand (uint8_t *buf, uint8_t iface, bool write, bool inc,
+                 uint32_t addr, uint8_t size, uint32_t data)
+{
+  int i, len = 0;
+  uint8_t cmd = (iface ? CMD_IFACE : 0) | size;
+
+  // Pick payload
+  if (inc)
+    cmd |= CMD_AUTOINC;
+  if (write)
+    cmd |= CMD_WRITE | ((inc ? data_code[size] : addr_data_code[size]) << 4);
+  else
+    cmd |= (inc ? FIFO_D0 : FIFO_D4) << 4;
+
+  // Command then big endian address/data
+  buf[len++] = cmd;
+  if (!inc)
+    for (i = 24; i >= 0; i -= 8)
+      buf[len++] = addr >> i;
+  if (write)
+    for (i = ((1 << size) - 1) * 8; i >= 0; i -= 8)
+      buf[len++] = data >> i;
+  return len;
+}
+
+int HostBurst (uint8_t *buf, uint8_t iface, bool write, bool inc,
+               uint32_t addr, const uint32_t *data)
+{
+  int i, j, len = 0;
+  uint8_t cmd = (iface ? CMD_IFACE : 0) | HOST_BURST;
+
+  // Read takes address or autoincrements, write is data only
+  if (inc)
+    cmd |= CMD_AUTOINC;
+  if (write)
+    cmd |= CMD_WRITE | (FIFO_D16 << 4);
+  else
+    cmd |= (inc ? FIFO_D0 : FIFO_D4) << 4;
+
+  // Command then big endian address or words
+  buf[len++] = cmd;
+  if (!write && !inc)
+    for (i = 24; i >= 0; i -= 8)
+      buf[len++] = addr >> i;
+  if (write)
+    for (j = 0; j < 4; j++)
+      for (i = 24; i >= 0; i -= 8)
+        buf[len++] = data[j] >> i;
+  return len;
+}
+
+int HostStream (uint8_t *buf, uint8_t iface, bool write, int len, const uint32_t *data)
+{
+  int i, j, n = 0;
+
+  // Extended header, writes carry data and reads a byte count
+  buf[n++] = (iface ? CMD_IFACE : 0) | (write ? CMD_WRITE : 0) | CMD_EXT;
+  buf[n++] = (write ? len : 2) >> 8;
+  buf[n++] = (write ? len : 2);
+  if (!write) {
+    buf[n++] = len >> 8;
+    buf[n++] = len;
+  }
+  else
+    for (j = 0; j < len / 4; j++)
+      for (i = 24; i >= 0; i -= 8)
+        buf[n++] = data[j] >> i;
+  return n;
+}
+
+int HostFrameLen (const uint8_t *buf, int len)
+{
+  if (!len)
+    return 0;
+  if (!HOST_EXT (buf[0]))
+    return 1 + fifo_payload[(buf[0] >> 4) & 7];
+  if (len < 3)
+    return 0;
+  return 3 + ((buf[1] << 8) | buf[2]);
+}
+
+int HostResponse (uint8_t hdr, uint8_t iface, bool write, uint8_t size)
+{
+  uint8_t code = (hdr >> 4) & 7;
+
+  if (((hdr & CMD_IFACE) != (iface ? CMD_IFACE : 0)) || (hdr & 0xe))
+    return -1;
+  if (hdr & RESP_ERR)
+    return (code == FIFO_D0) ? 0 : -1;
+  if (fifo_payload[code] != (write ? 0 : HOST_BYTES (size)))
+    return -1;
+  return fifo_payload[code];
+}
+
+// Unpack big endian words
+static void unpack (const uint8_t *buf, int n, uint32_t *dst)
+{
+  uint32_t val;
+  int i;
+
+  for (val = 0, i = 0; i < n; i++) {
+    val = (val << 8) | buf[i];
+    if (((i & 3) == 3) || (i == n - 1)) {
+      dst[i >> 2] = val;
+      val = 0;
+    }
+  }
+}
+
+void HostMaster::Queue (bool write, uint32_t addr, uint8_t size, const uint32_t *data,
+                        uint32_t *dst, int len)
+{
+  int n = (size >= HOST_BURST) ? 4 : 1 << size;
+  int resp = (size == HOST_STREAM) ? HOST_STREAM_RESP (write, len) : HOST_RESP_LEN (write, size);
+  uint8_t buf[HOST_CMD_MAX];
+  size_t off;
+  bool inc;
+
+  // Only aligned byte/hword/word/burst/stream supported
+  if ((size > HOST_STREAM) || (addr & (n - 1)))
+    fail ("HostMaster: bad access %08X size=%d", addr, size);
+  if ((size == HOST_STREAM) && ((len <= 0) || (len > HOST_STREAM_MAX) || (len & 15)))
+    fail ("HostMaster: bad stream %08X len=%d", addr, len);
+
+  // Long streams go alone
+  Reserve (resp);
+
+  // host_master adds the current size to the previous address
+  inc = valid && (addr == last + n);
+  if (inc)
+    autoinc++;
+  if (size == HOST_STREAM) {
+    if (!inc)
+      fail ("HostMaster: stream %08X must autoincrement", addr);
+    off = obuf.size ();
+    obuf.resize (off + len + 5);
+    obuf.resize (off + HostStream (&obuf[off], iface, write, len, data));
+    streams++;
+  }
+  else if (size == HOST_BURST) {
+    if (write && !inc)
+      fail ("HostMaster: burst write %08X must autoincrement", addr);
+    obuf.insert (obuf.end (), buf, buf + HostBurst (buf, iface, write, inc, addr, data));
+    bursts++;
+  }
+  else
+    obuf.insert (obuf.end (), buf, buf + HostCommand (buf, iface, write, inc, addr, size, write ? *data : 0));
+
+  // Save response destination
+  pending.push_back ((pending_t){ dst, size, write, len, resp });
+
+  // Bursts and streams leave the address on the last word
+  if (size == HOST_STREAM)
+    last = addr + len - 4;
+  else
+    last = (size == HOST_BURST) ? addr + 12 : addr;
+  valid = true;
+  cmds++;
+}
+
+int HostMaster::Consume (void)
+{
+  uint8_t hdr = ibuf[0];
+  int n;
+
+  if (pending.empty ())
+    return 0;
+  pending_t &p = pending.front ();
+
+  // Extended read - length, data then status
+  if ((p.size == HOST_STREAM) && !p.write) {
+    if ((hdr & ~CMD_IFACE) != CMD_EXT)
+      fail ("HostMaster: unexpected response %02X", hdr);
+    if (ilen < 3)
+      return 0;
+    n = HostFrameLen (ibuf.data (), ilen);
+    if (n != p.resp)
+      fail ("HostMaster: stream length %d != %d", n, p.resp);
+    if (ilen < n)
+      return 0;
+    if (ibuf[n - 1] & RESP_ERR)
+      errors++;
+    else if (p.dst)
+      unpack (&ibuf[3], p.len, p.dst);
+  }
+  else {
+    n = HostResponse (hdr, iface, p.write, p.size);
+    if (n < 0)
+      fail ("HostMaster: unexpected response %02X", hdr);
+    if (ilen < ++n)
+      return 0;
+
+    // Save big endian data
+    if (hdr & RESP_ERR)
+      errors++;
+    else if (p.dst)
+      unpack (&ibuf[1], n - 1, p.dst);
+  }
+  outstanding -= p.resp;
+  pending.pop_front ();
+  return n;
+}
+
+void HostMaster::Read (uint32_t addr, uint8_t size, uint32_t *dst)
+{
+  Queue (false, addr, size, NULL, dst);
+}
+
+void HostMaster::Write (uint32_t addr, uint8_t size, uint32_t data)
+{
+  Queue (true, addr, size, &data, NULL);
+}
+
+void HostMaster::ReadBurst (uint32_t addr, uint32_t *dst)
+{
+  Queue (false, addr, HOST_BURST, NULL, dst);
+}
+
+void HostMaster::WriteBurst (uint32_t addr, const uint32_t *data)
+{
+  Queue (true, addr, HOST_BURST, data, NULL);
+}
+
+void HostMaster::ReadStream (uint32_t addr, uint32_t *dst, int len)
+{
+  Queue (false, addr, HOST_STREAM, NULL, dst, len);
+}
+
+void HostMaster::WriteStream (uint32_t addr, const uint32_t *data, int len)
+{
+  Queue (true, addr, HOST_STREAM, data, NULL, len);
+}
+
+int HostMaster::Flush (void)
+{
+  int ret;
+
+  Send ();
+  Collect (0);
+  ret = errors;
+  errors = 0;
+  return ret;
+}
+
+uint32_t HostMaster::Read32 (uint32_t addr)
+{
+  uint32_t val = 0;
+
+  Read (addr, HOST_WORD, &val);
+  Flush ();
+  return val;
+}
+
+int HostMaster::Write32 (uint32_t addr, uint32_t data)
+{
+  Write (addr, HOST_WORD, data);
+  return Flush ();
+}
+
+int HostMaster::ReadBlock (uint32_t addr, uint8_t *buf, int len)
+{
+  std::vector<uint32_t> val;
+  std::vector<int> cnt;
+  uint8_t size;
+  int i, j, n;
+
+  // Sub-word accesses at either end take a word each
+  val.resize (len / 4 + 8);
+
+  // Queue everything then wait once
+  for (j = 0, n = 0; n < len; n += i, j += (i + 3) / 4) {
+    i = NextSize (addr + n, len - n, false, &size);
+    if (size == HOST_STREAM)
+      ReadStream (addr + n, &val[j], i);
+    else
+      Read (addr + n, size, &val[j]);
+    cnt.push_back (i);
+  }
+  n = Flush ();
+
+  // Unpack little endian
+  for (j = 0, i = 0; i < (int)cnt.size (); i++) {
+    memcpy (buf, &val[j], cnt[i]);
+    buf += cnt[i];
+    j += (cnt[i] + 3) / 4;
+  }
+  return n;
+}
+
+int HostMaster::WriteBlock (uint32_t addr, const uint8_t *buf, int len)
+{
+  uint32_t data[HOST_STREAM_MAX / 4];
+  uint8_t size;
+  int i;
+
+  while (len) {
+    i = NextSize (addr, len, true, &size);
+    memset (data, 0, 4);
+    memcpy (data, buf, i);
+    if (size == HOST_STREAM)
+      WriteStream (addr, data, i);
+    else if (size == HOST_BURST)
+      WriteBurst (addr, data);
+    else
+      Write (addr, size, data[0]);
+    buf += i;
+    addr += i;
+    len -= i;
+  }
+  return Flush ();
+}
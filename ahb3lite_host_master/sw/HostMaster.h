@@ -0,0 +1,147 @@
+/**
+ *  Host client for ahb3lite_host_master. Accesses are packed into the
+ *  ABBBCDEE command format, sequential accesses use autoincrement and
+ *  queued commands are sent in one write while responses are matched
+ *  back in order. With burst set, aligned block transfers move four
+ *  words per command. With stream set, they move up to HOST_STREAM_MAX
+ *  bytes per extended frame.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+#ifndef HOSTMASTER_H
+#define HOSTMASTER_H
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+#include "HostLink.h"
+
+// Transfer size (EE)
+#define HOST_BYTE     0
+#define HOST_HWORD    1
+#define HOST_WORD     2
+#define HOST_BURST    3  // Four words, INCR4
+#define HOST_STREAM   4  // Extended frame of bursts
+
+// Bytes transferred for size
+#define HOST_BYTES(size)  (((size) == HOST_BURST) ? 16 : 1 << (size))
+
+// host_fifo_pkg payload counts (BBB)
+#define FIFO_D0       0
+#define FIFO_D1       1
+#define FIFO_D2       2
+#define FIFO_D4       3
+#define FIFO_D5       4
+#define FIFO_D6       5
+#define FIFO_D8       6
+#define FIFO_D16      7
+
+// Payload bytes for BBB
+extern const int fifo_payload[8];
+
+// Command fields
+#define CMD_IFACE     0x80
+#define CMD_WRITE     0x08
+#define CMD_AUTOINC   0x04
+#define RESP_ERR      0x01
+
+// Extended frame - D2 count with low bits set, 16bit length follows
+#define CMD_EXT       ((FIFO_D2 << 4) | 0x07)
+#define EXT_MASK      0x77
+#define HOST_EXT(hdr) (((hdr) & EXT_MASK) == CMD_EXT)
+
+// Stream bytes per command, multiple of 16 (host_master limit 65520)
+#define HOST_STREAM_MAX   4096
+
+// Longest command - cmd + four words
+#define HOST_CMD_MAX  17
+
+// Expected response bytes including header
+#define HOST_RESP_LEN(write, size)  ((write) ? 1 : 1 + HOST_BYTES (size))
+#define HOST_STREAM_RESP(write, len)  ((write) ? 1 : 4 + (len))
+
+// Encode command into buf, return length
+int HostCommand (uint8_t *buf, uint8_t iface, bool write, bool inc,
+                 uint32_t addr, uint8_t size, uint32_t data);
+
+// Encode burst, writes must autoincrement
+int HostBurst (uint8_t *buf, uint8_t iface, bool write, bool inc,
+               uint32_t addr, const uint32_t *data);
+
+// Encode stream of len bytes, must autoincrement
+int HostStream (uint8_t *buf, uint8_t iface, bool write, int len, const uint32_t *data);
+
+// Frame length from header, 0 if more bytes needed
+int HostFrameLen (const uint8_t *buf, int len);
+
+// Check response header against command, return data bytes or -1
+int HostResponse (uint8_t hdr, uint8_t iface, bool write, uint8_t size);
+
+class HostMaster : public HostWindow {
+
+ private:
+  uint8_t iface;
+
+  // Expected responses in order, dst is NULL for writes
+  // and points to four words for bursts, len/4 for streams
+  typedef struct {
+    uint32_t *dst;
+    uint8_t size;
+    bool write;
+    int len, resp;
+  } pending_t;
+  std::deque<pending_t> pending;
+
+  // Autoincrement tracking
+  uint32_t last;
+  bool valid;
+  int errors;
+
+  void Queue (bool write, uint32_t addr, uint8_t size, const uint32_t *data,
+              uint32_t *dst, int len=0);
+  int NextSize (uint32_t addr, int len, bool write, uint8_t *size);
+  int Consume (void);
+
+ public:
+  // Statistics
+  uint64_t cmds, autoinc, bursts, streams;
+
+  // Use INCR4 bursts and extended frame streams for block transfers
+  bool burst, stream;
+
+  HostMaster (HostLink *link, uint8_t iface=0, int window=HOST_WINDOW);
+  ~HostMaster () {}
+
+  // Queued access, dst is valid after Flush
+  void Read (uint32_t addr, uint8_t size, uint32_t *dst);
+  void Write (uint32_t addr, uint8_t size, uint32_t data);
+
+  // Wait for all responses, return bus error count
+  int Flush (void);
+
+  // Forget previous address
+  void Invalidate (void) { valid = false; }
+
+  // Blocking helpers
+  uint32_t Read32 (uint32_t addr);
+  int Write32 (uint32_t addr, uint32_t data);
+
+  // Four word burst, dst/data hold four words. Write bursts must
+  // continue from the previous access.
+  void ReadBurst (uint32_t addr, uint32_t *dst);
+  void WriteBurst (uint32_t addr, const uint32_t *data);
+
+  // Extended frame of len bytes (multiple of 16) as back to back
+  // bursts. Must continue from the previous access.
+  void ReadStream (uint32_t addr, uint32_t *dst, int len);
+  void WriteStream (uint32_t addr, const uint32_t *data, int len);
+
+  // Bulk memory, unaligned ends use narrow accesses
+  int ReadBlock (uint32_t addr, uint8_t *buf, int len);
+  int WriteBlock (uint32_t addr, const uint8_t *buf, int len);
+};
+
+#endif /* HOSTMASTER_H */
@@ -0,0 +1,273 @@
+/**
+ *  Host responder for ahb3lite_host_slave.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+#include "HostSlave.h"
+#include "HostMaster.h"
+#include "err.h"
+
+// Cache key
+#define CACHE_KEY(addr, size)  (((uint64_t)(addr) << 2) | (size))
+
+static uint64_t now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+HostSlave::HostSlave (HostLink *link, uint8_t iface)
+{
+  this->link = link;
+  this->iface = iface ? CMD_IFACE : 0;
+  recent = NULL;
+  ilen = 0;
+  unmapped = 0;
+}
+
+HostSlave::~HostSlave ()
+{
+  for (auto r : regions) {
+    if (r->owned)
+      delete[] r->mem;
+    delete r;
+  }
+}
+
+region_t *HostSlave::Add (const char *name, uint32_t base, uint32_t size, uint8_t flags)
+{
+  region_t *r;
+
+  // Regions must not overlap
+  for (auto o : regions)
+    if ((base < o->base + o->size) && (o->base < base + size))
+      fail ("HostSlave: %s overlaps %s", name, o->name);
+
+  r = new region_t;
+  r->name = name;
+  r->base = base;
+  r->size = size;
+  r->flags = flags;
+  r->read = NULL;
+  r->write = NULL;
+  r->arg = NULL;
+  r->mem = NULL;
+  r->owned = false;
+  r->reads = r->writes = r->hits = r->errors = 0;
+  r->total_ns = r->max_ns = 0;
+  memset (r->hist, 0, sizeof (r->hist));
+
+  // Keep sorted for lookup
+  regions.insert (std::upper_bound (regions.begin (), regions.end (), r,
+                                    [](region_t *a, region_t *b) { return a->base < b->base; }), r);
+  return r;
+}
+
+region_t *HostSlave::AddRegion (const char *name, uint32_t base, uint32_t size,
+                                slave_read_t read, slave_write_t write, void *arg, uint8_t flags)
+{
+  region_t *r = Add (name, base, size, flags);
+
+  r->read = read;
+  r->write = write;
+  r->arg = arg;
+  return r;
+}
+
+region_t *HostSlave::AddMemory (const char *name, uint32_t base, uint32_t size,
+                                uint8_t *mem, uint8_t flags)
+{
+  region_t *r = Add (name, base, size, flags & ~REGION_CACHE);
+
+  if (!mem) {
+    mem = new uint8_t[size];
+    memset (mem, 0, size);
+    r->owned = true;
+  }
+  r->mem = mem;
+  return r;
+}
+
+void HostSlave::Invalidate (region_t *r)
+{
+  r->cache.clear ();
+}
+
+region_t *HostSlave::Find (uint32_t addr)
+{
+  int lo = 0, hi = regions.size () - 1, mid;
+
+  // Most peripherals are polled in bursts
+  if (recent && (addr - recent->base < recent->size))
+    return recent;
+
+  while (lo <= hi) {
+    mid = (lo + hi) / 2;
+    if (addr < regions[mid]->base)
+      hi = mid - 1;
+    else if (addr - regions[mid]->base >= regions[mid]->size)
+      lo = mid + 1;
+    else
+      return recent = regions[mid];
+  }
+  return NULL;
+}
+
+int HostSlave::Access (region_t *r, bool write, uint32_t addr, uint8_t size, uint32_t *data)
+{
+  uint32_t off = addr - r->base, word;
+  int i, n = 1 << size;
+
+  if (write && (r->flags & REGION_RO))
+    return 1;
+  if (off + n > r->size)
+    return 1;
+
+  // Memory answered in place
+  if (r->mem) {
+    if (write)
+      memcpy (&r->mem[off], data, n);
+    else {
+      *data = 0;
+      memcpy (data, &r->mem[off], n);
+    }
+    return 0;
+  }
+
+  if (write) {
+
+    // Drop every cached read overlapping this word
+    if (r->flags & REGION_CACHE) {
+      word = addr & ~3;
+      r->cache.erase (CACHE_KEY (word, 2));
+      for (i = 0; i < 4; i += 2)
+        r->cache.erase (CACHE_KEY (word + i, 1));
+      for (i = 0; i < 4; i++)
+        r->cache.erase (CACHE_KEY (word + i, 0));
+    }
+    return r->write ? r->write (r->arg, addr, size, *data) : 1;
+  }
+
+  // Read fast path
+  if (r->flags & REGION_CACHE) {
+    auto it = r->cache.find (CACHE_KEY (addr, size));
+    if (it != r->cache.end ()) {
+      *data = it->second;
+      r->hits++;
+      return 0;
+    }
+  }
+  if (!r->read || r->read (r->arg, addr, size, data))
+    return 1;
+  if (r->flags & REGION_CACHE)
+    r->cache[CACHE_KEY (addr, size)] = *data;
+  return 0;
+}
+
+void HostSlave::Respond (bool write, uint8_t size, int err, uint32_t data)
+{
+  static const uint8_t code[3] = { FIFO_D1, FIFO_D2, FIFO_D4 };
+  uint8_t buf[5];
+  int i, len = 0;
+
+  // host_slave always expects data for reads, even on error
+  buf[len++] = iface | ((write ? FIFO_D0 : code[size]) << 4) | (err ? RESP_ERR : 0);
+  if (!write)
+    for (i = ((1 << size) - 1) * 8; i >= 0; i -= 8)
+      buf[len++] = data >> i;
+  link->Send (buf, len);
+}
+
+void HostSlave::Poll (void)
+{
+  uint8_t hdr, size;
+  uint32_t addr, data = 0;
+  uint64_t start, ns;
+  region_t *r;
+  bool write;
+  int i, n, err, b;
+
+  // Wait for complete request
+  while (1) {
+    if (ilen) {
+      hdr = ibuf[0];
+      write = !!(hdr & CMD_WRITE);
+      size = hdr & 3;
+      n = fifo_payload[(hdr >> 4) & 7];
+      if (((hdr & CMD_IFACE) != iface) || (hdr & CMD_AUTOINC) || (size > HOST_WORD) ||
+          (n != (write ? 4 + (1 << size) : 4)))
+        fail ("HostSlave: unexpected request %02X", hdr);
+      if (ilen >= n + 1)
+        break;
+    }
+    ilen += link->Recv (&ibuf[ilen], sizeof (ibuf) - ilen);
+  }
+  start = now_ns ();
+
+  // Big endian address then data
+  for (addr = 0, i = 1; i <= 4; i++)
+    addr = (addr << 8) | ibuf[i];
+  for (; i <= n; i++)
+    data = (data << 8) | ibuf[i];
+
+  // Dispatch
+  r = Find (addr);
+  err = r ? Access (r, write, addr, size, &data) : 1;
+  Respond (write, size, err, data);
+
+  // Shift remaining
+  ilen -= n + 1;
+  memmove (ibuf, &ibuf[n + 1], ilen);
+
+  // Update stats
+  if (!r) {
+    unmapped++;
+    return;
+  }
+  ns = now_ns () - start;
+  if (write)
+    r->writes++;
+  else
+    r->reads++;
+  if (err)
+    r->errors++;
+  r->total_ns += ns;
+  if (ns > r->max_ns)
+    r->max_ns = ns;
+  b = ns ? 63 - __builtin_clzll (ns) : 0;
+  r->hist[(b < HIST_BUCKETS) ? b : HIST_BUCKETS - 1]++;
+}
+
+void HostSlave::Run (volatile bool *done)
+{
+  while (!*done)
+    Poll ();
+}
+
+void HostSlave::Report (FILE *fp)
+{
+  uint64_t cnt;
+  int i;
+
+  for (auto r : regions) {
+    cnt = r->reads + r->writes;
+    fprintf (fp, "%-12s %08X-%08X reads=%lu writes=%lu hits=%lu errors=%lu avg=%luns max=%luns\n",
+             r->name, r->base, r->base + r->size - 1, (unsigned long)r->reads,
+             (unsigned long)r->writes, (unsigned long)r->hits, (unsigned long)r->errors,
+             (unsigned long)(cnt ? r->total_ns / cnt : 0), (unsigned long)r->max_ns);
+    for (i = 0; i < HIST_BUCKETS; i++)
+      if (r->hist[i])
+        fprintf (fp, "  %10luns+ %lu\n", 1UL << i, (unsigned long)r->hist[i]);
+  }
+  if (unmapped)
+    fprintf (fp, "unmapped=%lu\n", (unsigned long)unmapped);
+}
@@ -0,0 +1,100 @@
+/**
+ *  Host responder for ahb3lite_host_slave. Bus transactions forwarded
+ *  over the host FIFO are dispatched to registered address regions -
+ *  either callbacks emulating a peripheral or plain memory. The bus is
+ *  stalled until we answer so memory regions and cached callback reads
+ *  are answered without leaving the receive path. Service time is
+ *  kept per region as a log2 histogram.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+#ifndef HOSTSLAVE_H
+#define HOSTSLAVE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+#include "HostLink.h"
+
+// Region callbacks, return non-zero for bus error
+typedef int (*slave_read_t)(void *arg, uint32_t addr, uint8_t size, uint32_t *data);
+typedef int (*slave_write_t)(void *arg, uint32_t addr, uint8_t size, uint32_t data);
+
+// Region flags
+#define REGION_RO       0x01  // Writes return bus error
+#define REGION_CACHE    0x02  // Reuse callback reads until written/invalidated
+
+// Histogram buckets - bucket n covers [2^n, 2^(n+1)) ns
+#define HIST_BUCKETS    32
+
+typedef struct {
+  const char *name;
+  uint32_t base, size;
+  uint8_t flags;
+
+  // Callback region
+  slave_read_t read;
+  slave_write_t write;
+  void *arg;
+
+  // Memory region
+  uint8_t *mem;
+  bool owned;
+
+  // Cached callback reads keyed by addr|size
+  std::unordered_map<uint64_t, uint32_t> cache;
+
+  // Statistics
+  uint64_t reads, writes, hits, errors;
+  uint64_t total_ns, max_ns;
+  uint64_t hist[HIST_BUCKETS];
+} region_t;
+
+class HostSlave {
+
+ private:
+  HostLink *link;
+  uint8_t iface;
+  std::vector<region_t *> regions;
+  region_t *recent;
+
+  // Partial request
+  uint8_t ibuf[64];
+  int ilen;
+
+  // Unmapped accesses
+  uint64_t unmapped;
+
+  region_t *Find (uint32_t addr);
+  region_t *Add (const char *name, uint32_t base, uint32_t size, uint8_t flags);
+  int Access (region_t *r, bool write, uint32_t addr, uint8_t size, uint32_t *data);
+  void Respond (bool write, uint8_t size, int err, uint32_t data);
+
+ public:
+  HostSlave (HostLink *link, uint8_t iface=0);
+  ~HostSlave ();
+
+  // Peripheral emulated by callbacks
+  region_t *AddRegion (const char *name, uint32_t base, uint32_t size,
+                       slave_read_t read, slave_write_t write, void *arg, uint8_t flags=0);
+
+  // Memory backed region, allocated if mem is NULL
+  region_t *AddMemory (const char *name, uint32_t base, uint32_t size,
+                       uint8_t *mem=NULL, uint8_t flags=0);
+
+  // Drop cached reads after device side state changes
+  void Invalidate (region_t *r);
+
+  // Service one bus transaction, blocks on the link
+  void Poll (void);
+  void Run (volatile bool *done);
+
+  // Print per region statistics
+  void Report (FILE *fp);
+};
+
+#endif /* HOSTSLAVE_H */
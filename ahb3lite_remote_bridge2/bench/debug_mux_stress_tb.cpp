@@ -0,0 +1,548 @@
+/**
+ *  Verilator bench on top of debug_mux.sv - Constrained random stress.
+ *  Streams DP/AP/memory transfers, interface switches, JTAG direct
+ *  scans and FIFO bursts at the --adiv5-model target. Every
+ *  read is checked against a scoreboard shadow of the target state.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <signal.h>
+#include <argp.h>
+#include <time.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+#include <verilator_utils.h>
+#include <ADIv5Driver.h>
+#include <ADIv5Target.h>
+#include <err.h>
+
+#include "Vdebug_mux.h"
+
+#define RESET_TIME  10
+static bool done = false;
+
+// JTAG direct commands
+#define CMD_DR_WRITE       0
+#define CMD_DR_READ        1
+#define CMD_IR_WRITE       4
+#define IR_BYPASS          0xf
+
+// Defaults
+#define STRESS_CNT         100000
+#define STRESS_BASE        0x20000000
+#define STRESS_WORDS       4096
+#define BURST_MAX          32
+#define BLOCK_MAX          300
+#define GAP_MAX            16
+
+// Operation mix
+typedef enum {
+  OP_DP_READ,
+  OP_AP_READ,
+  OP_MEM_WRITE,
+  OP_MEM_READ,
+  OP_BLOCK_WRITE,
+  OP_BLOCK_READ,
+  OP_BURST,
+  OP_SWITCH,
+  OP_DIRECT,
+  OP_CNT
+} op_t;
+
+static const char *op_name[OP_CNT] = {
+  "dp_read", "ap_read", "mem_write", "mem_read", "block_write",
+  "block_read", "burst", "switch", "direct"
+};
+
+// Relative weights
+static const int op_weight[OP_CNT] = {
+  10, 10, 20, 20, 6, 6, 10, 2, 1
+};
+
+// Pending scoreboard check
+typedef struct {
+  uint32_t val;
+  uint32_t expect;
+  op_t op;
+} check_t;
+
+typedef struct {
+  uint64_t count;
+  uint64_t xfers;
+  uint64_t cycles;
+} stat_t;
+
+static void INTHandler (int signal)
+{
+  printf("\nCaught ctrl-c\n");
+  done = true;
+}
+
+class debug_mux_stress_tb : public VerilatorUtils {
+
+private:
+  bool _doCycle (void);
+  uint32_t rng;
+  bool JTAGnSWD, init;
+
+  // Scoreboard
+  std::vector<uint32_t> shadow;
+  std::deque<check_t> checks;
+  stat_t stats[OP_CNT];
+  uint64_t errors;
+
+  uint32_t Rand (void);
+  uint32_t Addr (int words);
+  uint32_t *Check (op_t op, uint32_t expect);
+  int Score (void);
+  void Resync (void);
+  void Init (void);
+
+  // JTAG direct
+  void JTAGReq (uint8_t cmd, int len, uint64_t data);
+  uint64_t JTAGResp (void);
+
+public:
+  Vdebug_mux *top;
+  ADIv5Driver<debug_mux_stress_tb> *adiv5;
+  debug_mux_stress_tb ();
+  ~debug_mux_stress_tb ();
+  bool doCycle (void);
+
+  // Options
+  uint64_t count;
+  uint32_t seed;
+
+  int Run (op_t op);
+  int Stress (void);
+  void Report (double secs);
+};
+
+static int parse_opt (int key, char *arg, struct argp_state *state)
+{
+  debug_mux_stress_tb *tb = (debug_mux_stress_tb *)state->input;
+
+  switch (key) {
+    case ARGP_KEY_INIT:
+      state->child_inputs[0] = state->input;
+      break;
+    case 'n':
+      tb->count = strtoull (arg, NULL, 0);
+      break;
+    case 'S':
+      tb->seed = strtoul (arg, NULL, 0);
+      break;
+  }
+  return 0;
+}
+
+static int parse_args (int argc, char **argv, debug_mux_stress_tb *tb)
+{
+  struct argp_option options[] =
+    {
+     { "count", 'n', "CNT", 0, "Number of random operations" },
+     { "seed", 'S', "SEED", 0, "Random seed" },
+     { 0 }
+  };
+  struct argp_child child_parsers[] =
+    {
+     { &verilator_utils_argp, 0, "", 0 },
+     { 0 }
+  };
+  struct argp argp = { options, parse_opt, 0, 0, child_parsers };
+  return argp_parse (&argp, argc, argv, 0, 0, tb);
+}
+
+debug_mux_stress_tb::debug_mux_stress_tb (void) : VerilatorUtils (NULL)
+{
+  top = new Vdebug_mux;
+  ADIv5Pins<> pins = { &top->ADIv5_WRDATA, &top->ADIv5_WREN, &top->ADIv5_WRFULL,
+                       &top->ADIv5_RDDATA, &top->ADIv5_RDEN, &top->ADIv5_RDEMPTY };
+  adiv5 = new ADIv5Driver<debug_mux_stress_tb> (this, pins);
+  shadow.assign (STRESS_WORDS, 0);
+  memset (stats, 0, sizeof (stats));
+  errors = 0;
+  count = STRESS_CNT;
+  seed = 1;
+  JTAGnSWD = false;
+  init = false;
+
+  // Enable trace
+  top->trace (tfp, 99);
+}
+
+debug_mux_stress_tb::~debug_mux_stress_tb ()
+{
+  delete adiv5;
+  delete top;
+}
+
+bool debug_mux_stress_tb::_doCycle (void)
+{
+  // Call base function
+  if (!VerilatorUtils::doCycle() || done)
+    exit (-1);
+
+  // Control reset
+  top->SYS_RESETn = top->PHY_RESETn = (getTime () > RESET_TIME);
+
+  // Eval
+  top->eval ();
+
+  // Flip clocks
+  top->CLK = !top->CLK;
+  top->PHY_CLK = !top->PHY_CLK;
+  top->PHY_CLKn = !top->PHY_CLK;
+
+  // Target model on debug pins
+  doJTAGClient (top->TCK, &top->TDO, top->TDI, top->TMSOE ? &top->TMSOUT : &top->TMSIN, top->TMSOE);
+
+  // Continue
+  return true;
+}
+
+bool debug_mux_stress_tb::doCycle (void)
+{
+  // Two half cycles
+  if (!_doCycle ()) return false;
+  return _doCycle ();
+}
+
+uint32_t debug_mux_stress_tb::Rand (void)
+{
+  // xorshift32
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+uint32_t debug_mux_stress_tb::Addr (int words)
+{
+  // Word aligned start inside window
+  return STRESS_BASE + ((Rand () % (STRESS_WORDS - words + 1)) * 4);
+}
+
+uint32_t *debug_mux_stress_tb::Check (op_t op, uint32_t expect)
+{
+  check_t c = { 0, expect, op };
+
+  // References stay valid on push_back
+  checks.push_back (c);
+  return &checks.back ().val;
+}
+
+int debug_mux_stress_tb::Score (void)
+{
+  int err = 0;
+
+  // Wait for all responses
+  if (adiv5->Sync () != SWJ_OK) {
+    printf ("Transfer error %d\n", adiv5->stat);
+    err++;
+    init = false;
+  }
+  while (!checks.empty ()) {
+    check_t &c = checks.front ();
+    if (!err && (c.val != c.expect)) {
+      printf ("%s: %08X != %08X\n", op_name[c.op], c.val, c.expect);
+      err++;
+    }
+    checks.pop_front ();
+  }
+
+  if (err)
+    Resync ();
+  errors += err;
+  return err;
+}
+
+void debug_mux_stress_tb::Resync (void)
+{
+  int i;
+
+  // Target is the reference after an error
+  for (i = 0; i < STRESS_WORDS; i++)
+    shadow[i] = adiv5_target->Read32 (STRESS_BASE + (i * 4));
+}
+
+void debug_mux_stress_tb::Init (void)
+{
+  top->JTAG_DIRECT = 0;
+  top->JTAGnSWD = JTAGnSWD;
+  doCycle ();
+
+  // Reset and switch protocol
+  adiv5->Reset ();
+  adiv5->Switch ();
+  adiv5->DPRead (DP_IDCODE, Check (OP_SWITCH, JTAGnSWD ? TARGET_JTAG_IDCODE : TARGET_SWD_IDCODE));
+  adiv5->DPWrite (DP_CTRL_STAT, 0x50000000);
+  adiv5->DPRead (DP_CTRL_STAT, Check (OP_SWITCH, 0xF0000000));
+  init = (Score () == 0);
+}
+
+void debug_mux_stress_tb::JTAGReq (uint8_t cmd, int len, uint64_t data)
+{
+  // Block if FIFO is full
+  while (top->JTAG_WRFULL)
+    doCycle ();
+
+  top->JTAG_WRDATA[0] = (cmd & 7) | ((len & 0xfff) << 3) | ((data & 0x1ffff) << 15);
+  top->JTAG_WRDATA[1] = (data >> 17) & 0xffffffff;
+  top->JTAG_WRDATA[2] = (data >> 49) & 0x7fff;
+  top->JTAG_WREN = 1;
+  doCycle ();
+  top->JTAG_WREN = 0;
+}
+
+uint64_t debug_mux_stress_tb::JTAGResp (void)
+{
+  uint64_t data;
+  int len;
+
+  while (top->JTAG_RDEMPTY)
+    doCycle ();
+  top->JTAG_RDEN = 1;
+  doCycle ();
+  top->JTAG_RDEN = 0;
+
+  // Right justify
+  len = top->JTAG_RDDATA[0] & 0x3f;
+  if (len == 0)
+    len = 64;
+  data = (top->JTAG_RDDATA[0] >> 6) |
+    ((uint64_t)top->JTAG_RDDATA[1] << 26) |
+    (((uint64_t)top->JTAG_RDDATA[2] & 0x3f) << 58);
+  return data >> (64 - len);
+}
+
+int debug_mux_stress_tb::Run (op_t op)
+{
+  std::vector<uint32_t> in;
+  uint32_t addr, data, *buf;
+  uint64_t val, mask;
+  int i, n;
+
+  switch (op) {
+
+    case OP_DP_READ:
+      if (Rand () & 1)
+        adiv5->DPRead (DP_IDCODE, Check (op, JTAGnSWD ? TARGET_JTAG_IDCODE : TARGET_SWD_IDCODE));
+      else
+        adiv5->DPRead (DP_CTRL_STAT, Check (op, 0xF0000000));
+      break;
+
+    case OP_AP_READ:
+      if (Rand () & 1)
+        adiv5->APRead (0, AP_IDR, Check (op, TARGET_AP_IDR));
+      else
+        adiv5->APRead (0, AP_BASE, Check (op, TARGET_AP_BASE));
+      break;
+
+    case OP_MEM_WRITE:
+      addr = Addr (1);
+      data = Rand ();
+      adiv5->APWrite (0, AP_CSW, CSW_DEFAULT | CSW_SIZE32);
+      adiv5->APWrite (0, AP_TAR, addr);
+      adiv5->APWrite (0, AP_DRW, data);
+      shadow[(addr - STRESS_BASE) / 4] = data;
+      break;
+
+    case OP_MEM_READ:
+      addr = Addr (1);
+      adiv5->APWrite (0, AP_CSW, CSW_DEFAULT | CSW_SIZE32);
+      adiv5->APWrite (0, AP_TAR, addr);
+      adiv5->APRead (0, AP_DRW, Check (op, shadow[(addr - STRESS_BASE) / 4]));
+      break;
+
+    case OP_BLOCK_WRITE:
+      n = 1 + (Rand () % BLOCK_MAX);
+      addr = Addr (n);
+      buf = &shadow[(addr - STRESS_BASE) / 4];
+      for (i = 0; i < n; i++)
+        buf[i] = Rand ();
+      adiv5->MemWriteBlock (0, addr, buf, n);
+      break;
+
+    case OP_BLOCK_READ:
+      n = 1 + (Rand () % BLOCK_MAX);
+      addr = Addr (n);
+      buf = &shadow[(addr - STRESS_BASE) / 4];
+      in.assign (n, 0);
+      if (adiv5->MemReadBlock (0, addr, &in[0], n) != SWJ_OK)
+        break;
+      for (i = 0; i < n; i++)
+        if (in[i] != buf[i]) {
+          printf ("%s: %08X @ %08X != %08X\n", op_name[op], in[i], addr + (i * 4), buf[i]);
+          errors++;
+          Resync ();
+          break;
+        }
+      break;
+
+    case OP_BURST:
+      // Back-to-back reads, FIFO stays full
+      n = 1 + (Rand () % BURST_MAX);
+      for (i = 0; i < n; i++)
+        if (Rand () & 1)
+          adiv5->DPRead (DP_CTRL_STAT, Check (op, 0xF0000000));
+        else
+          adiv5->APRead (0, AP_IDR, Check (op, TARGET_AP_IDR));
+      break;
+
+    case OP_SWITCH:
+      Score ();
+      JTAGnSWD = Rand () & 1;
+      Init ();
+      break;
+
+    case OP_DIRECT:
+      // Drain ADIv5 path before taking the PHY
+      Score ();
+      top->JTAG_DIRECT = 1;
+      doCycle ();
+
+      // Reset, switch to JTAG and read IDCODE
+      JTAGReq (CMD_DR_WRITE, 0, 0);
+      JTAGReq (CMD_IR_WRITE, 0, 0);
+      JTAGReq (CMD_DR_READ, 32, 0);
+      val = JTAGResp ();
+      if (val != TARGET_JTAG_IDCODE) {
+        printf ("%s: IDCODE %08X\n", op_name[op], (uint32_t)val);
+        errors++;
+      }
+
+      // BYPASS delays data by one bit
+      n = 2 + (Rand () % 63);
+      mask = (n == 64) ? ~0ULL : ((1ULL << n) - 1);
+      val = (((uint64_t)Rand () << 32) | Rand ()) & mask;
+      JTAGReq (CMD_IR_WRITE, 4, IR_BYPASS);
+      JTAGReq (CMD_DR_READ, n, val);
+      if (JTAGResp () != ((val << 1) & mask)) {
+        printf ("%s: BYPASS %d bits mismatch\n", op_name[op], n);
+        errors++;
+      }
+
+      // ADIv5 path needs reinit
+      init = false;
+      break;
+
+    default:
+      break;
+  }
+  return 0;
+}
+
+int debug_mux_stress_tb::Stress (void)
+{
+  int i, total = 0, w;
+  uint64_t n, cycles, posted;
+  struct timespec t0, t1;
+  op_t op;
+
+  rng = seed ? seed : 1;
+  for (i = 0; i < OP_CNT; i++)
+    total += op_weight[i];
+
+  clock_gettime (CLOCK_MONOTONIC, &t0);
+  for (n = 0; (n < count) && !done; n++) {
+
+    // Reinit after switch/error
+    if (!init) {
+      Init ();
+      if (!init)
+        break;
+    }
+
+    // Pick weighted operation
+    w = Rand () % total;
+    for (i = 0; w >= op_weight[i]; i++)
+      w -= op_weight[i];
+    op = (op_t)i;
+
+    // Cycles are charged to the issuing operation
+    cycles = getTime ();
+    posted = adiv5->posted;
+    Run (op);
+    if (checks.size () > 256)
+      Score ();
+    stats[op].count++;
+    stats[op].xfers += adiv5->posted - posted;
+    stats[op].cycles += (getTime () - cycles) / 2;
+
+    // Random idle gap to vary handshake timing
+    if ((Rand () & 3) == 0)
+      for (i = Rand () % GAP_MAX; i > 0; i--)
+        doCycle ();
+
+    // Progress
+    if (n && ((n % 10000) == 0))
+      printf ("%lu ops %lu errors\n", (unsigned long)n, (unsigned long)errors);
+  }
+  Score ();
+  clock_gettime (CLOCK_MONOTONIC, &t1);
+
+  // Final memory compare through backdoor
+  for (i = 0; i < STRESS_WORDS; i++)
+    if (adiv5_target->Read32 (STRESS_BASE + (i * 4)) != shadow[i]) {
+      printf ("Memory mismatch @ %08X\n", STRESS_BASE + (i * 4));
+      errors++;
+      break;
+    }
+
+  Report ((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+  return errors ? -1 : 0;
+}
+
+void debug_mux_stress_tb::Report (double secs)
+{
+  uint64_t ops = 0, cycles = 0;
+  int i;
+
+  printf ("\n%-12s %10s %10s %12s %10s\n", "op", "count", "xfers", "cycles", "cyc/xfer");
+  for (i = 0; i < OP_CNT; i++) {
+    printf ("%-12s %10lu %10lu %12lu %10.1f\n", op_name[i],
+            (unsigned long)stats[i].count, (unsigned long)stats[i].xfers,
+            (unsigned long)stats[i].cycles,
+            stats[i].xfers ? (double)stats[i].cycles / stats[i].xfers : 0.0);
+    ops += stats[i].count;
+    cycles += stats[i].cycles;
+  }
+  printf ("\nops=%lu xfers=%lu waits=%lu errors=%lu\n", (unsigned long)ops,
+          (unsigned long)adiv5->posted, (unsigned long)adiv5_target->waits, (unsigned long)errors);
+  printf ("%.1fs wall, %lu cycles, %.0f cycles/s\n", secs, (unsigned long)(getTime () / 2),
+          (getTime () / 2) / secs);
+  printf ("%.0f transactions/hour\n", adiv5->posted * 3600.0 / secs);
+}
+
+int main (int argc, char **argv)
+{
+  int i, rv;
+  debug_mux_stress_tb *dut = new debug_mux_stress_tb;
+
+  // Parse args
+  parse_args (argc, argv, dut);
+
+  // Scoreboard reads target memory through the model
+  if (!dut->getADIv5Enable ())
+    fail ("Run with --adiv5-model");
+
+  // Setup interrupt handler
+  signal (SIGINT, &INTHandler);
+
+  // Run through reset
+  for (i = 0; i < RESET_TIME * 2; i++)
+    dut->doCycle ();
+
+  // Random traffic
+  rv = dut->Stress ();
+  printf ("%s\n", rv ? "FAILED" : "PASSED");
+
+  // Done
+  delete dut;
+  return rv;
+}
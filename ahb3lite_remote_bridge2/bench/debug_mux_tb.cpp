@@ -9,12 +9,27 @@
 #include <signal.h>
 #include <argp.h>
 #include <verilator_utils.h>
+#include <ADIv5Driver.h>
 
 #include "Vdebug_mux.h"
 
 #define RESET_TIME  10
 static bool done = false;
 
+// Block benchmark - crosses a 1KB TAR wrap
+#define BLOCK_ADDR  0x20000200
+#define BLOCK_WORDS 256
+
+// Bypass TAPs around the model DP, 5 bit IR each
+#define CHAIN_PRE    2
+#define CHAIN_POST   3
+#define CHAIN_IRLEN  5
+#define CHAIN_BITS   100
+
+// JTAG-DP IR
+#define IR_IDCODE    0xE
+#define IR_BYPASS    0xF
+
 // Valid commands
 #define CMD_DR_WRITE       0
 #define CMD_DR_READ        1
@@ -31,24 +46,7 @@ static void INTHandler (int signal)
   done = true;
 }
 
-static int parse_opt (int key, char *arg, struct argp_state *state)
-{
-  switch (key) {
-    case ARGP_KEY_INIT:
-      state->child_inputs[0] = state->input;
-      break;
-      // Add parsing custom options here
-  }
-  return 0;
-}
-
-// Response status
-typedef enum {
-   OK = 4,
-   WAIT = 2,
-   FAULT = 1,
-   NOCONNECT = 7
-} stat_t;
+static int parse_opt (int key, char *arg, struct argp_state *state);
 
 typedef struct {
   uint8_t  len;
@@ -68,27 +66,42 @@ public:
   bool doCycle (void);
 
   // DP/AP access
-  void write (uint8_t addr,  bool APnDP, bool RnW, uint32_t data);
-  uint32_t read (void);
-  uint32_t dp_read (uint8_t addr);
-  void dp_write (uint8_t addr, uint32_t data);
-  uint32_t ap_read (uint8_t apsel, uint8_t addr);
-  void ap_write (uint8_t apsel, uint8_t addr, uint32_t data);
+  ADIv5Driver<debug_mux_tb> *adiv5;
 
   // Test interface
   int test_if (bool JTAGnSWD);
 
+  // Block transfer throughput
+  int block_words;
+  int bench_block (bool JTAGnSWD);
+
   // JTAG direct
   int JTAG_Direct (void);
+  int JTAG_Chain (void);
   void JTAGReq (uint8_t cmd, int len, uint64_t data);
   resp_t *JTAGResp (void);
 };
 
+static int parse_opt (int key, char *arg, struct argp_state *state)
+{
+  debug_mux_tb *tb = (debug_mux_tb *)state->input;
+
+  switch (key) {
+    case ARGP_KEY_INIT:
+      state->child_inputs[0] = state->input;
+      break;
+    case 'b':
+      tb->block_words = strtol (arg, NULL, 0);
+      break;
+  }
+  return 0;
+}
+
 static int parse_args (int argc, char **argv, debug_mux_tb *tb)
 {
   struct argp_option options[] =
     {
-     // Add custom options here
+     { "block", 'b', "WORDS", 0, "Words per block benchmark (0 to skip)" },
      { 0 }
   };
   struct argp_child child_parsers[] =
@@ -103,6 +116,10 @@ static int parse_args (int argc, char **argv, debug_mux_tb *tb)
 debug_mux_tb::debug_mux_tb (void) : VerilatorUtils (NULL)
 {
   top = new Vdebug_mux;
+  ADIv5Pins<> pins = { &top->ADIv5_WRDATA, &top->ADIv5_WREN, &top->ADIv5_WRFULL,
+                       &top->ADIv5_RDDATA, &top->ADIv5_RDEN, &top->ADIv5_RDEMPTY };
+  adiv5 = new ADIv5Driver<debug_mux_tb> (this, pins);
+  block_words = BLOCK_WORDS;
 
   // Enable trace
   top->trace (tfp, 99);
@@ -110,6 +127,7 @@ debug_mux_tb::debug_mux_tb (void) : VerilatorUtils (NULL)
 
 debug_mux_tb::~debug_mux_tb ()
 {
+  delete adiv5;
   delete top;
 }
 
@@ -201,92 +219,6 @@ void dump_resp (resp_t *resp)
   printf ("[%d] %08X%08X\n", resp->len, uint32_t((resp->data >> 32) & 0xffffffff), uint32_t(resp->data & 0xffffffff));
 }
 
-void debug_mux_tb::write (uint8_t addr, bool APnDP, bool RnW, uint32_t data)
-{
-  // Block if FIFO is full
-  while (top->ADIv5_WRFULL)
-    doCycle ();
-
-  // Setup data
-  top->ADIv5_WRDATA = (uint64_t)data << 4;
-  top->ADIv5_WRDATA |= (addr & 3) << 2;
-  if (APnDP)
-    top->ADIv5_WRDATA |= 1 << 1;
-  if (RnW)
-    top->ADIv5_WRDATA |= 1;
-  
-  // Set WriteEN
-  top->ADIv5_WREN = 1;
-
-  // Toggle clock
-  doCycle ();
-
-  // Clr WriteEN
-  top->ADIv5_WREN = 0;
-}  
-
-uint32_t debug_mux_tb::read (void)
-{
-  // Wait for response
-  while (top->ADIv5_RDEMPTY)
-    doCycle ();
-
-  // Read
-  top->ADIv5_RDEN = 1;
-  doCycle ();
-  top->ADIv5_RDEN = 0;
-  
-  // Check response
-  if ((stat_t)(top->ADIv5_RDDATA & 7) != OK) {
-    int i;
-    printf ("read failed: %d\n", (int)(top->ADIv5_RDDATA & 7));
-    for (i = 0; i < 100; i++)
-      doCycle ();
-    done = true; // Bail
-  }
-  
-  // Return data
-  return (uint32_t)((top->ADIv5_RDDATA >> 3) & 0xffffffff);
-}  
-
-void debug_mux_tb::dp_write (uint8_t addr, uint32_t data)
-{
-  write ((addr >> 2) & 3, 0, 0, data);
-  if (addr != 0xc)
-    read ();
-}
-
-uint32_t debug_mux_tb::dp_read (uint8_t addr)
-{
-  write ((addr >> 2) & 3, 0, 1, 0);
-  return read ();
-}
-
-
-uint32_t debug_mux_tb::ap_read (uint8_t apsel, uint8_t addr)
-{
-  // Write DP[8] = SELECT
-  write (2, 0, 0, (apsel << 24) | addr);
-  read ();
-  
-  // Read AP[addr]
-  write ((addr >> 2) & 3, 1, 1, 0);
-
-  // Get result
-  return read ();
-}
-
-void debug_mux_tb::ap_write (uint8_t apsel, uint8_t addr, uint32_t data)
-{
-  // Write DP[8] = SELECT
-  write (2, 0, 0, (apsel << 24) | addr);
-  read ();
-  
-  // Write AP[addr]
-  write ((addr >> 2) & 3, 1, 0, data);
-  read ();
-}
-
 int debug_mux_tb::test_if (bool JTAGnSWD)
 {
   int i;
@@ -302,54 +234,58 @@ int debug_mux_tb::test_if (bool JTAGnSWD)
   doCycle ();
 
   // Reset
-  dp_write (0xc, 0);
+  adiv5->Reset ();
 
   // Switch to JTAG
-  dp_write (0xc, 1);
+  adiv5->Switch ();
   
   // Get IDCOde
-  printf ("IDCODE=%08X\n", dp_read (0));
+  printf ("IDCODE=%08X\n", adiv5->DPRead (DP_IDCODE));
 
   // Enable AP/DBGPWR
-  dp_write (4, 0x50000000);
+  adiv5->DPWrite (DP_CTRL_STAT, 0x50000000);
 
   // Read back STAT
-  val = dp_read (4);
+  val = adiv5->DPRead (DP_CTRL_STAT);
   printf ("CTRL/STAT=%08X\n", val); 
   if ((val & 0xf0000000) == 0xf0000000)
     printf ("PWR|DBG enabled\n");
 
   // Read IDR
-  printf ("AP[0]=%08X\n", ap_read (0, 0xfc));
+  printf ("AP[0]=%08X\n", adiv5->APRead (0, AP_IDR));
 
   // Read BASE
-  printf ("BASE=%08X\n", ap_read (0, 0xf8));
+  printf ("BASE=%08X\n", adiv5->APRead (0, AP_BASE));
 
   // Write AP[0] = CSW
-  ap_write (0, 0, 0xA2000002);
+  adiv5->APWrite (0, AP_CSW, 0xA2000002);
 
   // Write SCB_DHCSR to TAR
-  ap_write (0, 4, 0xE000EDF0);
+  adiv5->APWrite (0, AP_TAR, 0xE000EDF0);
 
   printf ("Halting processor... ");
   do {
     // Write HALT|DEBUGEN to DRW
-    ap_write (0, 0xc, 0xA05F0003);
+    adiv5->APWrite (0, AP_DRW, 0xA05F0003);
 
     // Read DHCSR
-  } while ((ap_read (0, 0xc) & (1 << 17)) == 0);
-  printf ("OK\n");
+  } while (((adiv5->APRead (0, AP_DRW) & (1 << 17)) == 0) && (adiv5->stat == SWJ_OK));
+  printf ("%s\n", (adiv5->stat == SWJ_OK) ? "OK" : "FAILED");
 
   // TAR = RAM
-  ap_write (0, 4, 0x20000000);
+  adiv5->APWrite (0, AP_TAR, 0x20000000);
 
   // Write to RAM
   printf ("RAM test... ");
-  ap_write (0, 0xc, 0xdeadc0de);
-  if (ap_read (0, 0xc) == 0xdeadc0de)
+  adiv5->APWrite (0, AP_DRW, 0xdeadc0de);
+  if (adiv5->APRead (0, AP_DRW) == 0xdeadc0de)
     printf ("OK\n");
   else
     printf ("FAILED\n");
+
+  // Bail on any transfer error
+  if (adiv5->Sync () != SWJ_OK)
+    done = true;
   printf ("\n");
   
   // Add padding to end
@@ -359,6 +295,53 @@ int debug_mux_tb::test_if (bool JTAGnSWD)
   return 0;
 }
 
+int debug_mux_tb::bench_block (bool JTAGnSWD)
+{
+  int i, err = 0;
+  uint64_t start, wr, rd;
+  uint32_t *out, *in;
+
+  if (block_words <= 0)
+    return 0;
+  out = new uint32_t[block_words];
+  in = new uint32_t[block_words];
+  for (i = 0; i < block_words; i++) {
+    out[i] = 0x9e3779b9 * (i + 1);
+    in[i] = 0;
+  }
+
+  printf ("%s block %d bytes @ %08X\n", JTAGnSWD ? "JTAG" : "SWD", block_words * 4, BLOCK_ADDR);
+
+  // Two ticks per cycle
+  start = getTime ();
+  if (adiv5->MemWriteBlock (0, BLOCK_ADDR, out, block_words) != SWJ_OK)
+    err++;
+  wr = (getTime () - start) / 2;
+
+  start = getTime ();
+  if (adiv5->MemReadBlock (0, BLOCK_ADDR, in, block_words) != SWJ_OK)
+    err++;
+  rd = (getTime () - start) / 2;
+
+  // Verify
+  for (i = 0; i < block_words; i++)
+    if (in[i] != out[i]) {
+      printf ("Mismatch @ %08X: %08X != %08X\n", BLOCK_ADDR + (i * 4), in[i], out[i]);
+      err++;
+      break;
+    }
+
+  printf ("write: %lu cycles %.4f bytes/cycle\n", (unsigned long)wr, (block_words * 4.0) / wr);
+  printf ("read:  %lu cycles %.4f bytes/cycle\n", (unsigned long)rd, (block_words * 4.0) / rd);
+  printf ("%s\n\n", err ? "FAILED" : "OK");
+
+  delete[] out;
+  delete[] in;
+  if (err)
+    done = true;
+  return err;
+}
+
 int debug_mux_tb::JTAG_Direct (void)
 {
   printf ("Testing JTAG direct interface\n");
@@ -380,9 +363,72 @@ int debug_mux_tb::JTAG_Direct (void)
   return 0;
 }
 
+// Address the DP between bypass TAPs, scans longer than one packet
+int debug_mux_tb::JTAG_Chain (void)
+{
+  int i, err = 0;
+  uint64_t out[2], exp[2];
+  uint32_t val;
+  resp_t *resp;
+
+  // Bypass TAPs only exist in the local model
+  if (!getADIv5Enable ())
+    return 0;
+  printf ("Testing JTAG chain %d pre %d post\n", CHAIN_PRE, CHAIN_POST);
+  adiv5_target->chain_pre = CHAIN_PRE;
+  adiv5_target->chain_post = CHAIN_POST;
+  top->JTAG_IR_PRE = CHAIN_PRE * CHAIN_IRLEN;
+  top->JTAG_IR_POST = CHAIN_POST * CHAIN_IRLEN;
+  top->JTAG_DR_PRE = CHAIN_PRE;
+  top->JTAG_DR_POST = CHAIN_POST;
+  doCycle ();
+
+  // RESET selects IDCODE
+  JTAGReq (CMD_DR_WRITE, 0, 0);
+  JTAGReq (CMD_DR_READ, 32, 0);
+  val = (uint32_t)JTAGResp()->data;
+  printf ("IDCODE=%08X\n", val);
+  err |= (val != TARGET_JTAG_IDCODE);
+
+  // Explicit IR, others left in BYPASS
+  JTAGReq (CMD_IR_WRITE, 4, IR_IDCODE);
+  JTAGReq (CMD_DR_READ, 32, 0);
+  err |= ((uint32_t)JTAGResp()->data != TARGET_JTAG_IDCODE);
+
+  // Streamed scan through DP bypass, delayed one bit
+  out[0] = 0x9e3779b97f4a7c15;
+  out[1] = 0xf39cc0605cedc834 & ((1ULL << (CHAIN_BITS - 64)) - 1);
+  exp[0] = out[0] << 1;
+  exp[1] = ((out[1] << 1) | (out[0] >> 63)) & ((1ULL << (CHAIN_BITS - 64)) - 1);
+  JTAGReq (CMD_IR_WRITE, 4, IR_BYPASS);
+  for (i = 0; i < 2; i++)
+    JTAGReq (CMD_DR_READ, CHAIN_BITS, out[i]);
+  for (i = 0; i < 2; i++) {
+    resp = JTAGResp ();
+    dump_resp (resp);
+    err |= (resp->len != (i ? CHAIN_BITS - 64 : 64)) || (resp->data != exp[i]);
+  }
+
+  if (adiv5_target->chain_errs) {
+    printf ("Bypass TAPs left out of BYPASS: %lu\n", (unsigned long)adiv5_target->chain_errs);
+    err = 1;
+  }
+  printf ("%s\n\n", err ? "FAILED" : "OK");
+
+  // Back to single TAP
+  JTAGReq (CMD_DR_WRITE, 0, 0);
+  adiv5_target->chain_pre = 0;
+  adiv5_target->chain_post = 0;
+  top->JTAG_IR_PRE = top->JTAG_IR_POST = 0;
+  top->JTAG_DR_PRE = top->JTAG_DR_POST = 0;
+  for (i = 0; i < 200; i++)
+    doCycle ();
+  return err;
+}
+
 int main (int argc, char **argv)
 {
-  int i;
+  int i, fails = 0;
   debug_mux_tb *dut = new debug_mux_tb;
 
   // Parse args
@@ -397,15 +443,18 @@ int main (int argc, char **argv)
 
   // Test SWD
   dut->test_if (0);
+  dut->bench_block (0);
   
   // Test JTAG
   dut->test_if (1);
+  dut->bench_block (1);
 
   // Test SWD
   dut->test_if (0);
 
   // Test JTAG direct
   dut->JTAG_Direct ();
+  fails += dut->JTAG_Chain ();
   
   // Add padding to end
   for (i = 0; i < 20; i++)
@@ -413,5 +462,5 @@ int main (int argc, char **argv)
   
   // Done
   delete dut;
-  return 0;
+  return fails ? -1 : 0;
 }
@@ -0,0 +1,80 @@
+/**
+ *  Bench wrapper - debug_mux clocked from debug_clkdiv so the PHY
+ *  divisor can be swept at runtime.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+module debug_sweep
+  (
+   // System clock and reset
+   input                               CLK,
+   input                               SYS_RESETn,
+   input                               PHY_RESETn,
+   // PHY clock select
+   input [3:0]                         SEL,
+   // Select interface
+   input                               JTAGnSWD,
+   // ADIv5 FIFO interface
+   input [ADIv5_CMD_WIDTH-1:0]         ADIv5_WRDATA,
+   input                               ADIv5_WREN,
+   output logic                        ADIv5_WRFULL,
+   output logic [ADIv5_RESP_WIDTH-1:0] ADIv5_RDDATA,
+   input                               ADIv5_RDEN,
+   output logic                        ADIv5_RDEMPTY,
+   // PHY signals
+   output logic                        TCK,
+   output logic                        TDI,
+   output logic                        TMSOUT,
+   output logic                        TMSOE,
+   input                               TMSIN,
+   input                               TDO
+   );
+
+   logic                               PHY_CLK;
+   logic                               JTAG_WRFULL, JTAG_RDEMPTY;
+   logic [JTAG_RESP_WIDTH-1:0]         JTAG_RDDATA;
+
+   // Divide system clock
+   debug_clkdiv u_clkdiv (
+                          .CLKIN  (CLK),
+                          .SEL    (SEL),
+                          .CLKOUT (PHY_CLK)
+                          );
+
+   // Direct JTAG interface unused
+   debug_mux u_debug_mux (
+                          .CLK           (CLK),
+                          .SYS_RESETn    (SYS_RESETn),
+                          .PHY_CLK       (PHY_CLK),
+                          .PHY_CLKn      (~PHY_CLK),
+                          .PHY_RESETn    (PHY_RESETn),
+                          .JTAGnSWD      (JTAGnSWD),
+                          .JTAG_DIRECT   (1'b0),
+                          .JTAG_IR_PRE   (8'h0),
+                          .JTAG_IR_POST  (8'h0),
+                          .JTAG_DR_PRE   (8'h0),
+                          .JTAG_DR_POST  (8'h0),
+                          .ADIv5_WRDATA  (ADIv5_WRDATA),
+                          .ADIv5_WREN    (ADIv5_WREN),
+                          .ADIv5_WRFULL  (ADIv5_WRFULL),
+                          .ADIv5_RDDATA  (ADIv5_RDDATA),
+                          .ADIv5_RDEN    (ADIv5_RDEN),
+                          .ADIv5_RDEMPTY (ADIv5_RDEMPTY),
+                          .JTAG_WRDATA   ({JTAG_CMD_WIDTH{1'b0}}),
+                          .JTAG_WREN     (1'b0),
+                          .JTAG_WRFULL   (JTAG_WRFULL),
+                          .JTAG_RDDATA   (JTAG_RDDATA),
+                          .JTAG_RDEN     (1'b0),
+                          .JTAG_RDEMPTY  (JTAG_RDEMPTY),
+                          .TCK           (TCK),
+                          .TDI           (TDI),
+                          .TMSOUT        (TMSOUT),
+                          .TMSOE         (TMSOE),
+                          .TMSIN         (TMSIN),
+                          .TDO           (TDO)
+                          );
+
+endmodule // debug_sweep
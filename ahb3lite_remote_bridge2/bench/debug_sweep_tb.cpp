@@ -0,0 +1,331 @@
+/**
+ *  Verilator bench on top of debug_sweep.sv - Measure debug link
+ *  throughput for every debug_clkdiv setting over SWD and JTAG.
+ *  Results are written as CSV.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <signal.h>
+#include <argp.h>
+#include <time.h>
+#include <verilator_utils.h>
+#include <ADIv5Driver.h>
+#include <err.h>
+
+#include "Vdebug_sweep.h"
+
+#define RESET_TIME   10
+static bool done = false;
+
+// Defaults
+#define SWEEP_CSV    "debug_sweep.csv"
+#define SWEEP_READS  32
+#define SWEEP_WORDS  64
+#define SWEEP_ADDR   0x20000200
+#define SEL_CNT      16
+
+// Long options, short keys taken by verilator_utils
+#define OPT_SEL      600
+
+// debug_clkdiv SEL to divisor
+static const int divisor[SEL_CNT] = {
+  1, 2, 3, 4, 6, 8, 10, 12, 16, 24, 32, 48, 64, 96, 192, 384
+};
+
+static void INTHandler (int signal)
+{
+  printf("\nCaught ctrl-c\n");
+  done = true;
+}
+
+// Snapshot of sim and wall time
+typedef struct {
+  uint64_t cycles;
+  struct timespec ts;
+} mark_t;
+
+class debug_sweep_tb : public VerilatorUtils {
+
+private:
+  bool _doCycle (void);
+  FILE *csv;
+
+public:
+  Vdebug_sweep *top;
+  debug_sweep_tb ();
+  ~debug_sweep_tb ();
+  bool doCycle (void);
+
+  // DP/AP access
+  ADIv5Driver<debug_sweep_tb> *adiv5;
+
+  // Options
+  const char *csv_file;
+  int reads, words;
+  int sel_min, sel_max;
+
+  // Sweep
+  int Setup (bool JTAGnSWD, int sel);
+  void Mark (mark_t *m);
+  void Report (bool JTAGnSWD, int sel, const char *test, int bytes, mark_t *start);
+  int Measure (bool JTAGnSWD, int sel);
+  int Sweep (void);
+};
+
+static int parse_opt (int key, char *arg, struct argp_state *state)
+{
+  debug_sweep_tb *tb = (debug_sweep_tb *)state->input;
+
+  switch (key) {
+    case ARGP_KEY_INIT:
+      state->child_inputs[0] = state->input;
+      break;
+    case 'o':
+      tb->csv_file = arg;
+      break;
+    case 'n':
+      tb->reads = strtol (arg, NULL, 0);
+      break;
+    case 'b':
+      tb->words = strtol (arg, NULL, 0);
+      break;
+    case OPT_SEL:
+      tb->sel_min = tb->sel_max = strtol (arg, NULL, 0) & (SEL_CNT - 1);
+      break;
+  }
+  return 0;
+}
+
+static int parse_args (int argc, char **argv, debug_sweep_tb *tb)
+{
+  struct argp_option options[] =
+    {
+     { "csv", 'o', "FILE", 0, "CSV output file" },
+     { "reads", 'n', "CNT", 0, "DP/AP reads per measurement" },
+     { "block", 'b', "WORDS", 0, "Words per block transfer" },
+     { "sel", OPT_SEL, "SEL", 0, "Only measure a single clkdiv SEL" },
+     { 0 }
+  };
+  struct argp_child child_parsers[] =
+    {
+     { &verilator_utils_argp, 0, "", 0 },
+     { 0 }
+  };
+  struct argp argp = { options, parse_opt, 0, 0, child_parsers };
+  return argp_parse (&argp, argc, argv, 0, 0, tb);
+}
+
+debug_sweep_tb::debug_sweep_tb (void) : VerilatorUtils (NULL)
+{
+  top = new Vdebug_sweep;
+  ADIv5Pins<> pins = { &top->ADIv5_WRDATA, &top->ADIv5_WREN, &top->ADIv5_WRFULL,
+                       &top->ADIv5_RDDATA, &top->ADIv5_RDEN, &top->ADIv5_RDEMPTY };
+  adiv5 = new ADIv5Driver<debug_sweep_tb> (this, pins);
+  csv = NULL;
+  csv_file = SWEEP_CSV;
+  reads = SWEEP_READS;
+  words = SWEEP_WORDS;
+  sel_min = 0;
+  sel_max = SEL_CNT - 1;
+
+  // Enable trace
+  top->trace (tfp, 99);
+}
+
+debug_sweep_tb::~debug_sweep_tb ()
+{
+  if (csv)
+    fclose (csv);
+  delete adiv5;
+  delete top;
+}
+
+bool debug_sweep_tb::_doCycle (void)
+{
+  // Call base function
+  if (!VerilatorUtils::doCycle() || done)
+    exit (-1);
+
+  // Control reset
+  if (getTime () > RESET_TIME)
+    top->SYS_RESETn = 1;
+  else
+    top->SYS_RESETn = 0;
+
+  // Eval
+  top->eval ();
+
+  // Flip clock
+  top->CLK = !top->CLK;
+
+  // Call JTAG client function
+  doJTAGClient (top->TCK, &top->TDO, top->TDI, top->TMSOE ? &top->TMSOUT : &top->TMSIN, top->TMSOE);
+
+  // Continue
+  return true;
+}
+
+bool debug_sweep_tb::doCycle (void)
+{
+  // Two half cycles
+  if (!_doCycle ()) return false;
+  return _doCycle ();
+}
+
+void debug_sweep_tb::Mark (mark_t *m)
+{
+  // Two ticks per cycle
+  m->cycles = getTime () / 2;
+  clock_gettime (CLOCK_MONOTONIC, &m->ts);
+}
+
+void debug_sweep_tb::Report (bool JTAGnSWD, int sel, const char *test, int bytes, mark_t *start)
+{
+  mark_t end;
+  uint64_t cycles;
+  double secs;
+
+  Mark (&end);
+  cycles = end.cycles - start->cycles;
+  secs = (end.ts.tv_sec - start->ts.tv_sec) + (end.ts.tv_nsec - start->ts.tv_nsec) / 1e9;
+  printf ("%-4s SEL=%-2d %-8s %8lu cycles %.5f bytes/cycle %.0f bytes/s\n",
+          JTAGnSWD ? "JTAG" : "SWD", sel, test, (unsigned long)cycles,
+          (double)bytes / cycles, bytes / secs);
+  fprintf (csv, "%s,%d,%d,%s,%d,%lu,%.6f,%.6f,%.1f\n",
+           JTAGnSWD ? "jtag" : "swd", sel, divisor[sel], test, bytes,
+           (unsigned long)cycles, (double)bytes / cycles, secs, bytes / secs);
+  fflush (csv);
+}
+
+int debug_sweep_tb::Setup (bool JTAGnSWD, int sel)
+{
+  int i;
+
+  // Hold PHY in reset while divisor changes
+  top->PHY_RESETn = 0;
+  top->JTAGnSWD = JTAGnSWD;
+  top->SEL = sel;
+  for (i = 0; i < (divisor[sel] * 4) + 512; i++)
+    doCycle ();
+  top->PHY_RESETn = 1;
+  for (i = 0; i < divisor[sel] * 4; i++)
+    doCycle ();
+
+  // Reset and switch protocol
+  adiv5->Reset ();
+  adiv5->Switch ();
+  if (adiv5->DPRead (DP_IDCODE) == 0)
+    return -1;
+
+  // Enable AP/DBGPWR
+  adiv5->DPWrite (DP_CTRL_STAT, 0x50000000);
+  for (i = 0; i < 100; i++)
+    if ((adiv5->DPRead (DP_CTRL_STAT) & 0xf0000000) == 0xf0000000)
+      break;
+
+  // Halt core so block transfers don't corrupt running code
+  adiv5->APWrite (0, AP_CSW, 0xA2000002);
+  adiv5->APWrite (0, AP_TAR, 0xE000EDF0);
+  adiv5->APWrite (0, AP_DRW, 0xA05F0003);
+  return (adiv5->Sync () == SWJ_OK) ? 0 : -1;
+}
+
+int debug_sweep_tb::Measure (bool JTAGnSWD, int sel)
+{
+  int i, err = 0;
+  uint32_t *out, *in, val;
+  mark_t start;
+
+  if (Setup (JTAGnSWD, sel)) {
+    printf ("%s SEL=%d: no connection\n", JTAGnSWD ? "JTAG" : "SWD", sel);
+    return -1;
+  }
+
+  // DP reads
+  Mark (&start);
+  for (i = 0; i < reads; i++)
+    adiv5->DPRead (DP_CTRL_STAT, &val);
+  err |= adiv5->Sync () != SWJ_OK;
+  Report (JTAGnSWD, sel, "dp_read", reads * 4, &start);
+
+  // AP reads
+  Mark (&start);
+  for (i = 0; i < reads; i++)
+    adiv5->APRead (0, AP_IDR, &val);
+  err |= adiv5->Sync () != SWJ_OK;
+  Report (JTAGnSWD, sel, "ap_read", reads * 4, &start);
+
+  // Block memory transfers
+  out = new uint32_t[words];
+  in = new uint32_t[words];
+  for (i = 0; i < words; i++) {
+    out[i] = (0x9e3779b9 * (i + 1)) ^ sel;
+    in[i] = 0;
+  }
+  Mark (&start);
+  err |= adiv5->MemWriteBlock (0, SWEEP_ADDR, out, words) != SWJ_OK;
+  Report (JTAGnSWD, sel, "mem_write", words * 4, &start);
+  Mark (&start);
+  err |= adiv5->MemReadBlock (0, SWEEP_ADDR, in, words) != SWJ_OK;
+  Report (JTAGnSWD, sel, "mem_read", words * 4, &start);
+  for (i = 0; i < words; i++)
+    if (in[i] != out[i]) {
+      printf ("Mismatch @ %08X: %08X != %08X\n", SWEEP_ADDR + (i * 4), in[i], out[i]);
+      err = 1;
+      break;
+    }
+  delete[] out;
+  delete[] in;
+
+  if (err)
+    printf ("%s SEL=%d: FAILED\n", JTAGnSWD ? "JTAG" : "SWD", sel);
+  return err ? -1 : 0;
+}
+
+int debug_sweep_tb::Sweep (void)
+{
+  int sel, fails = 0;
+  bool JTAGnSWD;
+
+  csv = fopen (csv_file, "w");
+  if (!csv)
+    fail ("Failed to open %s\n", csv_file);
+  fprintf (csv, "mode,sel,divisor,test,bytes,cycles,bytes_per_cycle,seconds,bytes_per_second\n");
+
+  for (JTAGnSWD = false; ; JTAGnSWD = true) {
+    for (sel = sel_min; sel <= sel_max; sel++)
+      if (Measure (JTAGnSWD, sel))
+        fails++;
+    if (JTAGnSWD)
+      break;
+  }
+  printf ("Results written to %s\n", csv_file);
+  return fails;
+}
+
+int main (int argc, char **argv)
+{
+  int i, fails;
+  debug_sweep_tb *dut = new debug_sweep_tb;
+
+  // Parse args
+  parse_args (argc, argv, dut);
+
+  // Setup interrupt handler
+  signal (SIGINT, &INTHandler);
+
+  // Run through reset
+  for (i = 0; i < RESET_TIME * 2; i++)
+    dut->doCycle ();
+
+  // Sweep all settings
+  fails = dut->Sweep ();
+  printf ("%s\n", fails ? "FAILED" : "PASSED");
+
+  // Done
+  delete dut;
+  return fails ? -1 : 0;
+}
@@ -0,0 +1,93 @@
+/**
+ *  Bench wrapper - host_jtag_convert in front of the debug_mux direct
+ *  JTAG path. The host FIFO is modelled by the C++ bench, the pins go
+ *  to the ADIv5 target model.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+module host_jtag_bench #( parameter FIFO_AW = 2 )
+  (
+   // System and PHY clock
+   input        CLK,
+   input        RESETn,
+   input        PHY_CLK,
+   input        PHY_CLKn,
+   // Host FIFO interface
+   output       RDEN,
+   input        RDEMPTY,
+   input [7:0]  RDDATA,
+   output       WREN,
+   input        WRFULL,
+   output [7:0] WRDATA,
+   // PHY signals
+   output       TCK,
+   output       TDI,
+   output       TMSOUT,
+   output       TMSOE,
+   input        TMSIN,
+   input        TDO
+   );
+
+   // Direct JTAG FIFO
+   logic [JTAG_CMD_WIDTH-1:0]  jtag_WRDATA;
+   logic [JTAG_RESP_WIDTH-1:0] jtag_RDDATA;
+   logic                       jtag_WREN, jtag_WRFULL, jtag_RDEN, jtag_RDEMPTY;
+
+   // Unused ADIv5 interface
+   logic                       adiv5_WRFULL, adiv5_RDEMPTY;
+   logic [ADIv5_RESP_WIDTH-1:0] adiv5_RDDATA;
+
+   host_jtag_convert u_convert (
+                                .CLK          (CLK),
+                                .RESETn       (RESETn),
+                                .HOST_RDEN    (RDEN),
+                                .HOST_RDEMPTY (RDEMPTY),
+                                .HOST_RDDATA  (RDDATA),
+                                .HOST_WREN    (WREN),
+                                .HOST_WRFULL  (WRFULL),
+                                .HOST_WRDATA  (WRDATA),
+                                .JTAG_WRDATA  (jtag_WRDATA),
+                                .JTAG_WREN    (jtag_WREN),
+                                .JTAG_WRFULL  (jtag_WRFULL),
+                                .JTAG_RDDATA  (jtag_RDDATA),
+                                .JTAG_RDEN    (jtag_RDEN),
+                                .JTAG_RDEMPTY (jtag_RDEMPTY)
+                                );
+
+   debug_mux #(.FIFO_AW (FIFO_AW))
+   u_debug_mux (
+                .CLK           (CLK),
+                .SYS_RESETn    (RESETn),
+                .PHY_CLK       (PHY_CLK),
+                .PHY_CLKn      (PHY_CLKn),
+                .PHY_RESETn    (RESETn),
+                .JTAGnSWD      (1'b1),
+                .JTAG_DIRECT   (1'b1),
+                .JTAG_IR_PRE   (8'h0),
+                .JTAG_IR_POST  (8'h0),
+                .JTAG_DR_PRE   (8'h0),
+                .JTAG_DR_POST  (8'h0),
+                .ADIv5_WRDATA  ('0),
+                .ADIv5_WREN    (1'b0),
+                .ADIv5_WRFULL  (adiv5_WRFULL),
+                .ADIv5_RDDATA  (adiv5_RDDATA),
+                .ADIv5_RDEN    (1'b0),
+                .ADIv5_RDEMPTY (adiv5_RDEMPTY),
+                .JTAG_WRDATA   (jtag_WRDATA),
+                .JTAG_WREN     (jtag_WREN),
+                .JTAG_WRFULL   (jtag_WRFULL),
+                .JTAG_RDDATA   (jtag_RDDATA),
+                .JTAG_RDEN     (jtag_RDEN),
+                .JTAG_RDEMPTY  (jtag_RDEMPTY),
+                .TCK           (TCK),
+                .TDI           (TDI),
+                .TMSOUT        (TMSOUT),
+                .TMSOE         (TMSOE),
+                .TMSIN         (TMSIN),
+                .TDO           (TDO)
+                );
+
+endmodule // host_jtag_bench
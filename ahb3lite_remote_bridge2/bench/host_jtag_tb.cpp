@@ -0,0 +1,330 @@
+/**
+ *  Verilator bench on top of host_jtag_bench.sv - raw JTAG scans from
+ *  HostJTAG through host_jtag_convert to the pins. Checks IDCODE and a
+ *  bypass loopback against the ADIv5 model, then reports scan bits per
+ *  cycle, TCK cycles per bit and host link bytes per bit for a range
+ *  of scan lengths.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <signal.h>
+#include <argp.h>
+#include <deque>
+#include <verilator_utils.h>
+#include <ADIv5Target.h>
+#include <err.h>
+
+#include "Vhost_jtag_bench.h"
+#include "HostLink.h"
+#include "HostJTAG.h"
+
+#define RESET_TIME   10
+static bool done = false;
+
+// Defaults
+#define BENCH_SCANS  32
+
+// FIFO model never fills, let every scan queue
+#define BENCH_WINDOW (1 << 20)
+
+// JTAG-DP IR
+#define IR_LEN       4
+#define IR_IDCODE    0xE
+#define IR_BYPASS    0xF
+
+// Loopback length, crosses chunk boundaries
+#define LOOP_BITS    1000
+
+// Scan lengths measured
+static const int scan_len[] = { 8, 32, 35, 64, 256, 1024, JTAG_SCAN_MAX };
+#define LEN_CNT      (int)(sizeof (scan_len) / sizeof (scan_len[0]))
+
+static void INTHandler (int signal)
+{
+  printf("\nCaught ctrl-c\n");
+  done = true;
+}
+
+// Cycle counters
+typedef struct {
+  uint64_t cycles, tck, link;
+} mark_t;
+
+class host_jtag_tb : public VerilatorUtils {
+
+private:
+  bool _doCycle (void);
+
+  // Host FIFO model
+  std::deque<uint8_t> fifo;
+
+  // TCK rising edges
+  uint64_t tck;
+  uint8_t ptck;
+
+public:
+  Vhost_jtag_bench *top;
+  SimLink *link;
+  HostJTAG *jtag;
+  host_jtag_tb ();
+  ~host_jtag_tb ();
+  bool doCycle (void);
+
+  // Options
+  int scans;
+
+  int Check (void);
+  int Loopback (int len, const uint64_t *tdi, const uint64_t *tdo);
+  void Mark (mark_t *m);
+  int Measure (int len, bool read);
+};
+
+static void pump (void *arg)
+{
+  ((host_jtag_tb *)arg)->doCycle ();
+}
+
+static int parse_opt (int key, char *arg, struct argp_state *state)
+{
+  host_jtag_tb *tb = (host_jtag_tb *)state->input;
+
+  switch (key) {
+    case ARGP_KEY_INIT:
+      state->child_inputs[0] = state->input;
+      break;
+    case 'n':
+      tb->scans = strtol (arg, NULL, 0);
+      break;
+  }
+  return 0;
+}
+
+static int parse_args (int argc, char **argv, host_jtag_tb *tb)
+{
+  struct argp_option options[] =
+    {
+     { "scans", 'n', "CNT", 0, "Scans queued per length" },
+     { 0 }
+  };
+  struct argp_child child_parsers[] =
+    {
+     { &verilator_utils_argp, 0, "", 0 },
+     { 0 }
+  };
+  struct argp argp = { options, parse_opt, 0, 0, child_parsers };
+  return argp_parse (&argp, argc, argv, 0, 0, tb);
+}
+
+host_jtag_tb::host_jtag_tb (void) : VerilatorUtils (NULL)
+{
+  top = new Vhost_jtag_bench;
+  link = new SimLink (pump, this);
+  jtag = new HostJTAG (link, 0, BENCH_WINDOW);
+  scans = BENCH_SCANS;
+  tck = 0;
+  ptck = 0;
+  top->RDEMPTY = 1;
+  top->WRFULL = 0;
+
+  // Enable trace
+  top->trace (tfp, 99);
+}
+
+host_jtag_tb::~host_jtag_tb ()
+{
+  delete jtag;
+  delete link;
+  delete top;
+}
+
+bool host_jtag_tb::_doCycle (void)
+{
+  // Call base function
+  if (!VerilatorUtils::doCycle() || done)
+    exit (-1);
+
+  // Control reset
+  if (getTime () > RESET_TIME)
+    top->RESETn = 1;
+  else
+    top->RESETn = 0;
+
+  // Eval
+  top->eval ();
+
+  // Flip clocks
+  top->CLK = !top->CLK;
+  top->PHY_CLK = !top->PHY_CLK;
+  top->PHY_CLKn = !top->PHY_CLK;
+
+  // Count TCK cycles
+  if (top->TCK && !ptck)
+    tck++;
+  ptck = top->TCK;
+
+  // Call JTAG client function
+  doJTAGClient (top->TCK, &top->TDO, top->TDI, top->TMSOE ? &top->TMSOUT : &top->TMSIN, top->TMSOE);
+
+  // Continue
+  return true;
+}
+
+bool host_jtag_tb::doCycle (void)
+{
+  uint8_t c;
+  bool rden;
+
+  // Settle before rising edge
+  if (!_doCycle ()) return false;
+
+  // Sample strobes
+  rden = top->RDEN && !fifo.empty ();
+  if (top->WREN)
+    link->Put (top->WRDATA);
+
+  // Rising edge
+  if (!_doCycle ()) return false;
+
+  // Read data valid the cycle after RDEN
+  if (rden) {
+    top->RDDATA = fifo.front ();
+    fifo.pop_front ();
+  }
+
+  // One byte per cycle from host
+  if (link->Get (&c))
+    fifo.push_back (c);
+  top->RDEMPTY = fifo.empty ();
+  return true;
+}
+
+void host_jtag_tb::Mark (mark_t *m)
+{
+  // Two ticks per cycle
+  m->cycles = getTime () / 2;
+  m->tck = tck;
+  m->link = jtag->tx_bytes + jtag->rx_bytes;
+}
+
+// BYPASS delays TDI one bit behind a captured zero
+int host_jtag_tb::Loopback (int len, const uint64_t *tdi, const uint64_t *tdo)
+{
+  uint64_t exp, mask;
+  int i;
+
+  for (i = 0; i < JTAG_CHUNKS (len); i++) {
+    exp = (tdi[i] << 1) | (i ? tdi[i - 1] >> 63 : 0);
+    mask = (len - (i * 64) >= 64) ? ~0ULL : (1ULL << (len - (i * 64))) - 1;
+    if ((tdo[i] & mask) != (exp & mask)) {
+      printf ("Loopback %d bits chunk %d: %016lX != %016lX\n", len, i,
+              (unsigned long)(tdo[i] & mask), (unsigned long)(exp & mask));
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int host_jtag_tb::Check (void)
+{
+  uint64_t val, tdi[JTAG_CHUNKS (LOOP_BITS)], tdo[JTAG_CHUNKS (LOOP_BITS)];
+  int i, err = 0;
+
+  // RESET selects IDCODE
+  jtag->Reset ();
+  jtag->Switch ();
+  jtag->DR (32, 0, &val);
+  jtag->Flush ();
+  printf ("IDCODE=%08X\n", (uint32_t)val);
+  err |= ((uint32_t)val != TARGET_JTAG_IDCODE);
+
+  // Explicit IR
+  jtag->IR (IR_LEN, IR_IDCODE);
+  jtag->DR (32, 0, &val);
+  jtag->Flush ();
+  err |= ((uint32_t)val != TARGET_JTAG_IDCODE);
+
+  // Extended frame through BYPASS
+  for (i = 0; i < JTAG_CHUNKS (LOOP_BITS); i++)
+    tdi[i] = 0x9e3779b97f4a7c15 * (i + 1);
+  jtag->IR (IR_LEN, IR_BYPASS);
+  jtag->Scan (JTAG_DR_READ, LOOP_BITS, tdi, tdo);
+  jtag->Flush ();
+  err |= Loopback (LOOP_BITS, tdi, tdo);
+
+  printf ("%s\n\n", err ? "FAILED" : "OK");
+  return err;
+}
+
+// Back to back scans through BYPASS
+int host_jtag_tb::Measure (int len, bool read)
+{
+  uint64_t *tdi, *tdo;
+  mark_t start, end;
+  double bits;
+  int i, n = JTAG_CHUNKS (len), err = 0;
+
+  tdi = new uint64_t[scans * n];
+  tdo = new uint64_t[scans * n];
+  for (i = 0; i < scans * n; i++) {
+    tdi[i] = 0x9e3779b97f4a7c15 * (i + len);
+    tdo[i] = 0;
+  }
+
+  Mark (&start);
+  for (i = 0; i < scans; i++)
+    jtag->Scan (read ? JTAG_DR_READ : JTAG_DR_WRITE, len, &tdi[i * n], read ? &tdo[i * n] : NULL);
+
+  // Writes have no response, follow with one read to wait for the pins
+  if (!read)
+    jtag->DR (1, 0, tdo);
+  jtag->Flush ();
+  Mark (&end);
+
+  if (read)
+    for (i = 0; i < scans; i++)
+      err |= Loopback (len, &tdi[i * n], &tdo[i * n]);
+
+  bits = (double)scans * len;
+  printf ("%-5s %4d bits %9lu cycles %6.3f bits/cycle %5.2f TCK/bit %5.3f link bytes/bit%s\n",
+          read ? "read" : "write", len, (unsigned long)(end.cycles - start.cycles),
+          bits / (end.cycles - start.cycles), (end.tck - start.tck) / bits,
+          (end.link - start.link) / bits, err ? " FAILED" : "");
+  delete[] tdi;
+  delete[] tdo;
+  return err;
+}
+
+int main (int argc, char **argv)
+{
+  int i, fails = 0;
+  host_jtag_tb *dut = new host_jtag_tb;
+
+  // Parse args
+  parse_args (argc, argv, dut);
+
+  // Setup interrupt handler
+  signal (SIGINT, &INTHandler);
+
+  // Run through reset
+  for (i = 0; i < RESET_TIME * 2; i++)
+    dut->doCycle ();
+
+  // Needs the model to check scans
+  if (!dut->getADIv5Enable ())
+    fail ("Run with --adiv5-model");
+  fails += dut->Check ();
+
+  // DP left in BYPASS
+  for (i = 0; i < LEN_CNT; i++)
+    fails += dut->Measure (scan_len[i], false);
+  for (i = 0; i < LEN_CNT; i++)
+    fails += dut->Measure (scan_len[i], true);
+  printf ("%s\n", fails ? "FAILED" : "PASSED");
+
+  // Done
+  delete dut;
+  return fails ? -1 : 0;
+}
@@ -0,0 +1,90 @@
+/**
+ *  Bench wrapper - jtag_adiv5 on top of jtag_phy. Counts DR and IR
+ *  scans issued to the PHY so the bench can report scans per access.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+module jtag_adiv5_bench #( parameter FIFO_AW = 2 )
+  (
+   // System and PHY clock
+   input                               CLK,
+   input                               RESETn,
+   input                               PHY_CLK,
+   input                               PHY_CLKn,
+   // ADIv5 FIFO interface
+   input [ADIv5_CMD_WIDTH-1:0]         WRDATA,
+   input                               WREN,
+   output                              WRFULL,
+   output [ADIv5_RESP_WIDTH-1:0]       RDDATA,
+   input                               RDEN,
+   output                              RDEMPTY,
+   // Scan counters
+   output logic [31:0]                 DRSCANS,
+   output logic [31:0]                 IRSCANS,
+   // PHY signals
+   output                              TCK,
+   output                              TDI,
+   output                              TMS,
+   input                               TDO
+   );
+
+   logic [JTAG_CMD_WIDTH-1:0]          phy_WRDATA;
+   logic [JTAG_RESP_WIDTH-1:0]         phy_RDDATA;
+   logic                               phy_WREN, phy_RDEN, phy_WRFULL, phy_RDEMPTY;
+
+   // Count shifts, len=0 commands are reset/switch/idle
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          DRSCANS <= 0;
+          IRSCANS <= 0;
+       end
+     else if (phy_WREN & !phy_WRFULL & (phy_WRDATA[14:3] != 0))
+       begin
+          if (phy_WRDATA[2])
+            IRSCANS <= IRSCANS + 1;
+          else
+            DRSCANS <= DRSCANS + 1;
+       end
+
+   jtag_phy #(.FIFO_AW (FIFO_AW + 1))
+   u_jtag_phy (
+               .CLK        (CLK),
+               .SYS_RESETn (RESETn),
+               .PHY_CLK    (PHY_CLK),
+               .PHY_CLKn   (PHY_CLKn),
+               .PHY_RESETn (RESETn),
+               .WRDATA     (phy_WRDATA),
+               .WREN       (phy_WREN),
+               .WRFULL     (phy_WRFULL),
+               .RDDATA     (phy_RDDATA),
+               .RDEN       (phy_RDEN),
+               .RDEMPTY    (phy_RDEMPTY),
+               .TCK        (TCK),
+               .TMS        (TMS),
+               .TDI        (TDI),
+               .TDO        (TDO)
+               );
+
+   jtag_adiv5 #(.FIFO_AW (FIFO_AW))
+   u_jtag_adiv5 (
+                 .CLK         (CLK),
+                 .RESETn      (RESETn),
+                 .WRDATA      (WRDATA),
+                 .WREN        (WREN),
+                 .WRFULL      (WRFULL),
+                 .RDDATA      (RDDATA),
+                 .RDEN        (RDEN),
+                 .RDEMPTY     (RDEMPTY),
+                 .PHY_WRDATA  (phy_WRDATA),
+                 .PHY_WREN    (phy_WREN),
+                 .PHY_WRFULL  (phy_WRFULL),
+                 .PHY_RDDATA  (phy_RDDATA),
+                 .PHY_RDEN    (phy_RDEN),
+                 .PHY_RDEMPTY (phy_RDEMPTY)
+                 );
+
+endmodule // jtag_adiv5_bench
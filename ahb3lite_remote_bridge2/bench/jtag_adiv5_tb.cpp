@@ -1,5 +1,8 @@
 /**
- *  Verilator bench on top of jtag_adiv5.sv - Test JTAG phy
+ *  Verilator bench on top of jtag_adiv5_bench.sv - Test JTAG ADIv5
+ *  against the target model. Back to back AP reads overlap each scan
+ *  with the previous result, reports DR scans and cycles per read for
+ *  posted reads against blocking reads.
  *
  *  All rights reserved.
  *  Tiny Labs Inc
@@ -9,12 +12,20 @@
 #include <signal.h>
 #include <argp.h>
 #include <verilator_utils.h>
+#include <ADIv5Driver.h>
+#include <err.h>
 
-#include "Vjtag_adiv5.h"
+#include "Vjtag_adiv5_bench.h"
 
 #define RESET_TIME  10
 static bool done = false;
 
+// Read benchmark
+#define BENCH_ADDR   0x20000000
+#define BENCH_READS  64
+
+// Long options, short keys taken by verilator_utils
+#define OPT_READS    600
 
 static void INTHandler (int signal)
 {
@@ -22,55 +33,45 @@ static void INTHandler (int signal)
   done = true;
 }
 
-static int parse_opt (int key, char *arg, struct argp_state *state)
-{
-  switch (key) {
-    case ARGP_KEY_INIT:
-      state->child_inputs[0] = state->input;
-      break;
-      // Add parsing custom options here
-  }
-  return 0;
-}
-
-// Response status
-typedef enum
-  {
-   OK = 4,
-   WAIT = 2,
-   FAULT = 1,
-   NOCONNECT = 7
-  } stat_t;
-
 class jtag_adiv5_tb : public VerilatorUtils {
 
 private:
   bool _doCycle (void);
   
 public:
-  Vjtag_adiv5 *top;
+  Vjtag_adiv5_bench *top;
   jtag_adiv5_tb ();
   ~jtag_adiv5_tb ();
   bool doCycle (void);
 
-  // Helper functions
-  void Enable (void);
-  void Disable (void);
-
   // DP/AP access
-  void write (uint8_t addr,  bool APnDP, bool RnW, uint32_t data);
-  uint32_t read (void);
-  uint32_t dp_read (uint8_t addr);
-  void dp_write (uint8_t addr, uint32_t data);
-  uint32_t ap_read (uint8_t apsel, uint8_t addr);
-  void ap_write (uint8_t apsel, uint8_t addr, uint32_t data);
+  ADIv5Driver<jtag_adiv5_tb> *adiv5;
+
+  // Read benchmark
+  int reads;
+  int Measure (bool posted, const uint32_t *out, double *cpr);
 };
 
+static int parse_opt (int key, char *arg, struct argp_state *state)
+{
+  jtag_adiv5_tb *tb = (jtag_adiv5_tb *)state->input;
+
+  switch (key) {
+    case ARGP_KEY_INIT:
+      state->child_inputs[0] = state->input;
+      break;
+    case OPT_READS:
+      tb->reads = strtol (arg, NULL, 0);
+      break;
+  }
+  return 0;
+}
+
 static int parse_args (int argc, char **argv, jtag_adiv5_tb *tb)
 {
   struct argp_option options[] =
     {
-     // Add custom options here
+     { "reads", OPT_READS, "CNT", 0, "AP reads per benchmark (0 to skip)" },
      { 0 }
   };
   struct argp_child child_parsers[] =
@@ -84,7 +85,11 @@ static int parse_args (int argc, char **argv, jtag_adiv5_tb *tb)
 
 jtag_adiv5_tb::jtag_adiv5_tb (void) : VerilatorUtils (NULL)
 {
-  top = new Vjtag_adiv5;
+  top = new Vjtag_adiv5_bench;
+  ADIv5Pins<> pins = { &top->WRDATA, &top->WREN, &top->WRFULL,
+                       &top->RDDATA, &top->RDEN, &top->RDEMPTY };
+  adiv5 = new ADIv5Driver<jtag_adiv5_tb> (this, pins);
+  reads = BENCH_READS;
 
   // Enable trace
   top->trace (tfp, 99);
@@ -92,13 +97,12 @@ jtag_adiv5_tb::jtag_adiv5_tb (void) : VerilatorUtils (NULL)
 
 jtag_adiv5_tb::~jtag_adiv5_tb ()
 {
+  delete adiv5;
   delete top;
 }
 
 bool jtag_adiv5_tb::_doCycle (void)
 {
-  uint8_t tdo = 0;
-  
   // Call base function
   if (!VerilatorUtils::doCycle() || done)
     exit (-1);
@@ -115,6 +119,7 @@ bool jtag_adiv5_tb::_doCycle (void)
   // Flip clocks
   top->CLK = !top->CLK;
   top->PHY_CLK = !top->PHY_CLK;
+  top->PHY_CLKn = !top->PHY_CLK;
   
   // Call JTAG client function
   doJTAGClient (top->TCK, &top->TDO, top->TDI, &top->TMS);
@@ -130,110 +135,65 @@ bool jtag_adiv5_tb::doCycle (void)
   return _doCycle ();
 }
 
-void jtag_adiv5_tb::Enable (void)
-{
-  top->ENABLE = 1;
-  doCycle ();
-}
-
-void jtag_adiv5_tb::Disable (void)
-{
-  top->ENABLE = 0;
-  doCycle ();
-}
-
-void jtag_adiv5_tb::write (uint8_t addr, bool APnDP, bool RnW, uint32_t data)
+// DRW reads with autoincrement, posted keeps the command FIFO full
+int jtag_adiv5_tb::Measure (bool posted, const uint32_t *out, double *cpr)
 {
-  // Block if FIFO is full
-  while (top->WRFULL)
-    doCycle ();
-
-  // Setup data
-  top->WRDATA = (uint64_t)data << 4;
-  top->WRDATA |= (addr & 3) << 2;
-  if (APnDP)
-    top->WRDATA |= 1 << 1;
-  if (RnW)
-    top->WRDATA |= 1;
-  
-  // Set WriteEN
-  top->WREN = 1;
-
-  // Toggle clock
-  doCycle ();
-
-  // Clr WriteEN
-  top->WREN = 0;
-}  
-
-uint32_t jtag_adiv5_tb::read (void)
-{
-  // Wait for response
-  while (top->RDEMPTY)
-    doCycle ();
-
-  // Read
-  top->RDEN = 1;
-  doCycle ();
-  top->RDEN = 0;
-  
-  // Check response
-  if ((stat_t)(top->RDDATA & 7) != OK) {
-    int i;
-    printf ("read failed: %d\n", (int)(top->RDDATA & 7));
-    for (i = 0; i < 100; i++)
-      doCycle ();
-    done = true; // Bail
+  uint32_t *in = new uint32_t[reads];
+  uint32_t scans;
+  uint64_t start, cycles, waits = 0;
+  int i, err = 0;
+
+  for (i = 0; i < reads; i++)
+    in[i] = 0;
+
+  // Setup outside of measurement
+  adiv5->APWrite (0, AP_CSW, CSW_DEFAULT | CSW_INC | CSW_SIZE32);
+  adiv5->APWrite (0, AP_TAR, BENCH_ADDR);
+  err |= adiv5->Sync () != SWJ_OK;
+  if (adiv5_target)
+    waits = adiv5_target->waits;
+
+  // Two ticks per cycle
+  scans = top->DRSCANS;
+  start = getTime ();
+  for (i = 0; i < reads; i++) {
+    if (posted)
+      adiv5->APRead (0, AP_DRW, &in[i]);
+    else
+      in[i] = adiv5->APRead (0, AP_DRW);
   }
-  
-  // Return data
-  return (uint32_t)((top->RDDATA >> 3) & 0xffffffff);
-}  
-
-void jtag_adiv5_tb::dp_write (uint8_t addr, uint32_t data)
-{
-  write ((addr >> 2) & 3, 0, 0, data);
-  if (addr != 0xc)
-    read ();
-}
-
-uint32_t jtag_adiv5_tb::dp_read (uint8_t addr)
-{
-  write ((addr >> 2) & 3, 0, 1, 0);
-  return read ();
-}
-
-
-uint32_t jtag_adiv5_tb::ap_read (uint8_t apsel, uint8_t addr)
-{
-  // Write DP[8] = SELECT
-  write (2, 0, 0, (apsel << 24) | addr);
-  read ();
-  
-  // Read AP[addr]
-  write ((addr >> 2) & 3, 1, 1, 0);
-
-  // Get result
-  return read ();
-}
+  err |= adiv5->Sync () != SWJ_OK;
+  cycles = (getTime () - start) / 2;
+  scans = top->DRSCANS - scans;
+  if (adiv5_target)
+    waits = adiv5_target->waits - waits;
+  *cpr = (double)cycles / reads;
+
+  for (i = 0; i < reads; i++)
+    if (in[i] != out[i]) {
+      printf ("Mismatch @ %08X: %08X != %08X\n", BENCH_ADDR + (i * 4), in[i], out[i]);
+      err = 1;
+      break;
+    }
 
-void jtag_adiv5_tb::ap_write (uint8_t apsel, uint8_t addr, uint32_t data)
-{
-  // Write DP[8] = SELECT
-  write (2, 0, 0, (apsel << 24) | addr);
-  read ();
-  
-  // Write AP[addr]
-  write ((addr >> 2) & 3, 1, 0, data);
-  read ();
+  // Each retried scan repeats once per WAIT
+  if (posted && (scans > reads + 1 + waits)) {
+    printf ("Expected %lu scans\n", (unsigned long)(reads + 1 + waits));
+    err = 1;
+  }
+  printf ("%-8s read %8lu cycles %7.2f cycles/read %4u scans %5.2f scans/read%s\n",
+          posted ? "posted" : "blocking", (unsigned long)cycles, *cpr,
+          scans, (double)scans / reads, err ? " FAILED" : "");
+  delete[] in;
+  return err;
 }
 
-
 int main (int argc, char **argv)
 {
-  int i;
+  int i, fails = 0;
   jtag_adiv5_tb *dut = new jtag_adiv5_tb;
-  uint32_t val = 0;
+  uint32_t val = 0, *out;
+  double cpr[2];
 
   // Parse args
   parse_args (argc, argv, dut);
@@ -245,71 +205,78 @@ int main (int argc, char **argv)
   for (i = 0; i < RESET_TIME * 2; i++)
     dut->doCycle ();
   
-  // Enable
-  dut->Enable ();
-
   // Reset
-  dut->dp_write (0xc, 0);
+  dut->adiv5->Reset ();
 
   // Switch to JTAG
-  dut->dp_write (0xc, 1);
+  dut->adiv5->Switch ();
   
   // Get IDCOde
-  printf ("IDCODE=%08X\n", dut->dp_read (0));
+  printf ("IDCODE=%08X\n", dut->adiv5->DPRead (DP_IDCODE));
 
   // Enable AP/DBGPWR
-  dut->dp_write (4, 0x50000000);
+  dut->adiv5->DPWrite (DP_CTRL_STAT, 0x50000000);
 
   // Read back STAT
-  val = dut->dp_read (4);
+  val = dut->adiv5->DPRead (DP_CTRL_STAT);
   printf ("CTRL/STAT=%08X\n", val); 
   if ((val & 0xf0000000) == 0xf0000000)
     printf ("PWR|DBG enabled\n");
 
   // Read IDR
-  printf ("AP[0]=%08X\n", dut->ap_read (0, 0xfc));
+  printf ("AP[0]=%08X\n", dut->adiv5->APRead (0, AP_IDR));
 
   // Read BASE
-  printf ("BASE=%08X\n", dut->ap_read (0, 0xf8));
+  printf ("BASE=%08X\n", dut->adiv5->APRead (0, AP_BASE));
 
   // Write AP[0] = CSW
-  dut->ap_write (0, 0, 0xA2000002);
+  dut->adiv5->APWrite (0, AP_CSW, 0xA2000002);
 
   // Write SCB_DHCSR to TAR
-  dut->ap_write (0, 4, 0xE000EDF0);
+  dut->adiv5->APWrite (0, AP_TAR, 0xE000EDF0);
 
   printf ("Halting processor... ");
   do {
     // Write HALT|DEBUGEN to DRW
-    dut->ap_write (0, 0xc, 0xA05F0003);
+    dut->adiv5->APWrite (0, AP_DRW, 0xA05F0003);
 
     // Read DHCSR
-  } while ((dut->ap_read (0, 0xc) & (1 << 17)) == 0);
-  printf ("OK\n");
+  } while (((dut->adiv5->APRead (0, AP_DRW) & (1 << 17)) == 0) && (dut->adiv5->stat == SWJ_OK));
+  printf ("%s\n", (dut->adiv5->stat == SWJ_OK) ? "OK" : "FAILED");
 
   // TAR = RAM
-  dut->ap_write (0, 4, 0x20000000);
+  dut->adiv5->APWrite (0, AP_TAR, 0x20000000);
 
   // Write to RAM
   printf ("RAM test... ");
-  dut->ap_write (0, 0xc, 0xdeadc0de);
-  if (dut->ap_read (0, 0xc) == 0xdeadc0de)
+  dut->adiv5->APWrite (0, AP_DRW, 0xdeadc0de);
+  if (dut->adiv5->APRead (0, AP_DRW) == 0xdeadc0de)
     printf ("OK\n");
   else
     printf ("FAILED\n");
 
-  // Add padding to end
-  for (i = 0; i < 200; i++)
-    dut->doCycle ();
-
-  // Disable interface
-  dut->Disable ();
+  // Bail on any transfer error
+  if (dut->adiv5->Sync () != SWJ_OK)
+    fail ("Transfer error");
+
+  // Blocking reads need two scans each, posted reads one plus RDBUFF
+  if (dut->reads > 0) {
+    out = new uint32_t[dut->reads];
+    for (i = 0; i < dut->reads; i++)
+      out[i] = 0x9e3779b9 * (i + 1);
+    fails += dut->adiv5->MemWriteBlock (0, BENCH_ADDR, out, dut->reads) != SWJ_OK;
+    fails += dut->Measure (false, out, &cpr[0]);
+    fails += dut->Measure (true, out, &cpr[1]);
+    printf ("posted speedup: %.2fx\n", cpr[0] / cpr[1]);
+    printf ("%s\n", fails ? "FAILED" : "PASSED");
+    delete[] out;
+  }
 
   // Add padding to end
-  for (i = 0; i < 20; i++)
+  for (i = 0; i < 200; i++)
     dut->doCycle ();
   
   // Done
   delete dut;
-  return 0;
+  return fails ? -1 : 0;
 }
@@ -9,6 +9,7 @@
 #include <signal.h>
 #include <argp.h>
 #include <verilator_utils.h>
+#include <ADIv5Driver.h>
 
 #include "Vswd_adiv5.h"
 
@@ -33,15 +34,6 @@ static int parse_opt (int key, char *arg, struct argp_state *state)
   return 0;
 }
 
-// Response status
-typedef enum
-  {
-   OK = 4,
-   WAIT = 2,
-   FAULT = 1,
-   NOCONNECT = 7
-  } stat_t;
-
 class swd_adiv5_tb : public VerilatorUtils {
 
 private:
@@ -58,12 +50,7 @@ public:
   void Disable (void);
 
   // DP/AP access
-  void write (uint8_t addr,  bool APnDP, bool RnW, uint32_t data);
-  uint32_t read (void);
-  uint32_t dp_read (uint8_t addr);
-  void dp_write (uint8_t addr, uint32_t data);
-  uint32_t ap_read (uint8_t apsel, uint8_t addr);
-  void ap_write (uint8_t apsel, uint8_t addr, uint32_t data);
+  ADIv5Driver<swd_adiv5_tb> *adiv5;
 };
 
 static int parse_args (int argc, char **argv, swd_adiv5_tb *tb)
@@ -85,6 +72,9 @@ static int parse_args (int argc, char **argv, swd_adiv5_tb *tb)
 swd_adiv5_tb::swd_adiv5_tb (void) : VerilatorUtils (NULL)
 {
   top = new Vswd_adiv5;
+  ADIv5Pins<> pins = { &top->WRDATA, &top->WREN, &top->WRFULL,
+                       &top->RDDATA, &top->RDEN, &top->RDEMPTY };
+  adiv5 = new ADIv5Driver<swd_adiv5_tb> (this, pins);
 
   // Enable trace
   top->trace (tfp, 99);
@@ -92,6 +82,7 @@ swd_adiv5_tb::swd_adiv5_tb (void) : VerilatorUtils (NULL)
 
 swd_adiv5_tb::~swd_adiv5_tb ()
 {
+  delete adiv5;
   delete top;
 }
 
@@ -142,93 +133,6 @@ void swd_adiv5_tb::Disable (void)
   doCycle ();
 }
 
-void swd_adiv5_tb::write (uint8_t addr, bool APnDP, bool RnW, uint32_t data)
-{
-  // Block if FIFO is full
-  while (top->WRFULL)
-    doCycle ();
-
-  // Setup data
-  top->WRDATA = (uint64_t)data << 4;
-  top->WRDATA |= (addr & 3) << 2;
-  if (APnDP)
-    top->WRDATA |= 1 << 1;
-  if (RnW)
-    top->WRDATA |= 1;
-  
-  // Set WriteEN
-  top->WREN = 1;
-
-  // Toggle clock
-  doCycle ();
-
-  // Clr WriteEN
-  top->WREN = 0;
-}  
-
-uint32_t swd_adiv5_tb::read (void)
-{
-  // Wait for response
-  while (top->RDEMPTY)
-    doCycle ();
-
-  // Read
-  top->RDEN = 1;
-  doCycle ();
-  top->RDEN = 0;
-  
-  // Check response
-  if ((stat_t)(top->RDDATA & 7) != OK) {
-    int i;
-    printf ("read failed: %d\n", (int)(top->RDDATA & 7));
-    for (i = 0; i < 100; i++)
-      doCycle ();
-    done = true; // Bail
-  }
-  
-  // Return data
-  return (uint32_t)((top->RDDATA >> 3) & 0xffffffff);
-}  
-
-void swd_adiv5_tb::dp_write (uint8_t addr, uint32_t data)
-{
-  write ((addr >> 2) & 3, 0, 0, data);
-  if (addr != 0xc)
-    read ();
-}
-
-uint32_t swd_adiv5_tb::dp_read (uint8_t addr)
-{
-  write ((addr >> 2) & 3, 0, 1, 0);
-  return read ();
-}
-
-
-uint32_t swd_adiv5_tb::ap_read (uint8_t apsel, uint8_t addr)
-{
-  // Write DP[8] = SELECT
-  write (2, 0, 0, (apsel << 24) | addr);
-  read ();
-  
-  // Read AP[addr]
-  write ((addr >> 2) & 3, 1, 1, 0);
-
-  // Get result
-  return read ();
-}
-
-void swd_adiv5_tb::ap_write (uint8_t apsel, uint8_t addr, uint32_t data)
-{
-  // Write DP[8] = SELECT
-  write (2, 0, 0, (apsel << 24) | addr);
-  read ();
-  
-  // Write AP[addr]
-  write ((addr >> 2) & 3, 1, 0, data);
-  read ();
-}
-
-
 int main (int argc, char **argv)
 {
   int i;
@@ -249,55 +153,59 @@ int main (int argc, char **argv)
   dut->Enable ();
 
   // Reset
-  dut->dp_write (0xc, 0);
+  dut->adiv5->Reset ();
 
   // Switch to SWD
-  dut->dp_write (0xc, 1);
+  dut->adiv5->Switch ();
   
   // Get IDCOde
-  printf ("IDCODE=%08X\n", dut->dp_read (0));
+  printf ("IDCODE=%08X\n", dut->adiv5->DPRead (DP_IDCODE));
 
   // Enable AP/DBGPWR
-  dut->dp_write (4, 0x50000000);
+  dut->adiv5->DPWrite (DP_CTRL_STAT, 0x50000000);
 
   // Read back STAT
-  val = dut->dp_read (4);
+  val = dut->adiv5->DPRead (DP_CTRL_STAT);
   printf ("CTRL/STAT=%08X\n", val); 
   if ((val & 0xf0000000) == 0xf0000000)
     printf ("PWR|DBG enabled\n");
 
   // Read IDR
-  printf ("AP[0]=%08X\n", dut->ap_read (0, 0xfc));
+  printf ("AP[0]=%08X\n", dut->adiv5->APRead (0, AP_IDR));
 
   // Read BASE
-  printf ("BASE=%08X\n", dut->ap_read (0, 0xf8));
+  printf ("BASE=%08X\n", dut->adiv5->APRead (0, AP_BASE));
 
   // Write AP[0] = CSW
-  dut->ap_write (0, 0, 0xA2000002);
+  dut->adiv5->APWrite (0, AP_CSW, 0xA2000002);
 
   // Write SCB_DHCSR to TAR
-  dut->ap_write (0, 4, 0xE000EDF0);
+  dut->adiv5->APWrite (0, AP_TAR, 0xE000EDF0);
 
   printf ("Halting processor... ");
   do {
     // Write HALT|DEBUGEN to DRW
-    dut->ap_write (0, 0xc, 0xA05F0003);
+    dut->adiv5->APWrite (0, AP_DRW, 0xA05F0003);
 
     // Read DHCSR
-  } while ((dut->ap_read (0, 0xc) & (1 << 17)) == 0);
-  printf ("OK\n");
+  } while (((dut->adiv5->APRead (0, AP_DRW) & (1 << 17)) == 0) && (dut->adiv5->stat == SWJ_OK));
+  printf ("%s\n", (dut->adiv5->stat == SWJ_OK) ? "OK" : "FAILED");
 
   // TAR = RAM
-  dut->ap_write (0, 4, 0x20000000);
+  dut->adiv5->APWrite (0, AP_TAR, 0x20000000);
 
   // Write to RAM
   printf ("RAM test... ");
-  dut->ap_write (0, 0xc, 0xdeadc0de);
-  if (dut->ap_read (0, 0xc) == 0xdeadc0de)
+  dut->adiv5->APWrite (0, AP_DRW, 0xdeadc0de);
+  if (dut->adiv5->APRead (0, AP_DRW) == 0xdeadc0de)
     printf ("OK\n");
   else
     printf ("FAILED\n");
 
+  // Bail on any transfer error
+  if (dut->adiv5->Sync () != SWJ_OK)
+    done = true;
+
   // Add padding to end
   for (i = 0; i < 200; i++)
     dut->doCycle ();
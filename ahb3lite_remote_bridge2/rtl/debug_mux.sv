@@ -25,6 +25,11 @@ module debug_mux #( parameter FIFO_AW = 2 )
     input                               JTAGnSWD,
     // Select direct JTAG PHY interface
     input                               JTAG_DIRECT,
+    // Direct JTAG chain padding, see jtag_chain
+    input [7:0]                         JTAG_IR_PRE,
+    input [7:0]                         JTAG_IR_POST,
+    input [7:0]                         JTAG_DR_PRE,
+    input [7:0]                         JTAG_DR_POST,
     // ADIv5 FIFO interface
     input [ADIv5_CMD_WIDTH-1:0]         ADIv5_WRDATA,
     input                               ADIv5_WREN,
@@ -61,6 +66,13 @@ module debug_mux #( parameter FIFO_AW = 2 )
    logic [JTAG_RESP_WIDTH-1:0]          jtag_RDDATA;
    logic                                jtag_WREN, jtag_RDEN, jtag_WRFULL, jtag_RDEMPTY;
 
+   // JTAG chain signals
+   logic [JTAG_CMD_WIDTH-1:0]           chain_WRDATA;
+   logic [JTAG_RESP_WIDTH-1:0]          chain_RDDATA;
+   logic                                chain_WREN, chain_RDEN, chain_WRFULL, chain_RDEMPTY;
+   logic                                direct_WRFULL, direct_RDEMPTY;
+   logic [JTAG_RESP_WIDTH-1:0]          direct_RDDATA;
+
    // JTAG phy signals
    logic [JTAG_CMD_WIDTH-1:0]           jtag_phy_WRDATA;
    logic [JTAG_RESP_WIDTH-1:0]          jtag_phy_RDDATA;
@@ -82,14 +94,17 @@ module debug_mux #( parameter FIFO_AW = 2 )
    assign ADIv5_RDEMPTY = JTAGnSWD ? jtag_adiv5_RDEMPTY : swd_adiv5_RDEMPTY;
 
    
-   // Mux ADIv5 / JTAG DIRECT
-   assign jtag_phy_WRDATA = JTAG_DIRECT ? JTAG_WRDATA : jtag_WRDATA;
-   assign jtag_phy_WREN   = JTAG_DIRECT ? JTAG_WREN   : jtag_WREN;
-   assign jtag_phy_RDEN   = JTAG_DIRECT ? JTAG_RDEN   : jtag_RDEN;
+   // Mux ADIv5 / JTAG DIRECT through chain padding
+   assign jtag_phy_WRDATA = JTAG_DIRECT ? chain_WRDATA : jtag_WRDATA;
+   assign jtag_phy_WREN   = JTAG_DIRECT ? chain_WREN   : jtag_WREN;
+   assign jtag_phy_RDEN   = JTAG_DIRECT ? chain_RDEN   : jtag_RDEN;
+   assign chain_WRFULL    = JTAG_DIRECT ? jtag_phy_WRFULL : 1'b1;
+   assign chain_RDDATA    = JTAG_DIRECT ? jtag_phy_RDDATA : 0;
+   assign chain_RDEMPTY   = JTAG_DIRECT ? jtag_phy_RDEMPTY : 1'b1;
    // Route to external interface of ADIv5
-   assign JTAG_WRFULL     = JTAG_DIRECT ? jtag_phy_WRFULL : 1'b0;
-   assign JTAG_RDDATA     = JTAG_DIRECT ? jtag_phy_RDDATA : 0;
-   assign JTAG_RDEMPTY    = JTAG_DIRECT ? jtag_phy_RDEMPTY : 1'b1;
+   assign JTAG_WRFULL     = JTAG_DIRECT ? direct_WRFULL : 1'b0;
+   assign JTAG_RDDATA     = JTAG_DIRECT ? direct_RDDATA : 0;
+   assign JTAG_RDEMPTY    = JTAG_DIRECT ? direct_RDEMPTY : 1'b1;
    assign jtag_WRFULL     = JTAG_DIRECT ? 1'b0 : jtag_phy_WRFULL;
    assign jtag_RDDATA     = JTAG_DIRECT ? 0 : jtag_phy_RDDATA;
    assign jtag_RDEMPTY    = JTAG_DIRECT ? 1'b1 : jtag_phy_RDEMPTY;
@@ -114,6 +129,29 @@ module debug_mux #( parameter FIFO_AW = 2 )
                .TDO        (TDO)
                );
    
+   // Instantiate JTAG chain for direct scans
+   jtag_chain #(.FIFO_AW (FIFO_AW))
+   u_jtag_chain (
+                 .CLK         (CLK),
+                 .RESETn      (SYS_RESETn & JTAG_DIRECT),
+                 .IR_PRE      (JTAG_IR_PRE),
+                 .IR_POST     (JTAG_IR_POST),
+                 .DR_PRE      (JTAG_DR_PRE),
+                 .DR_POST     (JTAG_DR_POST),
+                 .WRDATA      (JTAG_WRDATA),
+                 .WREN        (JTAG_WREN),
+                 .WRFULL      (direct_WRFULL),
+                 .RDDATA      (direct_RDDATA),
+                 .RDEN        (JTAG_RDEN),
+                 .RDEMPTY     (direct_RDEMPTY),
+                 .PHY_WRDATA  (chain_WRDATA),
+                 .PHY_WREN    (chain_WREN),
+                 .PHY_WRFULL  (chain_WRFULL),
+                 .PHY_RDDATA  (chain_RDDATA),
+                 .PHY_RDEN    (chain_RDEN),
+                 .PHY_RDEMPTY (chain_RDEMPTY)
+                 );
+   
    // Instantiate SWD phy
    swd_phy #(.FIFO_AW (FIFO_AW + 1))
    u_swd_phy (
@@ -1,6 +1,26 @@
 /**
  *  Convert between HOST FIFO <=> JTAG DIRECT
- * 
+ *
+ *  Scans are packed into host_fifo_pkg frames so the converter can share
+ *  a link through fifo_arb. Header is {A, BBB, L, CMD}, CMD is the
+ *  jtag_phy command and data is little endian, first bit shifted in the
+ *  LSB of the first byte:
+ *
+ *    L=0:  data[BBB]            - LEN is 8 * payload, D0 is RESET/SWITCH/IDLE
+ *    L=1:  LEN data[BBB-1]      - LEN up to 255
+ *    ext:  {A,D2,0,111} N {LEN,0,CMD} data[N-2]
+ *                               - extended frame, 16bit big endian N and
+ *                                 {LEN12,1'b0,CMD3}, scans up to 4095 bits
+ *
+ *  D2 with CMD 111 is the extended header, short IR_READ_AUTO scans pad
+ *  to D4. Missing data bits shift zeros, extra bytes are dropped and
+ *  auto-extend commands only use the first 64 bits.
+ *
+ *  Each jtag_phy response chunk of n bits is returned as {A, BBB, 0000}
+ *  followed by the n bits right justified, little endian, padded to the
+ *  next payload count. The host knows the scan lengths so no length is
+ *  returned.
+ *
  *  All rights reserved.
  *  Tiny Labs Inc
  *  2020
@@ -9,26 +29,230 @@
 module host_jtag_convert
    (
     // System clock and reset
-    input                        CLK,
-    input                        RESETn,
-    // ADIv5 FIFO interface
-    input [7:0]                  HOST_WRDATA,
-    input                        HOST_WREN,
-    output logic                 HOST_WRFULL,
-    output logic [7:0]           HOST_RDDATA,
-    input                        HOST_RDEN,
-    output logic                 HOST_RDEMPTY,
-    // JTAG direct PHY FIFO interface
-    input [JTAG_CMD_WIDTH-1:0]   JTAG_WRDATA,
-    input                        JTAG_WREN,
-    output                       JTAG_WRFULL,
-    output [JTAG_RESP_WIDTH-1:0] JTAG_RDDATA,
-    input                        JTAG_RDEN,
-    output                       JTAG_RDEMPTY
+    input                              CLK,
+    input                              RESETn,
+    // Host FIFO interface
+    output                             HOST_RDEN,
+    input                              HOST_RDEMPTY,
+    input [7:0]                        HOST_RDDATA,
+    output                             HOST_WREN,
+    input                              HOST_WRFULL,
+    output logic [7:0]                 HOST_WRDATA,
+    // JTAG direct PHY FIFO interface, see debug_mux
+    output logic [JTAG_CMD_WIDTH-1:0]  JTAG_WRDATA,
+    output logic                       JTAG_WREN,
+    input                              JTAG_WRFULL,
+    input [JTAG_RESP_WIDTH-1:0]        JTAG_RDDATA,
+    output                             JTAG_RDEN,
+    input                              JTAG_RDEMPTY
     );
 
+   // Import common definitions
+   import host_fifo_pkg::*;
 
-endmodule // host_jtag_convert
+   //
+   // Request side - host frames to jtag_phy packets
+   //
+   typedef enum logic [2:0] {
+                             HDR  = 0,
+                             LEN  = 1,
+                             XLEN = 2,
+                             DATA = 3,
+                             PUT  = 4
+                             } state_t;
+   state_t state;
+
+   // Host byte held until consumed
+   logic                               dvalid;
+
+   // Current scan
+   logic [2:0]                         cmd;
+   logic [11:0]                        len, rem;
+   logic [15:0]                        cnt;
+   logic [1:0]                         xcnt;
+   logic                               first, iface;
+
+   // Chunk being assembled
+   logic [63:0]                        data;
+   logic [3:0]                         nb;
+
+   // Prefetch next byte while busy
+   assign HOST_RDEN = !HOST_RDEMPTY & !dvalid;
+
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          state <= HDR;
+          dvalid <= 0;
+          JTAG_WREN <= 0;
+          iface <= 0;
+          data <= 0;
+          nb <= 0;
+       end
+     else
+       begin
+
+          // Data valid one cycle after read
+          if (HOST_RDEN)
+            dvalid <= 1;
+
+          case (state)
+
+            default: state <= HDR;
+
+            // Decode header, LEN defaults to whole payload bytes
+            HDR:
+              if (dvalid)
+                begin
+                   iface <= HOST_RDDATA[7];
+                   cmd <= HOST_RDDATA[2:0];
+                   cnt <= 16'(fifo_payload (HOST_RDDATA[6:4]));
+                   len <= 12'(fifo_payload (HOST_RDDATA[6:4])) << 3;
+                   rem <= 12'(fifo_payload (HOST_RDDATA[6:4])) << 3;
+                   first <= 1;
+                   xcnt <= 0;
+                   dvalid <= 0;
+                   if (fifo_ext (HOST_RDDATA[6:4], HOST_RDDATA))
+                     state <= XLEN;
+                   else if (HOST_RDDATA[3] & (HOST_RDDATA[6:4] != FIFO_D0))
+                     state <= LEN;
+                   else
+                     state <= DATA;
+                end
+
+            // Short length byte
+            LEN:
+              if (dvalid)
+                begin
+                   len <= {4'h0, HOST_RDDATA};
+                   rem <= {4'h0, HOST_RDDATA};
+                   cnt <= cnt - 1;
+                   dvalid <= 0;
+                   state <= DATA;
+                end
 
+            // Extended length then {LEN,0,CMD}, both big endian
+            XLEN:
+              if (dvalid)
+                begin
+                   dvalid <= 0;
+                   xcnt <= xcnt + 1;
+                   case (xcnt)
+                     0: cnt[15:8] <= HOST_RDDATA;
+                     1: cnt[7:0] <= HOST_RDDATA;
+                     2:
+                       begin
+                          len[11:4] <= HOST_RDDATA;
+                          cnt <= cnt - 1;
+                       end
+                     3:
+                       begin
+                          len[3:0] <= HOST_RDDATA[7:4];
+                          rem <= {len[11:4], HOST_RDDATA[7:4]};
+                          cmd <= HOST_RDDATA[2:0];
+                          cnt <= cnt - 1;
+                          state <= DATA;
+                       end
+                   endcase
+                end
 
+            // Collect up to 8 bytes per chunk
+            DATA:
+              if ((nb == 4'd8) || (cnt == 0))
+                begin
+                   // Send chunk, zero length commands send one packet
+                   if ((rem != 0) || first)
+                     begin
+                        JTAG_WRDATA <= {data, len, cmd};
+                        rem <= (cmd[1] || (rem < 12'd64)) ? 12'd0 : rem - 12'd64;
+                        first <= 0;
+                        state <= PUT;
+                     end
+                   else if (cnt == 0)
+                     state <= HDR;
+                   data <= 0;
+                   nb <= 0;
+                end
+              else if (dvalid)
+                begin
+                   data <= data | (64'(HOST_RDDATA) << {nb[2:0], 3'b000});
+                   nb <= nb + 1;
+                   cnt <= cnt - 1;
+                   dvalid <= 0;
+                end
 
+            // Write packet to PHY
+            PUT:
+              if (JTAG_WREN)
+                begin
+                   JTAG_WREN <= 0;
+                   state <= DATA;
+                end
+              else if (!JTAG_WRFULL)
+                JTAG_WREN <= 1;
+
+          endcase // case (state)
+       end
+
+   //
+   // Response side - jtag_phy chunks to host frames
+   //
+   logic                               rvalid, rpkt;
+   logic [63:0]                        rdat, dato;
+   logic [6:0]                         rn;
+   logic [3:0]                         ocnt;
+   logic                               oready;
+
+   // Read response when packet slot is free
+   assign JTAG_RDEN = !JTAG_RDEMPTY & !rvalid & !rpkt;
+
+   // Header then payload bytes
+   assign HOST_WREN = (ocnt != 0) & !HOST_WRFULL;
+   assign oready = (ocnt == 0) | ((ocnt == 1) & HOST_WREN);
+
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          rvalid <= 0;
+          rpkt <= 0;
+          ocnt <= 0;
+       end
+     else
+       begin
+
+          // Data valid one cycle after read
+          rvalid <= JTAG_RDEN;
+
+          // Right justify packet
+          if (rvalid)
+            begin
+               rn <= (JTAG_RDDATA[5:0] == 0) ? 7'd64 : {1'b0, JTAG_RDDATA[5:0]};
+               rdat <= JTAG_RDDATA[69:6] >> ((JTAG_RDDATA[5:0] == 0) ? 7'd0 : 7'd64 - JTAG_RDDATA[5:0]);
+               rpkt <= 1;
+            end
+
+          // Shift out payload
+          if (HOST_WREN)
+            begin
+               ocnt <= ocnt - 1;
+               HOST_WRDATA <= dato[7:0];
+               dato <= dato >> 8;
+            end
+
+          // Load next response, bytes rounded up to payload count
+          if (rpkt & oready)
+            begin
+               dato <= rdat;
+               rpkt <= 0;
+               case ((rn + 7'd7) >> 3)
+                 1:       begin HOST_WRDATA <= {iface, FIFO_D1, 4'h0}; ocnt <= 2; end
+                 2:       begin HOST_WRDATA <= {iface, FIFO_D2, 4'h0}; ocnt <= 3; end
+                 3, 4:    begin HOST_WRDATA <= {iface, FIFO_D4, 4'h0}; ocnt <= 5; end
+                 5:       begin HOST_WRDATA <= {iface, FIFO_D5, 4'h0}; ocnt <= 6; end
+                 6:       begin HOST_WRDATA <= {iface, FIFO_D6, 4'h0}; ocnt <= 7; end
+                 default: begin HOST_WRDATA <= {iface, FIFO_D8, 4'h0}; ocnt <= 9; end
+               endcase
+            end
+       end
+
+endmodule // host_jtag_convert
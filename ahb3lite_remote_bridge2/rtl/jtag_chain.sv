@@ -0,0 +1,386 @@
+/**
+ *  JTAG chain - address one TAP of a multi-device scan chain through
+ *  jtag_phy. Commands and responses have the same format as jtag_phy,
+ *  each scan is padded with bypass bits for the other TAPs:
+ *
+ *  PRE  - bits shifted out first, TAPs between target and TDO
+ *  POST - bits shifted out last, TAPs between TDI and target
+ *
+ *  IR scans pad with ones (BYPASS) for IR_PRE/IR_POST bits, DR scans
+ *  pad with one zero per bypassed TAP for DR_PRE/DR_POST. The padding
+ *  bits captured on read scans are stripped from the response.
+ *
+ *  Scans longer than 64 bits are streamed as one packet per 64 bit
+ *  chunk, each carrying the same CMD and LEN. Auto-extend commands
+ *  only send the first chunk. Responses are returned in 64 bit chunks
+ *  with a partial last chunk. Zero length commands (RESET/SWITCH/IDLE)
+ *  pass through. Chain config must only change while idle.
+ *
+ *  The padded scan must fit the 12 bit LEN, longer payloads are cut to
+ *  4095 - PRE - POST bits. Their remaining chunks are discarded and the
+ *  response is cut to match.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+module jtag_chain #( parameter FIFO_AW = 2 )
+  (
+   // Core signals
+   input                             CLK,
+   input                             RESETn,
+
+   // Chain config
+   input [7:0]                       IR_PRE,
+   input [7:0]                       IR_POST,
+   input [7:0]                       DR_PRE,
+   input [7:0]                       DR_POST,
+
+   // Client FIFO interface
+   input [JTAG_CMD_WIDTH-1:0]        WRDATA,
+   input                             WREN,
+   output                            WRFULL,
+   output [JTAG_RESP_WIDTH-1:0]      RDDATA,
+   input                             RDEN,
+   output                            RDEMPTY,
+
+   // PHY interface
+   output logic [JTAG_CMD_WIDTH-1:0] PHY_WRDATA,
+   output logic                      PHY_WREN,
+   input                             PHY_WRFULL,
+   input [JTAG_RESP_WIDTH-1:0]       PHY_RDDATA,
+   output                            PHY_RDEN,
+   input                             PHY_RDEMPTY
+   );
+
+   // Low n bits of d
+   function automatic [63:0] low (input [63:0] d, input [6:0] n);
+      low = (n >= 7'd64) ? d : d & ((64'h1 << n) - 64'h1);
+   endfunction
+
+   // Bits to move this step, at most one chunk
+   function automatic [6:0] chunk (input [11:0] rem);
+      chunk = (rem > 12'd64) ? 7'd64 : rem[6:0];
+   endfunction
+
+   // Client command packet
+   logic [63:0]             cdata;
+   logic [11:0]             clen;
+   logic [2:0]              ccmd;
+
+   // Command FIFO
+   logic                    rden, empty, dvalid;
+
+   // Scan descriptor FIFO - PRE, LEN, total for read scans
+   logic [31:0]             desc_in, desc_out;
+   logic                    desc_wren, desc_rden, desc_full, desc_empty, desc_dvalid;
+
+   // Response FIFO
+   logic [JTAG_RESP_WIDTH-1:0] rsp;
+   logic                    wren, full;
+
+   fifo # (
+           .DEPTH_WIDTH (FIFO_AW),
+           .DATA_WIDTH  (JTAG_CMD_WIDTH)
+           )
+   u_cmd_in (
+             .clk       (CLK),
+             .rst       (~RESETn),
+             .wr_data_i (WRDATA),
+             .wr_en_i   (WREN),
+             .full_o    (WRFULL),
+             .rd_data_o ({cdata, clen, ccmd}),
+             .rd_en_i   (rden),
+             .empty_o   (empty)
+             );
+   fifo # (
+           .DEPTH_WIDTH (FIFO_AW),
+           .DATA_WIDTH  (32)
+           )
+   u_desc (
+           .clk       (CLK),
+           .rst       (~RESETn),
+           .wr_data_i (desc_in),
+           .wr_en_i   (desc_wren),
+           .full_o    (desc_full),
+           .rd_data_o (desc_out),
+           .rd_en_i   (desc_rden),
+           .empty_o   (desc_empty)
+           );
+   fifo # (
+           .DEPTH_WIDTH (FIFO_AW),
+           .DATA_WIDTH  (JTAG_RESP_WIDTH)
+           )
+   u_resp_out (
+               .clk       (CLK),
+               .rst       (~RESETn),
+               .wr_data_i (rsp),
+               .wr_en_i   (wren),
+               .full_o    (full),
+               .rd_data_o (RDDATA),
+               .rd_en_i   (RDEN),
+               .empty_o   (RDEMPTY)
+               );
+
+   // Hold next packet while current is shifted
+   assign rden = !empty & !dvalid;
+
+   //
+   // Request side - pad and realign into PHY packets
+   //
+   typedef enum logic [1:0] {
+                             IDLE = 0,
+                             FILL = 1,
+                             PUT  = 2
+                             } state_t;
+   state_t state;
+
+   // Scan in progress
+   logic [2:0]              scmd;
+   logic [11:0]             slen, nlen;
+   logic [7:0]              npre, npost;
+   logic                    pad, auto, first, ext;
+
+   // Padding and payload clamped so the padded scan fits 12 bits
+   logic [8:0]              cpad;
+   logic [12:0]             ctot;
+   logic [11:0]             cplen;
+   logic [6:0]              cskip, nskip;
+   assign cpad = ccmd[2] ? 9'(IR_PRE) + 9'(IR_POST) : 9'(DR_PRE) + 9'(DR_POST);
+   assign ctot = 13'(clen) + 13'(cpad);
+   assign cplen = ctot[12] ? 12'hfff - 12'(cpad) : clen;
+
+   // Client chunks past the clamped payload
+   assign cskip = ccmd[1] ? 7'd0 : 7'((13'(clen) + 13'd63) >> 6) - 7'((13'(cplen) + 13'd63) >> 6);
+
+   // Bit accumulator
+   logic [127:0]            acc;
+   logic [7:0]              abits;
+   logic [6:0]              n;
+
+   // Padding or payload moved this cycle
+   always_comb
+     if (npre != 0)
+       n = chunk ({4'h0, npre});
+     else if (nlen != 0)
+       n = chunk (nlen);
+     else
+       n = chunk ({4'h0, npost});
+
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          state <= IDLE;
+          dvalid <= 0;
+          PHY_WREN <= 0;
+          desc_wren <= 0;
+          npre <= 0;
+          nlen <= 0;
+          npost <= 0;
+          nskip <= 0;
+          abits <= 0;
+          acc <= 0;
+       end
+     else
+       begin
+
+          // Data valid one cycle after read
+          if (rden)
+            dvalid <= 1;
+
+          desc_wren <= 0;
+
+          case (state)
+
+            default: state <= IDLE;
+
+            // Start scan, packet consumed by FILL
+            IDLE:
+              if (dvalid & !desc_full)
+                begin
+                   // RESET/SWITCH/IDLE pass through
+                   if (clen == 0)
+                     begin
+                        PHY_WRDATA <= {cdata, clen, ccmd};
+                        dvalid <= 0;
+                        state <= PUT;
+                     end
+                   else
+                     begin
+                        npre <= ccmd[2] ? IR_PRE : DR_PRE;
+                        npost <= ccmd[2] ? IR_POST : DR_POST;
+                        nlen <= cplen;
+                        nskip <= cskip;
+                        slen <= cplen + 12'(cpad);
+                        scmd <= {ccmd[2], 1'b0, ccmd[0]};
+                        pad <= ccmd[2];
+                        auto <= ccmd[1];
+                        first <= 1;
+                        state <= FILL;
+
+                        // Read scans strip padding from the response
+                        desc_in <= {ccmd[2] ? IR_PRE : DR_PRE, cplen, cplen + 12'(cpad)};
+                        desc_wren <= ccmd[0];
+                     end
+                end
+
+            // Add padding/payload, send full chunks
+            FILL:
+              if ((abits >= 8'd64) || ((npre == 0) && (nlen == 0) && (npost == 0)))
+                begin
+                   if (abits != 0)
+                     begin
+                        PHY_WRDATA <= {acc[63:0], slen, scmd};
+                        acc <= acc >> 64;
+                        abits <= (abits > 8'd64) ? abits - 8'd64 : 8'd0;
+                        state <= PUT;
+                     end
+                   else if (nskip != 0)
+                     begin
+                        // Drop chunks past the clamped payload
+                        if (dvalid)
+                          begin
+                             nskip <= nskip - 1;
+                             dvalid <= 0;
+                          end
+                     end
+                   else
+                     state <= IDLE;
+                end
+              else if (npre != 0)
+                begin
+                   acc <= acc | ({64'h0, low ({64{pad}}, n)} << abits);
+                   abits <= abits + n;
+                   npre <= npre - n;
+                end
+              else if (nlen != 0)
+                begin
+                   // Payload from client, auto-extend repeats MSB
+                   if (first | !auto)
+                     begin
+                        if (dvalid)
+                          begin
+                             acc <= acc | ({64'h0, low (cdata, n)} << abits);
+                             abits <= abits + n;
+                             nlen <= nlen - n;
+                             ext <= cdata[63];
+                             first <= 0;
+                             dvalid <= 0;
+                          end
+                     end
+                   else
+                     begin
+                        acc <= acc | ({64'h0, low ({64{ext}}, n)} << abits);
+                        abits <= abits + n;
+                        nlen <= nlen - n;
+                     end
+                end
+              else
+                begin
+                   acc <= acc | ({64'h0, low ({64{pad}}, n)} << abits);
+                   abits <= abits + n;
+                   npost <= npost - n;
+                end
+
+            // Write packet to PHY
+            PUT:
+              if (PHY_WREN)
+                begin
+                   PHY_WREN <= 0;
+                   state <= FILL;
+                end
+              else if (!PHY_WRFULL)
+                PHY_WREN <= 1;
+
+          endcase // case (state)
+       end
+
+   //
+   // Response side - strip padding and regroup into chunks
+   //
+   logic                    phy_dvalid, rpkt, ractive;
+   logic [63:0]             rdat;
+   logic [6:0]              rn, drop, keep, m;
+   logic [7:0]              rpre;
+   logic [11:0]             rkeep, rrem;
+   logic [127:0]            racc;
+   logic [7:0]              rbits;
+
+   // Read PHY when packet slot is free
+   assign PHY_RDEN = !PHY_RDEMPTY & !phy_dvalid & !rpkt;
+
+   // Read next descriptor when idle
+   assign desc_rden = !desc_empty & !desc_dvalid & !ractive;
+
+   // Padding dropped and payload kept from packet
+   assign drop = ({1'b0, rpre} > rn) ? rn : rpre[6:0];
+   assign keep = (rkeep > (rn - drop)) ? rn - drop : rkeep[6:0];
+
+   // Response chunk size
+   assign m = (rbits > 8'd64) ? 7'd64 : rbits[6:0];
+
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          phy_dvalid <= 0;
+          desc_dvalid <= 0;
+          rpkt <= 0;
+          ractive <= 0;
+          wren <= 0;
+          rbits <= 0;
+          racc <= 0;
+       end
+     else
+       begin
+
+          // Data valid one cycle after read
+          phy_dvalid <= PHY_RDEN;
+          desc_dvalid <= desc_rden;
+
+          wren <= 0;
+
+          // Right justify packet
+          if (phy_dvalid)
+            begin
+               rn <= (PHY_RDDATA[5:0] == 0) ? 7'd64 : {1'b0, PHY_RDDATA[5:0]};
+               rdat <= PHY_RDDATA[69:6] >> ((PHY_RDDATA[5:0] == 0) ? 7'd0 : 7'd64 - PHY_RDDATA[5:0]);
+               rpkt <= 1;
+            end
+
+          // Latch scan descriptor
+          if (desc_dvalid)
+            begin
+               {rpre, rkeep, rrem} <= desc_out;
+               ractive <= 1;
+            end
+
+          // Return full chunks and the last partial, MSB aligned
+          else if ((rbits >= 8'd64) || ((rbits != 0) && (rkeep == 0)))
+            begin
+               if (!full)
+                 begin
+                    rsp <= {racc[63:0] << (7'd64 - m), m[5:0]};
+                    wren <= 1;
+                    racc <= racc >> 64;
+                    rbits <= rbits - m;
+                 end
+            end
+
+          // Scan done
+          else if (ractive & (rrem == 0))
+            ractive <= 0;
+
+          // Strip padding from packet
+          else if (ractive & rpkt)
+            begin
+               racc <= racc | ({64'h0, low (rdat >> drop, keep)} << rbits);
+               rbits <= rbits + keep;
+               rkeep <= rkeep - keep;
+               rpre <= rpre - drop;
+               rrem <= (rrem > rn) ? rrem - rn : 12'd0;
+               rpkt <= 0;
+            end
+       end
+
+endmodule // jtag_chain
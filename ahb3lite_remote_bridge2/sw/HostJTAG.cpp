@@ -0,0 +1,162 @@
+/**
+ *  Host client for host_jtag_convert.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include "HostJTAG.h"
+#include "HostMaster.h"
+#include "err.h"
+
+// Smallest payload count holding n bytes
+static int payload_code (int n)
+{
+  int i;
+
+  for (i = FIFO_D0; i < FIFO_D16; i++)
+    if (fifo_payload[i] >= n)
+      break;
+  return i;
+}
+
+// Response bytes for one chunk of n bits
+static int chunk_resp (int n)
+{
+  return 1 + fifo_payload[payload_code ((n + 7) / 8)];
+}
+
+int HostJTAGScan (uint8_t *buf, uint8_t iface, uint8_t cmd, int len, const uint64_t *data)
+{
+  int i, n, code, cnt = 0;
+  bool whole;
+  uint8_t hdr = (iface ? CMD_IFACE : 0) | (cmd & 7);
+
+  // Data bytes, auto-extend only sends the first chunk
+  n = (len + 7) / 8;
+  if (JTAG_AUTO (cmd) && (n > 8))
+    n = 8;
+
+  // Whole bytes need no length, D2 with CMD 111 is extended
+  code = payload_code (n);
+  whole = (len == n * 8) && (fifo_payload[code] == n) && !HOST_EXT (hdr | (code << 4));
+
+  // Extended frame - big endian count then {LEN,0,CMD}. Also used
+  // when a length byte would push 8 data bytes into D16.
+  if ((len > 64) || (!whole && (n == 8))) {
+    buf[cnt++] = (iface ? CMD_IFACE : 0) | CMD_EXT;
+    buf[cnt++] = (n + 2) >> 8;
+    buf[cnt++] = (n + 2);
+    buf[cnt++] = len >> 4;
+    buf[cnt++] = (len << 4) | (cmd & 7);
+    code = -1;
+  }
+  else if (whole)
+    buf[cnt++] = hdr | (code << 4);
+  else {
+    code = payload_code (n + 1);
+    if (HOST_EXT (hdr | (code << 4)))
+      code = FIFO_D4;
+    buf[cnt++] = hdr | JTAG_LEN | (code << 4);
+    buf[cnt++] = len;
+  }
+
+  // Little endian data, first bit in LSB
+  for (i = 0; i < n; i++)
+    buf[cnt++] = data ? data[i / 8] >> ((i % 8) * 8) : 0;
+
+  // Pad to payload count
+  if (code >= 0)
+    while (cnt < 1 + fifo_payload[code])
+      buf[cnt++] = 0;
+  return cnt;
+}
+
+int HostJTAGResp (uint8_t cmd, int len)
+{
+  int resp = 0;
+
+  if (!JTAG_READ (cmd))
+    return 0;
+  for (; len > 64; len -= 64)
+    resp += chunk_resp (64);
+  if (len)
+    resp += chunk_resp (len);
+  return resp;
+}
+
+HostJTAG::HostJTAG (HostLink *link, uint8_t iface, int window)
+  : HostWindow (link, window, 256)
+{
+  this->iface = iface ? CMD_IFACE : 0;
+  scans = bits = 0;
+}
+
+void HostJTAG::Scan (uint8_t cmd, int len, const uint64_t *tdi, uint64_t *tdo)
+{
+  int resp = HostJTAGResp (cmd, len);
+  size_t off;
+
+  if ((len < 0) || (len > JTAG_SCAN_MAX))
+    fail ("HostJTAG: bad scan len=%d", len);
+
+  // Long scans go alone
+  Reserve (resp);
+
+  off = obuf.size ();
+  obuf.resize (off + JTAG_CMD_MAX);
+  obuf.resize (off + HostJTAGScan (&obuf[off], iface, cmd, len, tdi));
+
+  // Save response destination
+  if (resp)
+    pending.push_back ((pending_t){ tdo, len, 0 });
+  scans++;
+  bits += len;
+}
+
+void HostJTAG::IR (int len, uint64_t tdi, uint64_t *tdo)
+{
+  Scan (tdo ? JTAG_IR_READ : JTAG_IR_WRITE, len, &tdi, tdo);
+}
+
+void HostJTAG::DR (int len, uint64_t tdi, uint64_t *tdo)
+{
+  Scan (tdo ? JTAG_DR_READ : JTAG_DR_WRITE, len, &tdi, tdo);
+}
+
+// One response per chunk, payload count is fixed by the chunk length
+int HostJTAG::Consume (void)
+{
+  uint64_t val;
+  int i, n, cbits;
+
+  if (pending.empty ())
+    return 0;
+  pending_t &p = pending.front ();
+  cbits = p.len - (p.chunk * 64);
+  if (cbits > 64)
+    cbits = 64;
+
+  n = 1 + fifo_payload[(ibuf[0] >> 4) & 7];
+  if (((ibuf[0] & ~0x70) != iface) || (n != chunk_resp (cbits)))
+    fail ("HostJTAG: unexpected response %02X", ibuf[0]);
+  if (ilen < n)
+    return 0;
+
+  // Little endian, right justified
+  for (val = 0, i = n - 1; i > 0; i--)
+    val = (val << 8) | ibuf[i];
+  if (p.dst)
+    p.dst[p.chunk] = val;
+  outstanding -= n;
+  if (++p.chunk == JTAG_CHUNKS (p.len))
+    pending.pop_front ();
+  return n;
+}
+
+void HostJTAG::Flush (void)
+{
+  Send ();
+  Collect (0);
+}
@@ -0,0 +1,97 @@
+/**
+ *  Host client for host_jtag_convert - raw JTAG scans over the host
+ *  FIFO. Scans up to 64 bits use the short frame, whole byte lengths
+ *  without a length byte. Longer scans go in one extended frame and
+ *  come back as one response per 64 bit chunk. Scans are queued and
+ *  sent in one write, read data is valid after Flush.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+#ifndef HOSTJTAG_H
+#define HOSTJTAG_H
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+#include "HostLink.h"
+
+// jtag_phy commands
+#define JTAG_DR_WRITE       0
+#define JTAG_DR_READ        1
+#define JTAG_DR_WRITE_AUTO  2
+#define JTAG_DR_READ_AUTO   3
+#define JTAG_IR_WRITE       4
+#define JTAG_IR_READ        5
+#define JTAG_IR_WRITE_AUTO  6
+#define JTAG_IR_READ_AUTO   7
+
+// Zero length commands
+#define JTAG_RESET          0
+#define JTAG_SWITCH         4
+#define JTAG_IDLE           6
+
+// Command helpers
+#define JTAG_READ(cmd)      ((cmd) & 1)
+#define JTAG_AUTO(cmd)      ((cmd) & 2)
+
+// Length byte present
+#define JTAG_LEN            0x08
+
+// Longest scan, 12bit length
+#define JTAG_SCAN_MAX       4095
+
+// 64 bit chunks for scan
+#define JTAG_CHUNKS(len)    (((len) + 63) / 64)
+
+// Longest command - extended header + data
+#define JTAG_CMD_MAX        (5 + (JTAG_SCAN_MAX + 7) / 8)
+
+// Encode scan into buf, return length. data holds JTAG_CHUNKS words,
+// first bit in bit 0 of data[0].
+int HostJTAGScan (uint8_t *buf, uint8_t iface, uint8_t cmd, int len, const uint64_t *data);
+
+// Response bytes including headers for scan
+int HostJTAGResp (uint8_t cmd, int len);
+
+class HostJTAG : public HostWindow {
+
+ private:
+  uint8_t iface;
+
+  // Expected read scans in order, one response per chunk
+  typedef struct {
+    uint64_t *dst;
+    int len, chunk;
+  } pending_t;
+  std::deque<pending_t> pending;
+
+  int Consume (void);
+
+ public:
+  // Statistics
+  uint64_t scans, bits;
+
+  HostJTAG (HostLink *link, uint8_t iface=0, int window=HOST_WINDOW);
+  ~HostJTAG () {}
+
+  // Queued scan, tdo holds JTAG_CHUNKS words and is valid after Flush.
+  // Auto-extend scans repeat the MSB of tdi[0].
+  void Scan (uint8_t cmd, int len, const uint64_t *tdi, uint64_t *tdo=NULL);
+
+  // Zero length commands
+  void Reset (void) { Scan (JTAG_RESET, 0, NULL); }
+  void Switch (void) { Scan (JTAG_SWITCH, 0, NULL); }
+  void Idle (void) { Scan (JTAG_IDLE, 0, NULL); }
+
+  // Single chunk helpers, read when tdo is set
+  void IR (int len, uint64_t tdi, uint64_t *tdo=NULL);
+  void DR (int len, uint64_t tdi, uint64_t *tdo=NULL);
+
+  // Wait for all responses
+  void Flush (void);
+};
+
+#endif /* HOSTJTAG_H */
@@ -2,10 +2,17 @@
  *  ARM ADIv5.2 debug interface for JTAG - Converts common FIFO interface to JTAG commands
  *
  *  Commands are passed via a FIFO. Input commands have the following format:
- *  [39:0] = DATA[31:0], ADDR[1:0], APnDP, RnW
+ *  [35:0] = DATA[31:0], ADDR[1:0], APnDP, RnW
  * 
  *  Responses are returned through a FIFO with the following format:
  *  [34:0] = DATA[31:0], STAT[2:0]
+ *
+ *  Each DPACC/APACC scan captures the ACK and read result of the
+ *  previous access. A command's response is held pending until the next
+ *  command's scan returns it, so N back to back AP reads take N+1 scans.
+ *  When no command follows the pending result is collected with a DPACC
+ *  RDBUFF read. The next command is pulled from the FIFO while the
+ *  current scan is in flight.
  * 
  *  All rights reserved.
  *  Tiny Labs Inc
@@ -47,9 +54,13 @@ import adiv5_pkg::*;
 `define IR_APACC  35'hB
 `define IR_ABORT  35'h8
 
+// DPACC read of RDBUFF, returns previous result
+`define RDBUFF_READ  35'h7
+
 // Max number of retries
 `define RETRY_MAX  4'd15
 
+
 module jtag_adiv5 #(
                     parameter FIFO_AW = 2
                     )
@@ -75,6 +86,9 @@ module jtag_adiv5 #(
     input                             PHY_RDEMPTY
     );
 
+   // Next command from FIFO
+   logic [ADIv5_CMD_WIDTH-1:0] cmd;
+
    // Command logic
    logic                    APnDP, RnW;
    logic [1:0]              addr;
@@ -99,7 +113,7 @@ module jtag_adiv5 #(
              .wr_data_i (WRDATA),
              .wr_en_i   (WREN),
              .full_o    (WRFULL),
-             .rd_data_o ({dato, addr, APnDP, RnW}),
+             .rd_data_o (cmd),
              .rd_en_i   (rden),
              .empty_o   (empty)
              );
@@ -120,17 +134,23 @@ module jtag_adiv5 #(
 
    // Phy logic
    logic                    phy_dvalid;
+   logic [2:0]              ack;
 
    // Internal logic
    logic [3:0]              retries;
-   logic [3:0]              ir;   // IR cache
-   logic                    idcode;
-              
-   // Are we responding to IDCODE
-   assign idcode = ((PHY_WRDATA[2:0] == `CMD_DR_READ) && (addr == 0) && !APnDP);
-   
-   // Combinatorial logic
-   assign rden = !empty & !busy;
+   logic [3:0]              ir;       // IR cache
+   logic                    pend;     // Previous scan result not returned
+   logic                    collect;  // Collecting pending result from RDBUFF
+   logic                    apacc;
+
+   // ACK of previous access
+   assign ack = PHY_RDDATA[37:35];
+
+   // RDBUFF is always read through DPACC
+   assign apacc = APnDP & !collect;
+
+   // Hold next command while current is in flight
+   assign rden = !empty & !dvalid;
 
    // Read PHY as soon as available
    assign PHY_RDEN = !PHY_RDEMPTY;
@@ -142,16 +162,13 @@ module jtag_adiv5 #(
                              SAVE_IR    = 2,
                              CMD        = 3,
                              IDCODE     = 4,
-                             DPWRITE    = 5,
-                             DPREAD     = 6,
-                             APACCESS   = 7,
-                             FLUSH      = 8,
-                             CHECK      = 9,
-                             RESPONSE   = 10,
-                             ABORT_IR   = 11,
-                             ABORT      = 12,
-                             ABORT_DONE = 13,
-                             RESET_DONE = 14
+                             IDCODE_RSP = 5,
+                             SCAN       = 6,
+                             RESPONSE   = 7,
+                             ABORT_IR   = 8,
+                             ABORT      = 9,
+                             ABORT_DONE = 10,
+                             RESET_DONE = 11
                              } state_t;
    state_t state;
    
@@ -164,42 +181,50 @@ module jtag_adiv5 #(
           dvalid <= 0;
           phy_dvalid <= 0;
           ir <= 4'hf;
+          wren <= 0;
+          busy <= 0;
+          pend <= 0;
+          collect <= 0;
        end
      else
        begin
 
           // Data valid one cycle after read
           if (rden)
-            begin
-               dvalid <= 1;
-               busy <= 1;
-            end
+            dvalid <= 1;
 
           // PHY data available one cycle after read
           if (PHY_RDEN)
             phy_dvalid <= 1;
           else
             phy_dvalid <= 0;
+
+          // Single cycle response write
+          wren <= 0;
           
           // State machine
           case (state)
             
             default: state <= IDLE; // Shouldn't get here
                
-            // Clear wren/busy
             IDLE: 
               begin
-                 wren <= 0;
-                 retries <= 0;
-                 
                  // Latch in command
                  if (dvalid)
                    begin
-                      casez ({addr, APnDP, RnW})
-                        default:  state <= SET_IR;
-                        4'b0001, 4'b1100: state <= CMD;
-                      endcase // casez ({addr, APnDP, RnW})
+                      {dato, addr, APnDP, RnW} <= cmd;
                       dvalid <= 0;
+                      busy <= 1;
+                      retries <= 0;
+                      state <= CMD;
+                   end
+
+                 // Nothing to overlap, collect pending result
+                 else if (pend & !rden)
+                   begin
+                      collect <= 1;
+                      retries <= 0;
+                      state <= SET_IR;
                    end
               end
 
@@ -207,36 +232,38 @@ module jtag_adiv5 #(
             SET_IR:
               begin
                  // Set IR if not same as cache
-                 if (APnDP && (ir != 4'hB))
+                 if (apacc && (ir != 4'hB))
                    `PHY_CMD (SAVE_IR, `CMD_IR_WRITE, 12'd4, `IR_APACC)
-                 else if (!APnDP && (ir != 4'hA))
+                 else if (!apacc && (ir != 4'hA))
                    `PHY_CMD (SAVE_IR, `CMD_IR_WRITE, 12'd4, `IR_DPACC)
                  else
-                   state <= CMD;
+                   state <= SCAN;
               end
 
-            // Save IR and process cmd
+            // Save IR and scan
             SAVE_IR:
               begin
-                 ir <= APnDP ? 4'hB : 4'hA;
-                 state <= CMD;
+                 ir <= apacc ? 4'hB : 4'hA;
+                 state <= SCAN;
               end
             
             // Process command
             CMD:
               begin
-                 // Execute command
                  casez ({addr, APnDP, RnW})
-                   default:  state <= IDLE;
-                   4'b0101, 4'b1?01: state <= DPREAD;   // READ DP[4/8/C]
-                   4'b1000, 4'b0?00: state <= DPWRITE;  // WRITE DP[0/4/8]
-                   4'b??1?: state <= APACCESS;          // READ/WRITE AP
-                   // Pseudo DP registers
+                   default: state <= SET_IR;  // READ/WRITE DP/AP
+                   // Pseudo DP registers, collect pending result first
                    // DP[0]    read - emulate IDCODE found on SWD interface
                    // DP[0xc] write - Handle RESET/line switch
-                   4'b0001: `PHY_CMD (IDCODE, `CMD_RESET, 12'd0, 35'h0) // Read DP[0]
-                   4'b1100: begin                                   // Write DP[0xc]
-                      if (dato[0])
+                   4'b0001, 4'b1100: begin
+                      if (pend)
+                        begin
+                           collect <= 1;
+                           state <= SET_IR;
+                        end
+                      else if (!addr[1])                    // Read DP[0]
+                        `PHY_CMD (IDCODE, `CMD_RESET, 12'd0, 35'h0)
+                      else if (dato[0])                     // Write DP[0xc]
                         `PHY_CMD (RESET_DONE, `CMD_SWITCH, 12'd0, 35'h0)
                       else
                         `PHY_CMD (RESET_DONE, `CMD_RESET, 12'd0, 35'h0)
@@ -244,74 +271,106 @@ module jtag_adiv5 #(
                  endcase // casez ({addr, APnDP, RnW})
               end
 
-            // Done return to IDLE
+            // Done return to IDLE, TAP left in IDCODE
             RESET_DONE:
               begin
+                 ir <= 4'hf;
                  busy <= 0;
                  state <= IDLE;
               end
             
             // Read IDCODE
-            IDCODE:   `PHY_CMD (RESPONSE, `CMD_DR_READ, 12'd32, 35'h0)
-
-            // DP write
-            DPWRITE:  `PHY_CMD (CHECK, `CMD_DR_WRITE, 12'd35, {dato, addr, 1'b0})
-            
-            // DP read
-            DPREAD:   `PHY_CMD (CHECK, `CMD_DR_WRITE, 12'd35, {32'h0, addr, 1'b1})
+            IDCODE:   `PHY_CMD (IDCODE_RSP, `CMD_DR_READ, 12'd32, 35'h0)
 
-            // AP access
-            APACCESS: `PHY_CMD (FLUSH, `CMD_DR_WRITE, 12'd35, {dato, addr, RnW})
+            // Return IDCODE
+            IDCODE_RSP:
+              if (phy_dvalid)
+                begin
+                   ir <= 4'hf;
+                   dati <= PHY_RDDATA[69:38];
+                   stat <= 3'b100;
+                   wren <= 1;
+                   busy <= 0;
+                   state <= IDLE;
+                end
 
-            // Flush AP write
-            FLUSH:    `PHY_CMD (CHECK, `CMD_FLUSH, 12'd0, 35'h0)
-            
-            // Flush DR to check operation
-            CHECK:    `PHY_CMD (RESPONSE, `CMD_DR_READ, 12'd35, 35'h7)
+            // DP/AP access, captures result of previous access
+            SCAN:
+              if (collect)
+                `PHY_CMD (RESPONSE, `CMD_DR_READ, 12'd35, `RDBUFF_READ)
+              else
+                `PHY_CMD (RESPONSE, `CMD_DR_READ, 12'd35, {RnW ? 32'h0 : dato, addr, RnW})
 
             // Set ABORT IR
             ABORT_IR: `PHY_CMD (ABORT, `CMD_IR_WRITE, 12'd4, `IR_ABORT)
 
-            // Write ABORT - Return to IDLE
-            ABORT:    `PHY_CMD (ABORT_DONE, `CMD_DR_WRITE, 12'd35, 35'hf8)
-
-            // Cleanup and return response
-            ABORT_DONE:
+            // Write ABORT
+            ABORT:
               begin
-                 state <= IDLE;
-                 wren <= 1;
-                 busy <= 0;
+                 ir <= 4'h8;
+                 `PHY_CMD (ABORT_DONE, `CMD_DR_WRITE, 12'd35, 35'hf8)
               end
 
-            // Return response to client
+            // Fail pending then current command
+            ABORT_DONE:
+              if (pend)
+                begin
+                   wren <= 1;
+                   pend <= 0;
+                end
+              else
+                begin
+                   collect <= 0;
+
+                   // Pseudo command still runs
+                   if (collect & busy)
+                     state <= CMD;
+                   else
+                     begin
+                        wren <= busy;
+                        busy <= 0;
+                        state <= IDLE;
+                     end
+                end
+
+            // Return pending response to client
             RESPONSE:
               if (phy_dvalid) 
                 begin
 
                    // Anything but 010 is an ERROR
-                   if (idcode || (PHY_RDDATA[37:35] == 3'b010))
+                   if (ack == 3'b010)
                      stat <= 3'b100;
                    else // Translate to SWD wait or FAULT
-                     stat <= (PHY_RDDATA[37:35] == 3'b001) ? 3'b010 : 3'b001;
+                     stat <= (ack == 3'b001) ? 3'b010 : 3'b001;
 
-                   // If past retries or response != WAIT return
-                   if (retries == `RETRY_MAX)
-                     state <= ABORT_IR;
-                   
-                   // Response OK - return
-                   else if (idcode || (PHY_RDDATA[37:35] == 3'b010))
+                   // Scan accepted, previous result is valid
+                   if (ack == 3'b010)
                      begin
-                       // Copy data back
-                       dati <= PHY_RDDATA[69:38];
-                       
-                        // Write to FIFO, return to IDLE
-                       state <= IDLE;
-                       wren <= 1;
-                       busy <= 0;
+                        dati <= PHY_RDDATA[69:38];
+                        wren <= pend;
+                        retries <= 0;
+
+                        // RDBUFF result is never returned
+                        pend <= !collect;
+                        collect <= 0;
+                        if (collect)
+                          state <= busy ? CMD : IDLE;
+                        else
+                          begin
+                             busy <= 0;
+                             state <= IDLE;
+                          end
                      end
-                   else 
-                     begin // Retry transaction
-                        state <= CMD;
+
+                   // Past retries
+                   else if (retries == `RETRY_MAX)
+                     state <= ABORT_IR;
+
+                   // Request dropped, repeat scan
+                   else
+                     begin
+                        state <= SCAN;
                         retries <= retries + 1;
                      end
                    
@@ -76,6 +76,10 @@ int main(int argc, char **argv, char **env)
       new VerilatorUtils((uint32_t *)&top->cm3_min_soc->u_rom->ram_inst->genblk1__DOT__ram_inst->mem_array);
 
 	parse_args(argc, argv, utils);
+
+	// GDB can access ROM directly while halted
+	utils->gdb_server->AddBackdoor (0, sizeof (top->cm3_min_soc->u_rom->ram_inst->genblk1__DOT__ram_inst->mem_array),
+									(uint32_t *)&top->cm3_min_soc->u_rom->ram_inst->genblk1__DOT__ram_inst->mem_array);
 	signal(SIGINT, INThandler);
 
     top->CLK = 0;
@@ -90,6 +94,8 @@ int main(int argc, char **argv, char **env)
 		top->eval();
         top->CLK = !top->CLK;
         utils->doJTAGServer (&top->TCK, top->TDO, &top->TDI, top->TMSOE ? &top->TMSOUT : &top->TMSIN, &top->PORESETn);
+        utils->doGDBServer (&top->TCK, top->TDO, &top->TDI, top->TMSOE ? &top->TMSOUT : &top->TMSIN, &top->PORESETn);
+        utils->doDAPServer (&top->TCK, top->TDO, &top->TDI, top->TMSOE ? &top->TMSOUT : &top->TMSIN, &top->PORESETn);
         utils->doGPIOServer ((uint64_t *)&top->IRQ, 16, 0, 0);
         
 	}
@@ -0,0 +1,203 @@
+/**
+ *  Host benchmark for HostMux - replay captured link traffic (raw bytes
+ *  from the FPGA, see HostMux capture) or synthetic host_master and
+ *  host_slave frames through the demux and report throughput against
+ *  the 12Mbaud line rate.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <argp.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "HostMux.h"
+#include "HostMaster.h"
+#include "err.h"
+
+// Defaults
+#define BENCH_BYTES    (16 * 1024 * 1024)
+#define BENCH_CHUNK    4096
+#define LINE_RATE      1200000.0  // 12Mbaud 8N1 bytes/s
+
+// Serve a buffer in read() sized chunks
+class ReplayLink : public HostLink {
+
+ private:
+  const std::vector<uint8_t> &buf;
+  size_t pos;
+  int chunk;
+
+ public:
+  ReplayLink (const std::vector<uint8_t> &buf, int chunk) : buf (buf), pos (0), chunk (chunk) {}
+  void Send (const uint8_t *, int) {}
+  int Recv (uint8_t *dst, int max)
+  {
+    int n = chunk;
+    if (n > max)
+      n = max;
+    if ((size_t)n > buf.size () - pos)
+      n = buf.size () - pos;
+    memcpy (dst, &buf[pos], n);
+    pos += n;
+    return n;
+  }
+  bool Done (void) { return pos == buf.size (); }
+  void Rewind (void) { pos = 0; }
+};
+
+typedef struct {
+  const char *file;
+  int bytes, chunk, loops;
+} opts_t;
+
+static int parse_opt (int key, char *arg, struct argp_state *state)
+{
+  opts_t *o = (opts_t *)state->input;
+
+  switch (key) {
+    case 'f':
+      o->file = arg;
+      break;
+    case 'n':
+      o->bytes = strtol (arg, NULL, 0);
+      break;
+    case 'c':
+      o->chunk = strtol (arg, NULL, 0);
+      break;
+    case 'l':
+      o->loops = strtol (arg, NULL, 0);
+      break;
+  }
+  return 0;
+}
+
+static void parse_args (int argc, char **argv, opts_t *o)
+{
+  struct argp_option options[] =
+    {
+     { "file", 'f', "FILE", 0, "Captured link traffic" },
+     { "bytes", 'n', "BYTES", 0, "Synthetic traffic size" },
+     { "chunk", 'c', "BYTES", 0, "Bytes per link read" },
+     { "loops", 'l', "CNT", 0, "Replay count" },
+     { 0 }
+  };
+  struct argp argp = { options, parse_opt, 0, 0 };
+  argp_parse (&argp, argc, argv, 0, 0, o);
+}
+
+static void load (const char *file, std::vector<uint8_t> &buf)
+{
+  FILE *fp = fopen (file, "rb");
+  long len;
+
+  if (!fp)
+    fail ("Failed to open %s", file);
+  fseek (fp, 0, SEEK_END);
+  len = ftell (fp);
+  fseek (fp, 0, SEEK_SET);
+  buf.resize (len);
+  if (fread (buf.data (), 1, len, fp) != (size_t)len)
+    fail ("Failed to read %s", file);
+  fclose (fp);
+}
+
+// Interleave host_master responses (port 0) and host_slave requests (port 1)
+static void synth (int bytes, std::vector<uint8_t> &buf)
+{
+  static const uint8_t hdr[4] = {
+    FIFO_D4 << 4,                                 // master word read data
+    FIFO_D0 << 4,                                 // master write ack
+    CMD_IFACE | (FIFO_D4 << 4) | HOST_WORD,       // slave word read
+    CMD_IFACE | (FIFO_D8 << 4) | CMD_WRITE | HOST_WORD, // slave word write
+  };
+  uint32_t rng = 1;
+  int i, len;
+  uint8_t h;
+
+  while ((int)buf.size () < bytes) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    h = hdr[rng & 3];
+    len = fifo_payload[(h & MUX_CNTMASK) >> MUX_CNTSHIFT];
+    buf.push_back (h);
+    for (i = 0; i < len; i++)
+      buf.push_back (rng >> (i * 8));
+  }
+}
+
+// Drop partial frame at end of capture so loops stay aligned
+static void trim (std::vector<uint8_t> &buf)
+{
+  size_t i, len;
+
+  for (i = 0; i < buf.size (); i += len) {
+    len = HostFrameLen (&buf[i], buf.size () - i);
+    if (!len || (i + len > buf.size ()))
+      break;
+  }
+  buf.resize (i);
+}
+
+int main (int argc, char **argv)
+{
+  opts_t o = { NULL, BENCH_BYTES, BENCH_CHUNK, 4 };
+  std::vector<uint8_t> buf;
+  struct timespec start, end;
+  uint64_t sum[MUX_PORTS] = { 0 }, frames = 0;
+  const uint8_t *p;
+  double secs;
+  int i, j, n;
+
+  parse_args (argc, argv, &o);
+  if (o.file)
+    load (o.file, buf);
+  else
+    synth (o.bytes, buf);
+  trim (buf);
+  if (buf.empty ())
+    fail ("No traffic");
+
+  ReplayLink link (buf, o.chunk);
+  HostMux mux (&link);
+
+  // Drain both ports in place after each link read
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < o.loops; i++) {
+    link.Rewind ();
+    while (!link.Done ()) {
+      mux.Poll ();
+      for (j = 0; j < MUX_PORTS; j++)
+        while ((n = mux.Port (j)->Peek (&p, false))) {
+          sum[j] += p[0] + n;
+          mux.Port (j)->Release (n);
+        }
+    }
+  }
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  for (j = 0; j < MUX_PORTS; j++) {
+    frames += mux.Port (j)->frames;
+    printf ("port%d: %lu frames %lu bytes (sum %lx)\n", j,
+            (unsigned long)mux.Port (j)->frames, (unsigned long)mux.Port (j)->rx_bytes,
+            (unsigned long)sum[j]);
+  }
+  printf ("%lu bytes %lu frames %lu reads in %.3fs\n", (unsigned long)mux.rx_bytes,
+          (unsigned long)frames, (unsigned long)mux.reads, secs);
+  printf ("%.1f MB/s %.2f Mframes/s %.0fx 12Mbaud line rate\n", mux.rx_bytes / secs / 1e6,
+          frames / secs / 1e6, mux.rx_bytes / secs / LINE_RATE);
+
+  // Every byte must be routed
+  if (mux.Port (0)->rx_bytes + mux.Port (1)->rx_bytes != mux.rx_bytes) {
+    printf ("FAILED: %lu bytes unframed\n",
+            (unsigned long)(mux.rx_bytes - mux.Port (0)->rx_bytes - mux.Port (1)->rx_bytes));
+    return -1;
+  }
+  printf ("PASSED\n");
+  return 0;
+}
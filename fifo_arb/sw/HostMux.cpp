@@ -0,0 +1,215 @@
+/**
+ *  Host side of fifo_arb.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <string.h>
+
+#include "HostMux.h"
+#include "HostMaster.h"
+#include "err.h"
+
+#define RING_MASK       (MUX_RING_SIZE - 1)
+#define RING(off)       ring[(off) & RING_MASK]
+
+void MuxPort::Send (const uint8_t *buf, int len)
+{
+  mux->Send (this, buf, len);
+}
+
+int MuxPort::Recv (uint8_t *buf, int max)
+{
+  const uint8_t *p;
+  int n, cnt = 0;
+
+  // Block for first span then take whatever else is queued
+  n = mux->Span (this, &p, true);
+  while (n && (cnt < max)) {
+    if (n > max - cnt)
+      n = max - cnt;
+    memcpy (&buf[cnt], p, n);
+    mux->Release (this, n);
+    cnt += n;
+    n = mux->Span (this, &p, false);
+  }
+  return cnt;
+}
+
+int MuxPort::Peek (const uint8_t **p, bool block)
+{
+  return mux->Span (this, p, block);
+}
+
+void MuxPort::Release (int n)
+{
+  mux->Release (this, n);
+}
+
+HostMux::HostMux (HostLink *link, FILE *capture)
+{
+  int i;
+
+  this->link = link;
+  this->capture = capture;
+  ring = new uint8_t[MUX_RING_SIZE];
+  head = tail = parsed = 0;
+  reading = false;
+  rx_bytes = tx_bytes = reads = 0;
+  for (i = 0; i < MUX_PORTS; i++) {
+    port[i].mux = this;
+    port[i].id = i;
+  }
+  pthread_mutex_init (&lock, NULL);
+  pthread_mutex_init (&tx_lock, NULL);
+  pthread_cond_init (&cond, NULL);
+}
+
+HostMux::~HostMux ()
+{
+  pthread_cond_destroy (&cond);
+  pthread_mutex_destroy (&tx_lock);
+  pthread_mutex_destroy (&lock);
+  delete[] ring;
+}
+
+// Called with lock held
+void HostMux::Parse (void)
+{
+  uint8_t hdr;
+  uint32_t len;
+  MuxPort *p;
+
+  while (head != parsed) {
+    hdr = RING (parsed);
+
+    // Extended frames carry length after header
+    if (HOST_EXT (hdr)) {
+      if (head - parsed < 3)
+        break;
+      len = 3 + ((RING (parsed + 1) << 8) | RING (parsed + 2));
+    }
+    else
+      len = 1 + fifo_payload[(hdr & MUX_CNTMASK) >> MUX_CNTSHIFT];
+    if (head - parsed < len)
+      break;
+
+    // Route by SELMASK
+    frames.push_back ((frame_t){ parsed, len, false });
+    p = &port[(hdr & MUX_SELMASK) ? 1 : 0];
+    p->q.push_back (&frames.back ());
+    p->frames++;
+    p->rx_bytes += len;
+    parsed += len;
+  }
+}
+
+// Called with lock held, drops lock while reading
+void HostMux::Fill (void)
+{
+  uint32_t room, off;
+  int n;
+
+  // Someone else is already reading
+  if (reading) {
+    pthread_cond_wait (&cond, &lock);
+    return;
+  }
+
+  // Read into contiguous free space
+  off = head & RING_MASK;
+  room = MUX_RING_SIZE - (head - tail);
+  if (room > MUX_RING_SIZE - off)
+    room = MUX_RING_SIZE - off;
+  if (!room)
+    fail ("HostMux: ring full, port not draining");
+  reading = true;
+  pthread_mutex_unlock (&lock);
+  n = link->Recv (&ring[off], room);
+  if (capture)
+    fwrite (&ring[off], 1, n, capture);
+  pthread_mutex_lock (&lock);
+  head += n;
+  rx_bytes += n;
+  reads++;
+  Parse ();
+  reading = false;
+  pthread_cond_broadcast (&cond);
+}
+
+void HostMux::Poll (void)
+{
+  pthread_mutex_lock (&lock);
+  Fill ();
+  pthread_mutex_unlock (&lock);
+}
+
+int HostMux::Span (MuxPort *p, const uint8_t **buf, bool block)
+{
+  frame_t *f;
+  uint32_t off, n;
+
+  pthread_mutex_lock (&lock);
+  while (p->q.empty ()) {
+    if (!block) {
+      pthread_mutex_unlock (&lock);
+      return 0;
+    }
+    Fill ();
+  }
+
+  // Stop at frame end or ring wrap
+  f = p->q.front ();
+  off = (f->off + p->pos) & RING_MASK;
+  n = f->len - p->pos;
+  if (n > MUX_RING_SIZE - off)
+    n = MUX_RING_SIZE - off;
+  *buf = &ring[off];
+  pthread_mutex_unlock (&lock);
+  return n;
+}
+
+void HostMux::Release (MuxPort *p, int n)
+{
+  frame_t *f;
+
+  pthread_mutex_lock (&lock);
+  p->pos += n;
+  while (!p->q.empty () && (p->pos >= p->q.front ()->len)) {
+    f = p->q.front ();
+    p->pos -= f->len;
+    f->done = true;
+    p->q.pop_front ();
+  }
+
+  // Reclaim in arrival order
+  while (!frames.empty () && frames.front ().done) {
+    tail += frames.front ().len;
+    frames.pop_front ();
+  }
+  pthread_mutex_unlock (&lock);
+}
+
+void HostMux::Send (MuxPort *p, const uint8_t *buf, int len)
+{
+  int i, n;
+
+  // fifo_arb_rx routes whole frames by header
+  for (i = 0; i < len; i += n) {
+    if (!!(buf[i] & MUX_SELMASK) != p->id)
+      fail ("HostMux: frame %02X sent on port %d", buf[i], p->id);
+    if (!(n = HostFrameLen (&buf[i], len - i)))
+      break;
+  }
+  if (i != len)
+    fail ("HostMux: partial frame on port %d", p->id);
+
+  // Pass straight through
+  pthread_mutex_lock (&tx_lock);
+  link->Send (buf, len);
+  tx_bytes += len;
+  p->tx_bytes += len;
+  pthread_mutex_unlock (&tx_lock);
+}
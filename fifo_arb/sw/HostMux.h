@@ -0,0 +1,104 @@
+/**
+ *  Host side of fifo_arb - splits one physical link into two HostLinks
+ *  selected by the SELMASK bit of each frame header. Received bytes
+ *  land once in a shared ring and are handed to each port as frame
+ *  spans (Peek/Release) without copying. Ring space is reclaimed in
+ *  arrival order once frames from both ports are released.
+ *
+ *  Port numbers match the interface bit: port 1 has SELMASK set.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+#ifndef HOSTMUX_H
+#define HOSTMUX_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <deque>
+
+#include "HostLink.h"
+
+// fifo_arb header fields
+#define MUX_SELMASK     0x80
+#define MUX_CNTMASK     0x70
+#define MUX_CNTSHIFT    4
+#define MUX_PORTS       2
+
+// Receive ring, power of 2 - holds a full extended frame
+#define MUX_RING_SIZE   131072
+
+// Received frame in ring
+typedef struct {
+  uint32_t off, len;
+  bool done;
+} frame_t;
+
+class HostMux;
+
+class MuxPort : public HostLink {
+  friend class HostMux;
+
+ private:
+  HostMux *mux;
+  int id;
+
+  // Frames routed here, bytes consumed of first
+  std::deque<frame_t *> q;
+  uint32_t pos;
+
+ public:
+  // Statistics
+  uint64_t frames, rx_bytes, tx_bytes;
+
+  MuxPort () : mux (NULL), id (0), pos (0), frames (0), rx_bytes (0), tx_bytes (0) {}
+
+  // Whole frames only
+  void Send (const uint8_t *buf, int len);
+  int Recv (uint8_t *buf, int max);
+
+  // Zero copy - contiguous received bytes, 0 if none and !block
+  int Peek (const uint8_t **p, bool block=true);
+  void Release (int n);
+};
+
+class HostMux {
+  friend class MuxPort;
+
+ private:
+  HostLink *link;
+  MuxPort port[MUX_PORTS];
+  FILE *capture;
+
+  // Free running ring counters
+  uint8_t *ring;
+  uint32_t head, tail, parsed;
+  std::deque<frame_t> frames;
+
+  // One reader at a time on the physical link
+  bool reading;
+  pthread_mutex_t lock, tx_lock;
+  pthread_cond_t cond;
+
+  void Fill (void);
+  void Parse (void);
+  int Span (MuxPort *p, const uint8_t **buf, bool block);
+  void Release (MuxPort *p, int n);
+  void Send (MuxPort *p, const uint8_t *buf, int len);
+
+ public:
+  // Statistics
+  uint64_t rx_bytes, tx_bytes, reads;
+
+  HostMux (HostLink *link, FILE *capture=NULL);
+  ~HostMux ();
+
+  MuxPort *Port (int sel) { return &port[sel ? 1 : 0]; }
+
+  // Read physical link once and route frames
+  void Poll (void);
+};
+
+#endif /* HOSTMUX_H */
@@ -5,6 +5,7 @@
  *    SELMASK -  This is a bitmask that when matched will route data to fifo c1
  *               If not matched data will route to fifo c2.
  *    CNTMASK -  Mask pointing to contiguous CNT bits. Only 3 bits for count currently supported.
+ *               Extended frames (see host_fifo_pkg) carry a 16bit length after the header.
  *    DWIDTH  -  Data width
  *    AWIDTH  -  Address width of instantiated FIFOs.
  * 
@@ -83,7 +84,9 @@ module fifo_arb_rx #(
 
    // Internal logic
    logic                          data_valid;
-   logic [FIFO_PAYLOAD_WIDTH-1:0] dcnt;
+   logic [FIFO_EXT_WIDTH-1:0]     dcnt;
+   logic                          ext;   // Receiving extended length
+   logic [7:0]                    xlen;  // Extended length high byte
    wire                           sel;
    logic                          psel;
    wire [DWIDTH-1:0]              cmd;
@@ -107,13 +110,17 @@ module fifo_arb_rx #(
              dcnt       <= 0;
              pcmd       <= 0;
              psel       <= 0;
+             ext        <= 0;
           end
         else 
           begin
 
              // Decode count field
              if (data_valid && (dcnt == 0))
-               dcnt <= fifo_payload (FIFO_CNT_WIDTH'((32'(cmd) >> CSHIFT) & CMASK));
+               begin
+                  dcnt <= FIFO_EXT_WIDTH'(fifo_payload (FIFO_CNT_WIDTH'((32'(cmd) >> CSHIFT) & CMASK)));
+                  ext <= fifo_ext (FIFO_CNT_WIDTH'((32'(cmd) >> CSHIFT) & CMASK), cmd);
+               end
                    
              // data_valid lags by one cycle
              if (fifo_rden)
@@ -123,7 +130,20 @@ module fifo_arb_rx #(
 
              // Decrement if data valid
              if (data_valid & (dcnt != 0))
-                 dcnt <= dcnt - 1;
+               begin
+                  dcnt <= dcnt - 1;
+
+                  // Extended length replaces count
+                  if (ext)
+                    begin
+                       xlen <= fifo_rddata;
+                       if (dcnt == 1)
+                         begin
+                            dcnt <= {xlen, fifo_rddata};
+                            ext <= 0;
+                         end
+                    end
+               end
 
              // Save to prevent feedback
              pcmd <= cmd;
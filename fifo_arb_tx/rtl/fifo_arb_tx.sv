@@ -5,6 +5,7 @@
  *    SELMASK -  This is a bitmask that when matched will route data to fifo c1
  *               If not matched data will route to fifo c2.
  *    CNTMASK -  Mask pointing to contiguous CNT bits. Only 3 bits for count currently supported.
+ *               Extended frames (see host_fifo_pkg) carry a 16bit length after the header.
  *    DWIDTH  -  Data width
  *    AWIDTH  -  Address width of instantiated FIFOs.
  * 
@@ -84,7 +85,9 @@ module fifo_arb_tx #(
    logic                          data_valid;
    logic                          c1_prden, c2_prden;
    logic                          c1_psel, c2_psel;
-   logic [FIFO_PAYLOAD_WIDTH-1:0] dcnt;
+   logic [FIFO_EXT_WIDTH-1:0]     dcnt;
+   logic                          ext;   // Receiving extended length
+   logic [7:0]                    xlen;  // Extended length high byte
    wire [DWIDTH-1:0]              data;
    logic [DWIDTH-1:0]             store; // Buffer value if wrfull goes high mid transfer
    wire                           hold;
@@ -122,6 +125,7 @@ module fifo_arb_tx #(
              c2_psel <= 0;
              data_valid <= 0;
              dcnt <= 0;
+             ext <= 0;
              backpressure <= 0;
           end
         else 
@@ -129,7 +133,10 @@ module fifo_arb_tx #(
 
              // Assign cnt
              if (data_valid && (dcnt == 0))
-               dcnt <= fifo_payload (FIFO_CNT_WIDTH'((32'(data) >> CSHIFT) & CMASK));
+               begin
+                  dcnt <= FIFO_EXT_WIDTH'(fifo_payload (FIFO_CNT_WIDTH'((32'(data) >> CSHIFT) & CMASK)));
+                  ext <= fifo_ext (FIFO_CNT_WIDTH'((32'(data) >> CSHIFT) & CMASK), data);
+               end
 
              // Data is valid if either enable was asserted last cycle
              if (c1_rden | c2_rden)
@@ -139,7 +146,20 @@ module fifo_arb_tx #(
 
              // Decrement data count
              if (data_valid & (dcnt != 0))
-               dcnt <= dcnt - 1;
+               begin
+                  dcnt <= dcnt - 1;
+
+                  // Extended length replaces count
+                  if (ext)
+                    begin
+                       xlen <= data;
+                       if (dcnt == 1)
+                         begin
+                            dcnt <= {xlen, data};
+                            ext <= 0;
+                         end
+                    end
+               end
 
              // Save value if sink buffer full
              if (fifo_wrfull & data_valid & ~backpressure)
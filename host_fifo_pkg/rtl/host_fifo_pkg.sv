@@ -21,6 +21,11 @@ package host_fifo_pkg;
      FIFO_D8  = 3'b110,
      FIFO_D16 = 3'b111;
 
+   // Extended frame - D2 count with low header bits set. Payload is
+   // a 16bit big endian length followed by that many bytes.
+   parameter FIFO_EXT_WIDTH = 16;
+   parameter [7:0] FIFO_EXT_MASK = 8'h07;
+
    // Calculate bytes from cnt val
    function [FIFO_PAYLOAD_WIDTH-1:0] fifo_payload;
       input [FIFO_CNT_WIDTH-1:0] val;
@@ -36,4 +41,12 @@ package host_fifo_pkg;
         FIFO_D16: fifo_payload = 16;
       endcase
    endfunction
+
+   // Check for extended frame given cnt val and header
+   function fifo_ext;
+      input [FIFO_CNT_WIDTH-1:0] val;
+      input [7:0]                hdr;
+
+      fifo_ext = (val == FIFO_D2) && ((hdr & FIFO_EXT_MASK) == FIFO_EXT_MASK);
+   endfunction
 endpackage
@@ -59,7 +59,7 @@
 `define	RXUL_WAIT		4'h9
 `define	RXUL_IDLE		4'hf
 
-module rxuartlite(i_clk, i_uart_rx, o_wr, o_data);
+module rxuartlite(i_clk, i_clocks_per_baud, i_uart_rx, o_wr, o_data);
 	parameter			TIMER_BITS = 10;
 `ifdef	FORMAL
 	parameter  [(TIMER_BITS-1):0]	CLOCKS_PER_BAUD = 16; // Necessary for formal proof
@@ -68,6 +68,8 @@ module rxuartlite(i_clk, i_uart_rx, o_wr, o_data);
 `endif
 	localparam			TB = TIMER_BITS;
 	input	wire		i_clk;
+	// Runtime divisor, CLOCKS_PER_BAUD is only used for formal
+	input	wire	[(TB-1):0]	i_clocks_per_baud;
 	input	wire		i_uart_rx;
 	output	reg		o_wr;
 	output	reg	[7:0]	o_data;
@@ -76,7 +78,7 @@ module rxuartlite(i_clk, i_uart_rx, o_wr, o_data);
 	wire	[(TB-1):0]	half_baud;
 	reg	[3:0]		state;
 
-	assign	half_baud = { 1'b0, CLOCKS_PER_BAUD[(TB-1):1] };
+	assign	half_baud = { 1'b0, i_clocks_per_baud[(TB-1):1] };
 	reg	[(TB-1):0]	baud_counter;
 	reg			zero_baud_counter;
 
@@ -172,11 +174,11 @@ module rxuartlite(i_clk, i_uart_rx, o_wr, o_data);
 	initial	baud_counter = 0;
 	always @(posedge i_clk)
 	if (((state==`RXUL_IDLE))&&(!ck_uart)&&(half_baud_time))
-		baud_counter <= CLOCKS_PER_BAUD-1'b1;
+		baud_counter <= i_clocks_per_baud-1'b1;
 	else if (state == `RXUL_WAIT)
 		baud_counter <= 0;
 	else if ((zero_baud_counter)&&(state < `RXUL_STOP))
-		baud_counter <= CLOCKS_PER_BAUD-1'b1;
+		baud_counter <= i_clocks_per_baud-1'b1;
 	else if (!zero_baud_counter)
 		baud_counter <= baud_counter-1'b1;
 
@@ -213,6 +215,10 @@ module rxuartlite(i_clk, i_uart_rx, o_wr, o_data);
 	global clocking @(posedge gbl_clk); endclocking
 `endif
 
+	// Proof runs at the fixed divisor
+	always @(*)
+		`ASSUME(i_clocks_per_baud == CLOCKS_PER_BAUD);
+
 
 	localparam	F_CKRES = 10;
 
@@ -705,7 +711,7 @@ module rxuartlite(i_clk, i_uart_rx, o_wr, o_data);
 	always @(*)
 		assert(zero_baud_counter == (baud_counter == 0)? 1'b1:1'b0);
 	always @(*)
-		assert(baud_counter <= CLOCKS_PER_BAUD-1'b1);
+		assert(baud_counter <= i_clocks_per_baud-1'b1);
 
 `endif
 
@@ -63,11 +63,13 @@
 `define	TXUL_IDLE	4'hf
 //
 //
-module txuartlite(i_clk, i_wr, i_data, o_uart_tx, o_busy);
+module txuartlite(i_clk, i_clocks_per_baud, i_wr, i_data, o_uart_tx, o_busy);
 	parameter	[4:0]	TIMING_BITS = 5'd24;
 	localparam		TB = TIMING_BITS;
 	parameter	[(TB-1):0]	CLOCKS_PER_BAUD = 8; // 24'd868;
 	input	wire		i_clk;
+	// Runtime divisor, CLOCKS_PER_BAUD is only used for formal
+	input	wire	[(TB-1):0]	i_clocks_per_baud;
 	input	wire		i_wr;
 	input	wire	[7:0]	i_data;
 	// And the UART input line itself
@@ -216,14 +218,14 @@ module txuartlite(i_clk, i_wr, i_data, o_uart_tx, o_busy);
 			zero_baud_counter <= 1'b1;
 			if ((i_wr)&&(!r_busy))
 			begin
-				baud_counter <= CLOCKS_PER_BAUD - 1'b1;
+				baud_counter <= i_clocks_per_baud - 1'b1;
 				zero_baud_counter <= 1'b0;
 			end
 		end else if ((zero_baud_counter)&&(state == 4'h9))
 		  begin
              if (i_wr)
                begin
-				  baud_counter <= CLOCKS_PER_BAUD - 1'b1;
+				  baud_counter <= i_clocks_per_baud - 1'b1;
 				  zero_baud_counter <= 1'b0;
                end
              else
@@ -234,7 +236,7 @@ module txuartlite(i_clk, i_wr, i_data, o_uart_tx, o_busy);
 		end else if (!zero_baud_counter)
 			baud_counter <= baud_counter - 1'b1;
 		else
-			baud_counter <= CLOCKS_PER_BAUD - 1'b1;
+			baud_counter <= i_clocks_per_baud - 1'b1;
 	end
 	// }}}
 //
@@ -259,6 +261,10 @@ module txuartlite(i_clk, i_wr, i_data, o_uart_tx, o_busy);
 	always @(posedge i_clk)
 		f_past_valid <= 1'b1;
 
+	// Proof runs at the fixed divisor
+	always @(*)
+		`ASSUME(i_clocks_per_baud == CLOCKS_PER_BAUD);
+
 	initial	`ASSUME(!i_wr);
 	always @(posedge i_clk)
 		if ((f_past_valid)&&($past(i_wr))&&($past(o_busy)))
@@ -1,80 +1,168 @@
 /* Instantiate simple 8N1 UART receiver/transmitter. Connect to external dual-clock FIFO.
- * 
+ *
+ * Baud divisor is CLOCKS_PER_BAUD, or DIV when RUNTIME_DIV is set. DIV
+ * must only change while both directions are idle.
+ *
+ * LANES > 1 stripes the byte stream across parallel UARTs: byte n goes
+ * out on TX_PIN[n % LANES] and is read back in the same order from
+ * RX_PIN. Each RX lane holds one byte for the FIFO. A byte that arrives
+ * on the lane next in order while its holding register is still full
+ * counts as DROPPED. A byte that arrives on any other full lane means
+ * that lane ran a whole round ahead - it counts as OVERRUN, bytes held
+ * in the other lanes are discarded and the order restarts at that lane.
+ * Both counters saturate.
+ *
  *  All rights reserved.
  *  Tiny Labs Inc
  *  2020
  */
-module uart_fifo
+module uart_fifo #(
+                   parameter CLOCKS_PER_BAUD = 4, // 12Mbaud @ 48MHz
+                   parameter TIMER_BITS      = 8,
+                   parameter RUNTIME_DIV     = 0,
+                   parameter LANES           = 1,
+                   parameter CNT_WIDTH       = 32
+                   )
   (
    /* Clock */
-   input              CLK,
-   input              RESETn,
+   input                        CLK,
+   input                        RESETn,
+   /* Runtime baud divisor */
+   input [TIMER_BITS-1:0]       DIV,
    /* Physical pins */
-   output             TX_PIN,
-   input              RX_PIN,
+   output [LANES-1:0]           TX_PIN,
+   input [LANES-1:0]            RX_PIN,
    /* FIFO interface */
-   output logic       FIFO_WREN,
-   input              FIFO_FULL,
-   output [7:0]       FIFO_DOUT,
-   output logic       FIFO_RDEN,
-   input              FIFO_EMPTY,
-   input [7:0]        FIFO_DIN,
+   output                       FIFO_WREN,
+   input                        FIFO_FULL,
+   output [7:0]                 FIFO_DOUT,
+   output                       FIFO_RDEN,
+   input                        FIFO_EMPTY,
+   input [7:0]                  FIFO_DIN,
    /* Dropped bytes due to FIFO congestion */
-   output logic [9:0] DROPPED
+   output logic [CNT_WIDTH-1:0] DROPPED,
+   /* Dropped bytes due to lane skew */
+   output logic [CNT_WIDTH-1:0] OVERRUN
 );
 
-   localparam TIMER_BITS = 4;
+   localparam LW = (LANES > 1) ? $clog2 (LANES) : 1;
 
-   // Local logic
-   logic        tx_busy, dvalid, wren;
-   
-   // Read when not empty or busy
-   assign FIFO_RDEN = !FIFO_EMPTY & !dvalid;
+   // Baud divisor
+   logic [TIMER_BITS-1:0] div;
+   assign div = RUNTIME_DIV ? DIV : CLOCKS_PER_BAUD;
 
-   // Write when valid and not full
-   assign FIFO_WREN = wren & !FIFO_FULL;
-      
-   // Data valid on next cycle
+   // Transmit lanes
+   logic [LANES-1:0]      tx_busy, tx_valid;
+   logic [7:0]            tx_data [LANES];
+   logic [LW-1:0]         tsel;
+   logic                  rpend;
+
+   // Receive lanes
+   logic [LANES-1:0]      rx_wr, rx_full;
+   logic [7:0]            rx_out [LANES];
+   logic [7:0]            rx_data [LANES];
+   logic [LW-1:0]         rsel;
+
+   // Read when next lane is free
+   assign FIFO_RDEN = !FIFO_EMPTY & !tx_valid[tsel] & !rpend;
+
+   // Write held bytes in lane order
+   assign FIFO_WREN = rx_full[rsel] & !FIFO_FULL;
+   assign FIFO_DOUT = rx_data[rsel];
+
+   // Data valid on next cycle, hold until lane accepts it
    always @(posedge CLK)
      if (!RESETn)
        begin
-          dvalid <= 0;
+          tx_valid <= 0;
+          tsel <= 0;
+          rpend <= 0;
+       end
+     else
+       begin
+          rpend <= FIFO_RDEN;
+          for (int i = 0; i < LANES; i++)
+            if (!tx_busy[i])
+              tx_valid[i] <= 0;
+          if (rpend)
+            begin
+               tx_valid[tsel] <= 1;
+               tx_data[tsel] <= FIFO_DIN;
+               tsel <= (tsel == LANES - 1) ? 0 : tsel + 1;
+            end
+       end
+
+   // Collect received bytes
+   always @(posedge CLK)
+     if (!RESETn)
+       begin
+          rx_full <= 0;
+          rsel <= 0;
           DROPPED <= 0;
+          OVERRUN <= 0;
        end
      else
        begin
-          if (FIFO_RDEN)
-            dvalid <= 1;
-          else if (!tx_busy)
-            dvalid <= 0;
+          if (FIFO_WREN)
+            begin
+               rx_full[rsel] <= 0;
+               rsel <= (rsel == LANES - 1) ? 0 : rsel + 1;
+            end
+          for (int i = 0; i < LANES; i++)
+            if (rx_wr[i])
+              begin
+                 if (!rx_full[i] | (FIFO_WREN & (rsel == i)))
+                   begin
+                      rx_full[i] <= 1;
+                      rx_data[i] <= rx_out[i];
+                   end
+                 else if (rsel == i)
+                   begin
+                      if (~&DROPPED)
+                        DROPPED <= DROPPED + 1;
+                   end
+                 else
+                   begin
+                      // Lane ran ahead, restart order here
+                      rx_full <= 0;
+                      rx_full[i] <= 1;
+                      rx_data[i] <= rx_out[i];
+                      rsel <= i;
+                      if (~&OVERRUN)
+                        OVERRUN <= OVERRUN + 1;
+                   end
+              end
+       end
 
-          if (wren & FIFO_FULL)
-            DROPPED <= DROPPED + 1;
+   for (genvar n = 0; n < LANES; n++)
+     begin : lane
 
-       end
-   
-   // Instantiate receiver
-   rxuartlite #(
-                .TIMER_BITS      (TIMER_BITS),
-                .CLOCKS_PER_BAUD (4) // 12Mbaud @ 48MHz
-                )
-   u_uart_rx (
-              .i_clk     (CLK),
-              .i_uart_rx (RX_PIN),
-              .o_wr      (wren),
-              .o_data    (FIFO_DOUT)
-              );
+        // Instantiate receiver
+        rxuartlite #(
+                     .TIMER_BITS      (TIMER_BITS),
+                     .CLOCKS_PER_BAUD (CLOCKS_PER_BAUD)
+                     )
+        u_uart_rx (
+                   .i_clk             (CLK),
+                   .i_clocks_per_baud (div),
+                   .i_uart_rx         (RX_PIN[n]),
+                   .o_wr              (rx_wr[n]),
+                   .o_data            (rx_out[n])
+                   );
+
+        // Instantiate transmitter
+        txuartlite #(
+                     .TIMING_BITS     (TIMER_BITS),
+                     .CLOCKS_PER_BAUD (CLOCKS_PER_BAUD)
+                     )
+        u_uart_tx (
+                   .i_clk             (CLK),
+                   .i_clocks_per_baud (div),
+                   .i_wr              (tx_valid[n]),
+                   .i_data            (tx_data[n]),
+                   .o_uart_tx         (TX_PIN[n]),
+                   .o_busy            (tx_busy[n])
+                   );
+     end
 
-   // Instantiate transmitter
-   txuartlite #(
-                .TIMING_BITS  (TIMER_BITS),
-                .CLOCKS_PER_BAUD (4) // 12Mbaud @ 48MHz
-                )
-   u_uart_tx (
-              .i_clk     (CLK),
-              .i_wr      (dvalid),
-              .i_data    (FIFO_DIN),
-              .o_uart_tx (TX_PIN),
-              .o_busy    (tx_busy));
-   
 endmodule
@@ -0,0 +1,294 @@
+/**
+ *  Host side driver for the ADIv5 FIFO interface used by jtag_adiv5,
+ *  swd_adiv5 and debug_mux. Commands are written to the command FIFO
+ *  without waiting for each response. Up to depth requests are kept in
+ *  flight which must not exceed the response FIFO depth of the core.
+ *
+ *  Command: DATA[31:0], ADDR[1:0], APnDP, RnW
+ *  Response: DATA[31:0], STAT[2:0]
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+#ifndef ADIV5DRIVER_H
+#define ADIV5DRIVER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <deque>
+#include <verilated.h>
+
+#include "SWJDriver.h"
+
+// Verilated FIFO pins
+template <typename WR_T = vluint64_t, typename RD_T = vluint64_t>
+struct ADIv5Pins {
+  WR_T    *WRDATA;
+  uint8_t *WREN;
+  uint8_t *WRFULL;
+  RD_T    *RDDATA;
+  uint8_t *RDEN;
+  uint8_t *RDEMPTY;
+};
+
+// DP[0xc] write pseudo commands, no response
+#define ADIv5_RESET   0
+#define ADIv5_SWITCH  1
+
+template <class TB, typename WR_T = vluint64_t, typename RD_T = vluint64_t>
+class ADIv5Driver {
+
+ private:
+  TB *tb;
+  ADIv5Pins<WR_T, RD_T> pins;
+  int depth;
+
+  // Outstanding responses in command order
+  std::deque<uint32_t *> pending;
+
+  // Cached DP SELECT and MEM-AP state
+  uint32_t select, csw, tar;
+  bool select_valid, csw_valid, tar_valid;
+
+  void Write (uint8_t addr, bool APnDP, bool RnW, uint32_t data)
+  {
+    // Block if FIFO is full
+    while (*pins.WRFULL)
+      tb->doCycle ();
+
+    // Setup data
+    *pins.WRDATA = ((WR_T)data << 4) | ((addr & 3) << 2) | (APnDP ? 2 : 0) | (RnW ? 1 : 0);
+
+    // Toggle WriteEN
+    *pins.WREN = 1;
+    tb->doCycle ();
+    *pins.WREN = 0;
+  }
+
+  // Retire oldest request
+  void Collect (void)
+  {
+    uint32_t *dst;
+    uint8_t s;
+
+    // Wait for response
+    while (*pins.RDEMPTY)
+      tb->doCycle ();
+
+    // Read
+    *pins.RDEN = 1;
+    tb->doCycle ();
+    *pins.RDEN = 0;
+
+    // Save first error
+    dst = pending.front ();
+    pending.pop_front ();
+    s = *pins.RDDATA & 7;
+    if (s != SWJ_OK) {
+      if (stat == SWJ_OK)
+        stat = s;
+      Invalidate ();
+    }
+    else if (dst)
+      *dst = (uint32_t)((*pins.RDDATA >> 3) & 0xffffffff);
+  }
+
+  // Queue request, dst is filled in when response arrives
+  void Post (uint8_t addr, bool APnDP, bool RnW, uint32_t data, uint32_t *dst)
+  {
+    // Keep response FIFO from overflowing
+    while ((int)pending.size () >= depth)
+      Collect ();
+    Write ((addr >> 2) & 3, APnDP, RnW, data);
+    pending.push_back (dst);
+    posted++;
+  }
+
+  void Select (uint8_t apsel, uint8_t addr)
+  {
+    uint32_t val = (apsel << 24) | (addr & 0xf0);
+
+    // Skip if bank already selected
+    if (select_valid && (select == val)) {
+      skipped++;
+      return;
+    }
+    Post (DP_SELECT, false, false, val, NULL);
+    select = val;
+    select_valid = true;
+  }
+
+  // Track MEM-AP registers written through the AP
+  void Track (uint8_t addr, bool RnW, uint32_t data)
+  {
+    if ((addr == AP_CSW) && !RnW) {
+      csw = data;
+      csw_valid = true;
+    }
+    else if ((addr == AP_TAR) && !RnW) {
+      tar = data;
+      tar_valid = true;
+    }
+    else if ((addr == AP_DRW) && tar_valid && csw_valid && (csw & CSW_INC)) {
+      // Auto-increment only guaranteed within 1KB
+      tar += 1 << (csw & CSW_SIZE_MSK);
+      if ((tar & (TAR_WRAP - 1)) == 0)
+        tar_valid = false;
+    }
+  }
+
+  void SetCSW (uint8_t apsel, uint32_t val)
+  {
+    if (csw_valid && (csw == val))
+      skipped++;
+    else
+      APWrite (apsel, AP_CSW, val);
+  }
+
+  void SetTAR (uint8_t apsel, uint32_t addr)
+  {
+    if (tar_valid && (tar == addr))
+      skipped++;
+    else
+      APWrite (apsel, AP_TAR, addr);
+  }
+
+  // Words until TAR wraps
+  static int Chunk (uint32_t addr, int cnt)
+  {
+    int n = (TAR_WRAP - (addr & (TAR_WRAP - 1))) / 4;
+    return (n < cnt) ? n : cnt;
+  }
+
+ public:
+  uint8_t stat;
+  uint64_t posted, skipped;
+
+  ADIv5Driver (TB *tb, ADIv5Pins<WR_T, RD_T> pins, int depth=4)
+    : tb(tb), pins(pins), depth(depth)
+  {
+    stat = SWJ_OK;
+    posted = skipped = 0;
+    Invalidate ();
+  }
+  ~ADIv5Driver () {}
+
+  // Forget cached DP/AP state
+  void Invalidate (void)
+  {
+    select_valid = false;
+    csw_valid = false;
+    tar_valid = false;
+  }
+
+  // Wait for all outstanding requests, return first error
+  uint8_t Sync (void)
+  {
+    while (!pending.empty ())
+      Collect ();
+    return stat;
+  }
+
+  // Line reset/protocol switch, clears error
+  void Reset (void)
+  {
+    Sync ();
+    Write (DP_RDBUFF >> 2, false, false, ADIv5_RESET);
+    Invalidate ();
+    stat = SWJ_OK;
+  }
+
+  void Switch (void)
+  {
+    Sync ();
+    Write (DP_RDBUFF >> 2, false, false, ADIv5_SWITCH);
+    Invalidate ();
+    stat = SWJ_OK;
+  }
+
+  // Posted access
+  void DPWrite (uint8_t addr, uint32_t data)
+  {
+    if (addr == DP_SELECT) {
+      select = data;
+      select_valid = true;
+    }
+    Post (addr, false, false, data, NULL);
+  }
+
+  void DPRead (uint8_t addr, uint32_t *data)
+  {
+    Post (addr, false, true, 0, data);
+  }
+
+  void APWrite (uint8_t apsel, uint8_t addr, uint32_t data)
+  {
+    Select (apsel, addr);
+    Post (addr, true, false, data, NULL);
+    Track (addr, false, data);
+  }
+
+  void APRead (uint8_t apsel, uint8_t addr, uint32_t *data)
+  {
+    Select (apsel, addr);
+    Post (addr, true, true, 0, data);
+    Track (addr, true, 0);
+  }
+
+  // Stream words through DRW with TAR auto-increment. TAR is only
+  // rewritten when crossing a 1KB boundary.
+  uint8_t MemWriteBlock (uint8_t apsel, uint32_t addr, const uint32_t *data, int cnt)
+  {
+    int i, n;
+
+    SetCSW (apsel, CSW_DEFAULT | CSW_INC | CSW_SIZE32);
+    while (cnt > 0) {
+      n = Chunk (addr, cnt);
+      SetTAR (apsel, addr);
+      for (i = 0; i < n; i++)
+        APWrite (apsel, AP_DRW, data[i]);
+      addr += n * 4;
+      data += n;
+      cnt -= n;
+    }
+    return Sync ();
+  }
+
+  // Reads stay in flight, each response lands in data[]
+  uint8_t MemReadBlock (uint8_t apsel, uint32_t addr, uint32_t *data, int cnt)
+  {
+    int i, n;
+
+    SetCSW (apsel, CSW_DEFAULT | CSW_INC | CSW_SIZE32);
+    while (cnt > 0) {
+      n = Chunk (addr, cnt);
+      SetTAR (apsel, addr);
+      for (i = 0; i < n; i++)
+        APRead (apsel, AP_DRW, &data[i]);
+      addr += n * 4;
+      data += n;
+      cnt -= n;
+    }
+    return Sync ();
+  }
+
+  // Blocking reads
+  uint32_t DPRead (uint8_t addr)
+  {
+    uint32_t val = 0;
+    DPRead (addr, &val);
+    Sync ();
+    return val;
+  }
+
+  uint32_t APRead (uint8_t apsel, uint8_t addr)
+  {
+    uint32_t val = 0;
+    APRead (apsel, addr, &val);
+    Sync ();
+    return val;
+  }
+};
+
+#endif /* ADIV5DRIVER_H */
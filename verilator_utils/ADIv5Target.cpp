@@ -0,0 +1,609 @@
+/**
+ *  Behavioral ADIv5 target - JTAG-DP/SW-DP with a single MEM-AP backed
+ *  by sparse memory. The model is clocked from the TCK/SWCLK pin seen by
+ *  the bench:
+ *
+ *  JTAG: TMS/TDI sampled on rising TCK, TDO updated on falling TCK
+ *  SWD:  SWDIO sampled and driven on rising SWCLK
+ *
+ *  Starts in JTAG mode and follows the ARM JTAG-to-SWD/SWD-to-JTAG
+ *  select sequences. Only AP[0] is implemented, other APs read as zero.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ADIv5Target.h"
+
+// JTAG-DP instructions
+#define IR_ABORT   0x8
+#define IR_DPACC   0xA
+#define IR_APACC   0xB
+#define IR_IDCODE  0xE
+
+// IR length of bypass TAPs in chain
+#define BYPASS_IRLEN   5
+
+// JTAG-DP ACK encoding
+#define JTAG_ACK_OK    2
+#define JTAG_ACK_WAIT  1
+
+// SWD ACK encoding
+#define SWD_ACK_OK     1
+#define SWD_ACK_WAIT   2
+#define SWD_ACK_FAULT  4
+
+// Select sequences (LSB first) after >= 50 ones
+#define SEQ_JTAG2SWD   0xE79E
+#define SEQ_SWD2JTAG   0xE73C
+#define RESET_ONES     50
+
+// CTRL/STAT fields
+#define CS_STICKYERR   (1 << 5)
+#define CS_WDATAERR    (1 << 7)
+#define CS_PWRUP_MSK   0x50000000
+
+// Core debug registers
+#define DHCSR          0xE000EDF0
+#define DCRSR          0xE000EDF4
+#define DCRDR          0xE000EDF8
+#define DHCSR_KEY      0xA05F0000
+#define S_REGRDY       (1 << 16)
+#define S_HALT         (1 << 17)
+
+// TAP states
+enum {
+  TLR, IDLE, SEL_DR, CAP_DR, SH_DR, EX1_DR, PA_DR, EX2_DR, UPD_DR,
+  SEL_IR, CAP_IR, SH_IR, EX1_IR, PA_IR, EX2_IR, UPD_IR
+};
+
+// Next TAP state [state][tms]
+static const uint8_t tap_next[16][2] = {
+  { IDLE, TLR },      { IDLE, SEL_DR },   { CAP_DR, SEL_IR }, { SH_DR, EX1_DR },
+  { SH_DR, EX1_DR },  { PA_DR, UPD_DR },  { PA_DR, EX2_DR },  { SH_DR, UPD_DR },
+  { IDLE, SEL_DR },   { CAP_IR, TLR },    { SH_IR, EX1_IR },  { SH_IR, EX1_IR },
+  { PA_IR, UPD_IR },  { PA_IR, EX2_IR },  { SH_IR, UPD_IR },  { IDLE, SEL_DR }
+};
+
+// SWD line states
+enum {
+  SWD_RESET, SWD_IDLE, SWD_REQ, SWD_TRN, SWD_ACK, SWD_RDATA, SWD_TRNW, SWD_WDATA, SWD_TRNEND
+};
+
+static int parity (uint64_t val)
+{
+  return __builtin_parityll (val);
+}
+
+// Low n bits set
+static uint64_t ones_mask (int n)
+{
+  return (n >= 64) ? ~0ULL : (1ULL << n) - 1;
+}
+
+// Captured IR of bypass TAPs, 01 per TAP
+static uint64_t bypass_capture (int taps)
+{
+  uint64_t val = 0;
+  int i;
+
+  for (i = 0; i < taps; i++)
+    val |= 1ULL << (i * BYPASS_IRLEN);
+  return val;
+}
+
+ADIv5Target::ADIv5Target (int wait_pct, int fault_pct, uint32_t seed)
+  : wait_pct(wait_pct), fault_pct(fault_pct)
+{
+  rng = seed ? seed : 1;
+  transfers = waits = faults = chain_errs = 0;
+  chain_pre = chain_post = 0;
+  tck_last = 0;
+  Reset ();
+}
+
+void ADIv5Target::Reset (void)
+{
+  // Line state
+  swd = false;
+  tdo = 0;
+  swdio = 1;
+  ones = 0;
+  seq = 0;
+  since = 0;
+
+  // TAP
+  state = TLR;
+  ir = IR_IDCODE;
+  ir_sr = 0;
+  dr_sr = 0;
+  jresult = 0;
+  skip = false;
+  pre_sr = post_sr = 0;
+
+  // SWD
+  swd_state = SWD_RESET;
+  bit = 0;
+  req = ack = 0;
+  sr = 0;
+  locked = true;
+
+  // DP/AP
+  ctrl_stat = 0;
+  select = 0;
+  rdbuff = 0;
+  csw = 0;
+  tar = 0;
+  sticky = false;
+  wdataerr = false;
+
+  // Debug
+  dhcsr = 0;
+  dcrdr = 0;
+  memset (regs, 0, sizeof (regs));
+}
+
+bool ADIv5Target::Roll (int pct)
+{
+  if (pct <= 0)
+    return false;
+
+  // xorshift32
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return (rng % 100) < (uint32_t)pct;
+}
+
+uint32_t ADIv5Target::Read32 (uint32_t addr)
+{
+  std::unordered_map<uint32_t, uint32_t>::iterator it;
+
+  switch (addr & ~3) {
+    case DHCSR:
+      return (dhcsr & 0xf) | S_REGRDY | ((dhcsr & 2) ? S_HALT : 0);
+    case DCRDR:
+      return dcrdr;
+  }
+  it = mem.find (addr >> 2);
+  return (it == mem.end ()) ? 0 : it->second;
+}
+
+void ADIv5Target::Write32 (uint32_t addr, uint32_t data)
+{
+  switch (addr & ~3) {
+    case DHCSR:
+      // Ignore writes without key
+      if ((data & 0xffff0000) == DHCSR_KEY)
+        dhcsr = data & 0xf;
+      return;
+    case DCRSR:
+      // REGWnR selects direction
+      if (data & (1 << 16))
+        regs[data & 0x1f] = dcrdr;
+      else
+        dcrdr = regs[data & 0x1f];
+      return;
+    case DCRDR:
+      dcrdr = data;
+      return;
+  }
+  mem[addr >> 2] = data;
+}
+
+uint32_t ADIv5Target::APRead (uint8_t addr)
+{
+  uint32_t size = csw & 7, val;
+
+  // Single MEM-AP
+  if (select >> 24)
+    return 0;
+
+  switch (addr) {
+    case AP_CSW:
+      return csw | (1 << 6);
+    case AP_TAR:
+      return tar;
+    case AP_DRW:
+      val = Read32 (tar);
+      // Auto-increment wraps within 1KB
+      if (((csw >> 4) & 3) == 1)
+        tar = (tar & ~(TAR_WRAP - 1)) | ((tar + (1 << size)) & (TAR_WRAP - 1));
+      return val;
+    case 0x10:
+    case 0x14:
+    case 0x18:
+    case 0x1c:
+      return Read32 ((tar & ~0xf) | (addr & 0xc));
+    case AP_BASE:
+      return TARGET_AP_BASE;
+    case AP_IDR:
+      return TARGET_AP_IDR;
+  }
+  return 0;
+}
+
+void ADIv5Target::APWrite (uint8_t addr, uint32_t data)
+{
+  uint32_t size = csw & 7, mask;
+
+  if (select >> 24)
+    return;
+
+  switch (addr) {
+    case AP_CSW:
+      csw = data & 0xffffff3f;
+      break;
+    case AP_TAR:
+      tar = data;
+      break;
+    case AP_DRW:
+      // Merge active byte lanes
+      if (size == CSW_SIZE8)
+        mask = 0xff << (8 * (tar & 3));
+      else if (size == CSW_SIZE16)
+        mask = 0xffff << (8 * (tar & 2));
+      else
+        mask = 0xffffffff;
+      if (mask == 0xffffffff)
+        Write32 (tar, data);
+      else
+        Write32 (tar, (Read32 (tar) & ~mask) | (data & mask));
+      if (((csw >> 4) & 3) == 1)
+        tar = (tar & ~(TAR_WRAP - 1)) | ((tar + (1 << size)) & (TAR_WRAP - 1));
+      break;
+    case 0x10:
+    case 0x14:
+    case 0x18:
+    case 0x1c:
+      Write32 ((tar & ~0xf) | (addr & 0xc), data);
+      break;
+  }
+}
+
+void ADIv5Target::Abort (uint32_t data)
+{
+  // DAPABORT has nothing to cancel, transfers complete immediately
+  if (data & (1 << 2))
+    sticky = false;
+  if (data & (1 << 3))
+    wdataerr = false;
+}
+
+int ADIv5Target::Access (bool APnDP, uint8_t addr, bool RnW, uint32_t *data)
+{
+  transfers++;
+
+  // AP access
+  if (APnDP) {
+    if (sticky)
+      return SWJ_FAULT;
+    addr |= select & 0xf0;
+    if (RnW) {
+      // Posted, value returned by next AP read or RDBUFF
+      *data = rdbuff;
+      rdbuff = APRead (addr);
+    }
+    else
+      APWrite (addr, *data);
+    return SWJ_OK;
+  }
+
+  // DP access
+  switch (addr) {
+    case DP_IDCODE:
+      if (RnW) {
+        *data = swd ? TARGET_SWD_IDCODE : TARGET_JTAG_IDCODE;
+        locked = false;
+      }
+      else
+        Abort (*data);
+      break;
+    case DP_CTRL_STAT:
+      if (RnW)
+        *data = ctrl_stat | ((ctrl_stat & CS_PWRUP_MSK) << 1) |
+          (sticky ? CS_STICKYERR : 0) | (wdataerr ? CS_WDATAERR : 0);
+      else {
+        ctrl_stat = *data & CS_PWRUP_MSK;
+        // JTAG clears sticky flags by writing one
+        if (!swd && (*data & CS_STICKYERR))
+          sticky = false;
+      }
+      break;
+    case DP_SELECT:
+      if (RnW)
+        *data = 0;
+      else
+        select = *data;
+      break;
+    case DP_RDBUFF:
+      if (RnW)
+        *data = rdbuff;
+      break;
+  }
+  return SWJ_OK;
+}
+
+void ADIv5Target::Sequence (uint8_t b)
+{
+  // Track select sequence following line reset
+  seq = (seq >> 1) | (b << 15);
+  if (since <= 16)
+    since++;
+  ones = b ? ones + 1 : 0;
+  if (ones >= RESET_ONES)
+    since = 0;
+  if (since != 16)
+    return;
+
+  if (!swd && (seq == SEQ_JTAG2SWD)) {
+    swd = true;
+    swd_state = SWD_IDLE;
+    locked = true;
+  }
+  else if (swd && (seq == SEQ_SWD2JTAG)) {
+    swd = false;
+    state = TLR;
+    ir = IR_IDCODE;
+  }
+}
+
+void ADIv5Target::Capture (void)
+{
+  switch (ir) {
+    case IR_IDCODE:
+      dr_sr = TARGET_JTAG_IDCODE;
+      break;
+    case IR_DPACC:
+    case IR_APACC:
+      // WAIT cancels this scan's request
+      skip = (ir == IR_APACC) && Roll (wait_pct);
+      if (skip)
+        waits++;
+      dr_sr = ((uint64_t)jresult << 3) | (skip ? JTAG_ACK_WAIT : JTAG_ACK_OK);
+      break;
+    default:
+      dr_sr = 0;
+  }
+}
+
+void ADIv5Target::Update (void)
+{
+  uint32_t data = (dr_sr >> 3) & 0xffffffff;
+  uint8_t addr = ((dr_sr >> 1) & 3) << 2;
+  bool RnW = dr_sr & 1;
+
+  switch (ir) {
+    case IR_DPACC:
+    case IR_APACC:
+      if (skip)
+        break;
+      // JTAG reports faults through STICKYERR
+      if ((ir == IR_APACC) && !sticky && Roll (fault_pct)) {
+        sticky = true;
+        faults++;
+        break;
+      }
+      if (Access (ir == IR_APACC, addr, RnW, &data) != SWJ_OK)
+        break;
+      // AP read data available from the next scan
+      if (RnW)
+        jresult = (ir == IR_APACC) ? rdbuff : data;
+      break;
+    case IR_ABORT:
+      if (addr == 0)
+        Abort (data);
+      break;
+  }
+}
+
+void ADIv5Target::JTAGClock (uint8_t tms, uint8_t tdi)
+{
+  int len, npre, npost;
+  uint8_t b;
+
+  // Shift bypass TAPs, DP sees the last post bit
+  if ((state == SH_IR) || (state == SH_DR)) {
+    npre = (state == SH_IR) ? chain_pre * BYPASS_IRLEN : chain_pre;
+    npost = (state == SH_IR) ? chain_post * BYPASS_IRLEN : chain_post;
+    b = (state == SH_IR) ? ir_sr & 1 : dr_sr & 1;
+    if (npre)
+      pre_sr = (pre_sr >> 1) | ((uint64_t)b << (npre - 1));
+    if (npost) {
+      b = post_sr & 1;
+      post_sr = (post_sr >> 1) | ((uint64_t)tdi << (npost - 1));
+      tdi = b;
+    }
+  }
+
+  // Shift data
+  if (state == SH_IR)
+    ir_sr = (ir_sr >> 1) | (tdi << 3);
+  else if (state == SH_DR) {
+    len = ((ir == IR_DPACC) || (ir == IR_APACC) || (ir == IR_ABORT)) ? 35 :
+      (ir == IR_IDCODE) ? 32 : 1;
+    dr_sr = (dr_sr >> 1) | ((uint64_t)tdi << (len - 1));
+  }
+
+  // Advance TAP
+  state = tap_next[state][tms];
+  switch (state) {
+    case TLR:
+      ir = IR_IDCODE;
+      break;
+    case CAP_IR:
+      ir_sr = 1;
+      pre_sr = bypass_capture (chain_pre);
+      post_sr = bypass_capture (chain_post);
+      break;
+    case UPD_IR:
+      ir = ir_sr & 0xf;
+      // Other TAPs must be left in BYPASS
+      if ((pre_sr != ones_mask (chain_pre * BYPASS_IRLEN)) ||
+          (post_sr != ones_mask (chain_post * BYPASS_IRLEN)))
+        chain_errs++;
+      break;
+    case CAP_DR:
+      Capture ();
+      pre_sr = post_sr = 0;
+      break;
+    case UPD_DR:
+      Update ();
+      break;
+  }
+}
+
+void ADIv5Target::SWDRequest (void)
+{
+  bool APnDP = (req >> 1) & 1;
+  bool RnW = (req >> 2) & 1;
+  uint8_t addr = ((req >> 3) & 3) << 2;
+  uint32_t data;
+
+  // Start, stop, park and parity must be valid
+  if (((req & 0xc1) != 0x81) || (parity ((req >> 1) & 0xf) != ((req >> 5) & 1))) {
+    swd_state = SWD_IDLE;
+    return;
+  }
+
+  // Only IDCODE read accepted after line reset
+  if (locked && (APnDP || !RnW || (addr != DP_IDCODE))) {
+    swd_state = SWD_IDLE;
+    return;
+  }
+
+  // Determine response
+  if (APnDP && sticky)
+    ack = SWD_ACK_FAULT;
+  else if (APnDP && Roll (wait_pct)) {
+    ack = SWD_ACK_WAIT;
+    waits++;
+  }
+  else if (APnDP && Roll (fault_pct)) {
+    ack = SWD_ACK_FAULT;
+    sticky = true;
+    faults++;
+  }
+  else
+    ack = SWD_ACK_OK;
+
+  // Reads complete before data phase
+  if ((ack == SWD_ACK_OK) && RnW) {
+    Access (APnDP, addr, true, &data);
+    sr = data | ((uint64_t)parity (data) << 32);
+  }
+  swd_state = SWD_TRN;
+}
+
+void ADIv5Target::SWDClock (uint8_t b, bool host)
+{
+  uint32_t data;
+
+  // Line reset
+  if (host && (ones >= RESET_ONES)) {
+    swd_state = SWD_RESET;
+    locked = true;
+    return;
+  }
+
+  switch (swd_state) {
+    case SWD_RESET:
+      if (host && !b)
+        swd_state = SWD_IDLE;
+      break;
+
+    case SWD_IDLE:
+      if (host && b) {
+        req = 1;
+        bit = 1;
+        swd_state = SWD_REQ;
+      }
+      break;
+
+    case SWD_REQ:
+      req |= b << bit;
+      if (++bit == 8)
+        SWDRequest ();
+      break;
+
+    case SWD_TRN:
+      bit = 0;
+      swd_state = SWD_ACK;
+      break;
+
+    case SWD_ACK:
+      swdio = (ack >> bit) & 1;
+      if (++bit < 3)
+        break;
+      bit = 0;
+      if (ack != SWD_ACK_OK)
+        swd_state = SWD_TRNEND;
+      else
+        swd_state = ((req >> 2) & 1) ? SWD_RDATA : SWD_TRNW;
+      break;
+
+    case SWD_RDATA:
+      swdio = (sr >> bit) & 1;
+      if (++bit == 33)
+        swd_state = SWD_TRNEND;
+      break;
+
+    case SWD_TRNW:
+      bit = 0;
+      sr = 0;
+      swd_state = SWD_WDATA;
+      break;
+
+    case SWD_WDATA:
+      sr |= (uint64_t)b << bit;
+      if (++bit < 33)
+        break;
+      data = sr & 0xffffffff;
+      if (parity (data) != (int)((sr >> 32) & 1))
+        wdataerr = true;
+      else
+        Access ((req >> 1) & 1, ((req >> 3) & 3) << 2, false, &data);
+      swd_state = SWD_IDLE;
+      break;
+
+    case SWD_TRNEND:
+      swdio = 1;
+      swd_state = SWD_IDLE;
+      break;
+  }
+}
+
+void ADIv5Target::doJTAGClient (uint64_t, uint8_t tck, uint8_t *tdo, uint8_t tdi, uint8_t *tms, uint8_t tmsoe)
+{
+  uint8_t b = tmsoe ? *tms : swdio;
+
+  // Rising edge
+  if (tck && !tck_last) {
+    if (tmsoe)
+      Sequence (b);
+    if (swd)
+      SWDClock (b, tmsoe);
+    else
+      JTAGClock (b, tdi);
+  }
+
+  // Falling edge - update TDO
+  else if (!tck && tck_last && !swd) {
+    if (((state == SH_DR) || (state == SH_IR)) && chain_pre)
+      this->tdo = pre_sr & 1;
+    else if (state == SH_DR)
+      this->tdo = dr_sr & 1;
+    else if (state == SH_IR)
+      this->tdo = ir_sr & 1;
+  }
+  tck_last = tck;
+
+  // Drive outputs
+  *tdo = this->tdo;
+  if (!tmsoe)
+    *tms = swdio;
+}
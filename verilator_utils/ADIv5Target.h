@@ -0,0 +1,102 @@
+/**
+ *  Behavioral ADIv5 target - JTAG-DP/SW-DP with a single MEM-AP backed
+ *  by sparse memory. Connects to the bench pins in place of JTAGClient
+ *  so debug PHY benches can run without a second simulator. WAIT and
+ *  FAULT responses can be injected on AP accesses. Bypass-only TAPs can
+ *  be placed before and after the JTAG-DP to model a multi-TAP chain.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+#ifndef ADIV5TARGET_H
+#define ADIV5TARGET_H
+
+#include <stdint.h>
+#include <unordered_map>
+
+#include "SWJDriver.h"
+
+// Identification registers
+#define TARGET_JTAG_IDCODE  0x4BA00477
+#define TARGET_SWD_IDCODE   0x2BA01477
+#define TARGET_AP_IDR       0x24770011
+#define TARGET_AP_BASE      0xE00FF003
+
+class ADIv5Target {
+
+ private:
+  // Pin state
+  uint8_t tck_last, tdo, swdio;
+  bool swd;
+
+  // Line reset/switch sequence detect
+  uint32_t ones;
+  uint16_t seq;
+  int since;
+
+  // JTAG TAP
+  int state;
+  uint8_t ir, ir_sr;
+  uint64_t dr_sr;
+  uint32_t jresult;
+  bool skip;
+
+  // Bypass TAP shift registers
+  uint64_t pre_sr, post_sr;
+
+  // SWD line state
+  int swd_state, bit;
+  uint8_t req, ack;
+  uint64_t sr;
+  bool locked;
+
+  // DP/MEM-AP registers
+  uint32_t ctrl_stat, select, rdbuff, csw, tar;
+  bool sticky, wdataerr;
+
+  // Core debug registers
+  uint32_t dhcsr, dcrdr, regs[32];
+
+  // Sparse word memory
+  std::unordered_map<uint32_t, uint32_t> mem;
+  uint32_t rng;
+
+  bool Roll (int pct);
+  void Sequence (uint8_t b);
+  void JTAGClock (uint8_t tms, uint8_t tdi);
+  void Capture (void);
+  void Update (void);
+  void SWDClock (uint8_t b, bool host);
+  void SWDRequest (void);
+  int Access (bool APnDP, uint8_t addr, bool RnW, uint32_t *data);
+  uint32_t APRead (uint8_t addr);
+  void APWrite (uint8_t addr, uint32_t data);
+  void Abort (uint32_t data);
+
+ public:
+  // Injection rate in percent of AP accesses
+  int wait_pct, fault_pct;
+
+  // Bypass TAPs between DP and TDO (pre) and TDI and DP (post), max 12
+  int chain_pre, chain_post;
+
+  // Statistics
+  uint64_t transfers, waits, faults, chain_errs;
+
+  ADIv5Target (int wait_pct=0, int fault_pct=0, uint32_t seed=1);
+  ~ADIv5Target () {}
+
+  // Power on reset, memory is kept
+  void Reset (void);
+  bool isSWD (void) { return swd; }
+
+  // Backdoor memory access
+  uint32_t Read32 (uint32_t addr);
+  void Write32 (uint32_t addr, uint32_t data);
+
+  // Same interface as JTAGClient
+  void doJTAGClient (uint64_t t, uint8_t tck, uint8_t *tdo, uint8_t tdi, uint8_t *tms, uint8_t tmsoe);
+};
+
+#endif /* ADIV5TARGET_H */
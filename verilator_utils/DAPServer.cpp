@@ -0,0 +1,367 @@
+/**
+ *  DAP transfer server. Accepts batched DP/AP transfer requests in
+ *  CMSIS-DAP command format and executes them as JTAG or SWD pin
+ *  sequences on the target. Each packet is framed with a 16-bit
+ *  little endian length so a single packet can carry thousands of
+ *  transfers using DAP_ExecuteCommands/DAP_TransferBlock.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "DAPServer.h"
+
+// CMSIS-DAP commands
+#define ID_DAP_INFO               0x00
+#define ID_DAP_HOST_STATUS        0x01
+#define ID_DAP_CONNECT            0x02
+#define ID_DAP_DISCONNECT         0x03
+#define ID_DAP_TRANSFER_CONFIGURE 0x04
+#define ID_DAP_TRANSFER           0x05
+#define ID_DAP_TRANSFER_BLOCK     0x06
+#define ID_DAP_WRITE_ABORT        0x08
+#define ID_DAP_RESET_TARGET       0x0A
+#define ID_DAP_SWJ_CLOCK          0x11
+#define ID_DAP_EXECUTE_COMMANDS   0x7F
+#define ID_DAP_INVALID            0xFF
+
+#define DAP_OK                    0x00
+#define DAP_ERROR                 0xFF
+
+// Connect port
+#define DAP_PORT_DEFAULT          0
+#define DAP_PORT_SWD              1
+#define DAP_PORT_JTAG             2
+
+// Transfer request bits
+#define DAP_TRANSFER_APnDP        (1 << 0)
+#define DAP_TRANSFER_RnW          (1 << 1)
+#define DAP_TRANSFER_A32          (3 << 2)
+#define DAP_TRANSFER_MATCH_VALUE  (1 << 4)
+#define DAP_TRANSFER_MATCH_MASK   (1 << 5)
+
+// Transfer response bits
+#define DAP_TRANSFER_OK           (1 << 0)
+#define DAP_TRANSFER_WAIT         (1 << 1)
+#define DAP_TRANSFER_FAULT        (1 << 2)
+#define DAP_TRANSFER_NOACK        (7 << 0)
+#define DAP_TRANSFER_MISMATCH     (1 << 4)
+
+static uint32_t get32 (const uint8_t *buf)
+{
+  return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static void put32 (std::vector<uint8_t> &resp, uint32_t val)
+{
+  resp.push_back (val & 0xff);
+  resp.push_back ((val >> 8) & 0xff);
+  resp.push_back ((val >> 16) & 0xff);
+  resp.push_back ((val >> 24) & 0xff);
+}
+
+DAPServer::DAPServer (uint32_t period, bool debug)
+  : JTAGServer ("DAPServer", period, debug), swj (tx, rx, running)
+{
+  // Transfers hold DAP state, single client only
+  max_clients = 1;
+  select = 0;
+  match_mask = 0;
+  match_retry = 0;
+  idle = 0;
+}
+
+void DAPServer::Recv (int sockfd, char *buf, int len)
+{
+  std::vector<uint8_t> resp;
+  uint32_t n;
+
+  pkt.insert (pkt.end (), buf, buf + len);
+
+  // Process each complete packet
+  while (pkt.size () >= 2) {
+    n = pkt[0] | (pkt[1] << 8);
+    if (pkt.size () < n + 2)
+      break;
+
+    // Execute command and leave room for length
+    resp.assign (2, 0);
+    if (n && (Execute (&pkt[2], n, resp) < 0)) {
+
+      // Drop partial response, report the failed command
+      resp.resize (2);
+      resp.push_back (pkt[2]);
+      resp.push_back (DAP_ERROR);
+    }
+    resp[0] = (resp.size () - 2) & 0xff;
+    resp[1] = ((resp.size () - 2) >> 8) & 0xff;
+    Send (sockfd, (char *)&resp[0], resp.size ());
+    pkt.erase (pkt.begin (), pkt.begin () + n + 2);
+  }
+}
+
+int DAPServer::Access (uint8_t req, uint32_t *data)
+{
+  uint8_t addr = req & DAP_TRANSFER_A32;
+  int rv;
+
+  // Host owns SELECT, driver skips redundant writes
+  if (req & DAP_TRANSFER_APnDP) {
+    addr |= select & 0xf0;
+    rv = (req & DAP_TRANSFER_RnW) ? swj.APRead (addr, data) : swj.APWrite (addr, *data);
+  }
+  else {
+    if ((addr == DP_SELECT) && !(req & DAP_TRANSFER_RnW)) {
+      select = *data;
+      swj.apsel = select >> 24;
+    }
+    rv = (req & DAP_TRANSFER_RnW) ? swj.DPRead (addr, data) : swj.DPWrite (addr, *data);
+  }
+  if (idle)
+    swj.Idle (idle);
+
+  // Convert to CMSIS-DAP encoding
+  switch (rv) {
+    case SWJ_OK:    return DAP_TRANSFER_OK;
+    case SWJ_WAIT:  return DAP_TRANSFER_WAIT;
+    case SWJ_FAULT: return DAP_TRANSFER_FAULT;
+    default:        return DAP_TRANSFER_NOACK;
+  }
+}
+
+int DAPServer::Info (const uint8_t *req, int len, std::vector<uint8_t> &resp)
+{
+  const char *str = NULL;
+
+  if (len < 2)
+    return -1;
+  resp.push_back (ID_DAP_INFO);
+  switch (req[1]) {
+    case 0x01:
+      str = "Tiny Labs";
+      break;
+    case 0x02:
+      str = "Verilator DAP";
+      break;
+    case 0xF0:
+      // SWD + JTAG
+      resp.push_back (1);
+      resp.push_back (0x03);
+      return 2;
+    case 0xFE:
+      resp.push_back (2);
+      resp.push_back (DAP_PACKET_SIZE & 0xff);
+      resp.push_back (DAP_PACKET_SIZE >> 8);
+      return 2;
+    case 0xFF:
+      resp.push_back (1);
+      resp.push_back (1);
+      return 2;
+  }
+
+  // Strings include NULL
+  if (str) {
+    resp.push_back (strlen (str) + 1);
+    resp.insert (resp.end (), str, str + strlen (str) + 1);
+  }
+  else
+    resp.push_back (0);
+  return 2;
+}
+
+int DAPServer::Transfer (const uint8_t *req, int len, std::vector<uint8_t> &resp)
+{
+  int i, cnt, done = 0, off = 3, j;
+  uint8_t request, ack = DAP_TRANSFER_OK;
+  uint32_t data, match;
+  size_t hdr = resp.size ();
+
+  if (len < 3)
+    return -1;
+  cnt = req[2];
+  resp.push_back (ID_DAP_TRANSFER);
+  resp.push_back (0);
+  resp.push_back (0);
+
+  for (i = 0; i < cnt; i++) {
+
+    // Parse request
+    if (off >= len)
+      return -1;
+    request = req[off++];
+    if (!(request & DAP_TRANSFER_RnW) || (request & DAP_TRANSFER_MATCH_VALUE)) {
+      if (off + 4 > len)
+        return -1;
+      data = get32 (&req[off]);
+      off += 4;
+    }
+
+    // Remaining requests are skipped after an error
+    if (ack != DAP_TRANSFER_OK)
+      continue;
+
+    // Update match mask
+    if (request & DAP_TRANSFER_MATCH_MASK)
+      match_mask = data;
+
+    // Read until value matches
+    else if (request & DAP_TRANSFER_MATCH_VALUE) {
+      match = data;
+      for (j = 0; j <= match_retry; j++) {
+        if ((ack = Access (request, &data)) != DAP_TRANSFER_OK)
+          break;
+        if ((data & match_mask) == match)
+          break;
+      }
+      if ((ack == DAP_TRANSFER_OK) && (j > match_retry))
+        ack |= DAP_TRANSFER_MISMATCH;
+    }
+
+    // Plain read/write
+    else {
+      ack = Access (request, &data);
+      if ((ack == DAP_TRANSFER_OK) && (request & DAP_TRANSFER_RnW))
+        put32 (resp, data);
+    }
+
+    if (ack == DAP_TRANSFER_OK)
+      done++;
+  }
+
+  resp[hdr + 1] = done;
+  resp[hdr + 2] = ack;
+  return off;
+}
+
+int DAPServer::TransferBlock (const uint8_t *req, int len, std::vector<uint8_t> &resp)
+{
+  std::vector<uint32_t> data;
+  uint8_t request, ack = DAP_TRANSFER_OK, addr;
+  int i, cnt, rv;
+
+  if (len < 5)
+    return -1;
+  cnt = req[2] | (req[3] << 8);
+  request = req[4];
+  data.resize (cnt);
+  if (!(request & DAP_TRANSFER_RnW)) {
+    if (len < 5 + (cnt * 4))
+      return -1;
+    for (i = 0; i < cnt; i++)
+      data[i] = get32 (&req[5 + (i * 4)]);
+  }
+
+  // AP accesses are pipelined by the driver
+  if ((request & DAP_TRANSFER_APnDP) && cnt) {
+    addr = (select & 0xf0) | (request & DAP_TRANSFER_A32);
+    rv = (request & DAP_TRANSFER_RnW) ? swj.APReadBlock (addr, &data[0], cnt) :
+      swj.APWriteBlock (addr, &data[0], cnt);
+    ack = (rv == SWJ_OK) ? DAP_TRANSFER_OK : (rv == SWJ_WAIT) ? DAP_TRANSFER_WAIT :
+      (rv == SWJ_FAULT) ? DAP_TRANSFER_FAULT : DAP_TRANSFER_NOACK;
+    if (ack != DAP_TRANSFER_OK)
+      cnt = 0;
+  }
+  else {
+    for (i = 0; i < cnt; i++)
+      if ((ack = Access (request, &data[i])) != DAP_TRANSFER_OK)
+        break;
+    cnt = i;
+  }
+
+  resp.push_back (ID_DAP_TRANSFER_BLOCK);
+  resp.push_back (cnt & 0xff);
+  resp.push_back (cnt >> 8);
+  resp.push_back (ack);
+  for (i = 0; (request & DAP_TRANSFER_RnW) && (i < cnt); i++)
+    put32 (resp, data[i]);
+  return (request & DAP_TRANSFER_RnW) ? 5 : 5 + (data.size () * 4);
+}
+
+int DAPServer::Execute (const uint8_t *req, int len, std::vector<uint8_t> &resp)
+{
+  int i, cnt, n, off;
+
+  switch (req[0]) {
+    case ID_DAP_INFO:
+      return Info (req, len, resp);
+
+    case ID_DAP_HOST_STATUS:
+      resp.push_back (req[0]);
+      resp.push_back (DAP_OK);
+      return 3;
+
+    case ID_DAP_CONNECT:
+      if (len < 2)
+        return -1;
+      resp.push_back (req[0]);
+      select = 0;
+      swj.apsel = 0;
+      if (swj.Connect (req[1] != DAP_PORT_SWD) != SWJ_OK)
+        resp.push_back (0);
+      else
+        resp.push_back ((req[1] == DAP_PORT_SWD) ? DAP_PORT_SWD : DAP_PORT_JTAG);
+      return 2;
+
+    case ID_DAP_DISCONNECT:
+      resp.push_back (req[0]);
+      resp.push_back (DAP_OK);
+      return 1;
+
+    case ID_DAP_TRANSFER_CONFIGURE:
+      if (len < 6)
+        return -1;
+      idle = req[1];
+      swj.SetRetries (req[2] | (req[3] << 8));
+      match_retry = req[4] | (req[5] << 8);
+      resp.push_back (req[0]);
+      resp.push_back (DAP_OK);
+      return 6;
+
+    case ID_DAP_TRANSFER:
+      return Transfer (req, len, resp);
+
+    case ID_DAP_TRANSFER_BLOCK:
+      return TransferBlock (req, len, resp);
+
+    case ID_DAP_WRITE_ABORT:
+      if (len < 6)
+        return -1;
+      resp.push_back (req[0]);
+      resp.push_back ((swj.DPWrite (DP_ABORT, get32 (&req[2])) == SWJ_OK) ? DAP_OK : DAP_ERROR);
+      return 6;
+
+    case ID_DAP_RESET_TARGET:
+      swj.Reset (true);
+      swj.Idle (100);
+      swj.Reset (false);
+      resp.push_back (req[0]);
+      resp.push_back (DAP_OK);
+      resp.push_back (1);
+      return 1;
+
+    case ID_DAP_SWJ_CLOCK:
+      // Pins are toggled at the server period
+      resp.push_back (req[0]);
+      resp.push_back (DAP_OK);
+      return 5;
+
+    case ID_DAP_EXECUTE_COMMANDS:
+      if (len < 2)
+        return -1;
+      cnt = req[1];
+      resp.push_back (req[0]);
+      resp.push_back (cnt);
+      for (i = 0, off = 2; (i < cnt) && (off < len); i++, off += n)
+        if ((n = Execute (&req[off], len - off, resp)) < 0)
+          return -1;
+      return off;
+  }
+
+  // Unknown command
+  resp.push_back (ID_DAP_INVALID);
+  return -1;
+}
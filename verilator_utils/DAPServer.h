@@ -0,0 +1,47 @@
+/**
+ *  DAP transfer server. Accepts batched DP/AP transfer requests in
+ *  CMSIS-DAP command format and executes them as JTAG or SWD pin
+ *  sequences on the target. Each packet is framed with a 16-bit
+ *  little endian length so a single packet can carry thousands of
+ *  transfers using DAP_ExecuteCommands/DAP_TransferBlock.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+#ifndef DAPSERVER_H
+#define DAPSERVER_H
+
+#include <vector>
+#include "JTAGServer.h"
+#include "SWJDriver.h"
+
+// Maximum packet size excluding length header
+#define DAP_PACKET_SIZE  0xffff
+
+class DAPServer : public JTAGServer {
+
+ private:
+  SWJDriver swj;
+  std::vector<uint8_t> pkt;
+  uint32_t select, match_mask;
+  uint16_t match_retry;
+  uint8_t idle;
+
+  // Socket hooks
+  void Recv (int sockfd, char *buf, int len);
+  void Flush (int) {}
+
+  // Command handlers - return bytes consumed or -1
+  int Execute (const uint8_t *req, int len, std::vector<uint8_t> &resp);
+  int Info (const uint8_t *req, int len, std::vector<uint8_t> &resp);
+  int Transfer (const uint8_t *req, int len, std::vector<uint8_t> &resp);
+  int TransferBlock (const uint8_t *req, int len, std::vector<uint8_t> &resp);
+  int Access (uint8_t req, uint32_t *data);
+
+ public:
+  DAPServer (uint32_t period, bool debug=0);
+  ~DAPServer () {}
+};
+
+#endif /* DAPSERVER_H */
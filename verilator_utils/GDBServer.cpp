@@ -0,0 +1,510 @@
+/**
+ *  GDB remote serial protocol server. Instead of forwarding bitbang
+ *  packets from openocd over TCP this server runs the ADIv5 transfers
+ *  itself and toggles the JTAG/SWD pins at the server period. Memory
+ *  ranges backed by sim arrays can be accessed directly while the
+ *  core is halted.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "GDBServer.h"
+
+// Cortex-M debug registers
+#define DHCSR        0xE000EDF0
+#define DCRSR        0xE000EDF4
+#define DCRDR        0xE000EDF8
+#define DEMCR        0xE000EDFC
+#define AIRCR        0xE000ED0C
+#define FP_CTRL      0xE0002000
+#define FP_COMP(n)   (0xE0002008 + ((n) * 4))
+
+#define DBGKEY       0xA05F0000
+#define C_DEBUGEN    (1 << 0)
+#define C_HALT       (1 << 1)
+#define C_STEP       (1 << 2)
+#define C_MASKINTS   (1 << 3)
+#define S_REGRDY     (1 << 16)
+#define S_HALT       (1 << 17)
+#define DCRSR_WRITE  (1 << 16)
+
+// r0-r12, sp, lr, pc, xpsr
+#define REG_CNT      17
+#define POLL_MAX     100
+
+// Advertised in qSupported, bounds memory requests
+#define PACKET_SIZE  0x1000
+
+static const char target_xml[] =
+  "<?xml version=\"1.0\"?>"
+  "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+  "<target><architecture>arm</architecture>"
+  "<feature name=\"org.gnu.gdb.arm.m-profile\">"
+  "<reg name=\"r0\" bitsize=\"32\"/><reg name=\"r1\" bitsize=\"32\"/>"
+  "<reg name=\"r2\" bitsize=\"32\"/><reg name=\"r3\" bitsize=\"32\"/>"
+  "<reg name=\"r4\" bitsize=\"32\"/><reg name=\"r5\" bitsize=\"32\"/>"
+  "<reg name=\"r6\" bitsize=\"32\"/><reg name=\"r7\" bitsize=\"32\"/>"
+  "<reg name=\"r8\" bitsize=\"32\"/><reg name=\"r9\" bitsize=\"32\"/>"
+  "<reg name=\"r10\" bitsize=\"32\"/><reg name=\"r11\" bitsize=\"32\"/>"
+  "<reg name=\"r12\" bitsize=\"32\"/>"
+  "<reg name=\"sp\" bitsize=\"32\" type=\"data_ptr\"/>"
+  "<reg name=\"lr\" bitsize=\"32\"/>"
+  "<reg name=\"pc\" bitsize=\"32\" type=\"code_ptr\"/>"
+  "<reg name=\"xpsr\" bitsize=\"32\"/>"
+  "</feature></target>";
+
+static const char hexchars[] = "0123456789abcdef";
+
+static std::string hex_encode (const uint8_t *buf, uint32_t len)
+{
+  std::string s;
+  uint32_t i;
+
+  for (i = 0; i < len; i++) {
+    s += hexchars[buf[i] >> 4];
+    s += hexchars[buf[i] & 0xf];
+  }
+  return s;
+}
+
+static uint32_t hex_decode (const char *hex, uint8_t *buf, uint32_t len)
+{
+  char byte[3] = {0};
+  uint32_t i;
+
+  for (i = 0; (i < len) && hex[0] && hex[1]; i++, hex += 2) {
+    byte[0] = hex[0];
+    byte[1] = hex[1];
+    buf[i] = strtoul (byte, NULL, 16);
+  }
+  return i;
+}
+
+GDBServer::GDBServer (uint32_t period, bool debug)
+  : JTAGServer ("GDBServer", period, debug), swj (tx, rx, running)
+{
+  // Transfers hold DAP state, single client only
+  max_clients = 1;
+  attached = false;
+  halted = false;
+  csum_cnt = -1;
+  bp_cnt = 0;
+  swd = false;
+}
+
+void GDBServer::AddBackdoor (uint32_t base, uint32_t size, uint32_t *mem)
+{
+  backdoor_t region = { base, size, mem };
+  backdoor.push_back (region);
+}
+
+//
+// Socket hooks
+//
+void GDBServer::Recv (int sockfd, char *buf, int len)
+{
+  std::string resp;
+  int i;
+
+  for (i = 0; i < len; i++) {
+
+    // Waiting for start of packet
+    if (csum_cnt < 0) {
+      if (buf[i] == '$') {
+        pkt.clear ();
+        csum_cnt = 0;
+      }
+      // Ctrl-C from client
+      else if ((buf[i] == 0x03) && attached)
+        Halt ();
+      continue;
+    }
+
+    // Collect payload until checksum
+    if (csum_cnt == 0) {
+      if (buf[i] == '#')
+        csum_cnt = 1;
+      else
+        pkt += buf[i];
+    }
+    else if (++csum_cnt == 3) {
+      csum_cnt = -1;
+
+      // Checksum isn't verified, TCP already guarantees it
+      Send (sockfd, (char *)"+", 1);
+      resp = Handle (pkt);
+
+      // Continue replies once target stops
+      if ((pkt[0] != 'c') || resp.length ())
+        Reply (sockfd, resp);
+    }
+  }
+}
+
+void GDBServer::Flush (int sockfd)
+{
+  // Report when running target stops
+  if (attached && !halted && IsHalted ()) {
+    halted = true;
+    swj.Invalidate ();
+    Reply (sockfd, "S05");
+  }
+}
+
+void GDBServer::Reply (int sockfd, std::string resp)
+{
+  std::string out;
+  uint8_t csum = 0;
+  size_t i;
+
+  // Frame payload with checksum
+  for (i = 0; i < resp.length (); i++)
+    csum += resp[i];
+  out = "$" + resp + "#";
+  out += hexchars[csum >> 4];
+  out += hexchars[csum & 0xf];
+  Send (sockfd, (char *)out.c_str (), out.length ());
+}
+
+//
+// Target control
+//
+bool GDBServer::Attach (void)
+{
+  uint32_t idcode, val;
+  int i;
+
+  // Setup DAP and halt core
+  if (swj.Connect (!swd, &idcode) != SWJ_OK) {
+    printf ("GDBServer: DAP not responding\n");
+    return false;
+  }
+  printf ("GDBServer: %s IDCODE=%08X\n", swd ? "SWD" : "JTAG", idcode);
+  if (!Halt ())
+    return false;
+
+  // Enable FPB
+  if ((swj.MemRead32 (FP_CTRL, &val) != SWJ_OK) ||
+      (swj.MemWrite32 (FP_CTRL, 3) != SWJ_OK))
+    return false;
+  bp_cnt = ((val >> 4) & 0xf) | ((val >> 8) & 0x70);
+  if (bp_cnt > 8)
+    bp_cnt = 8;
+  for (i = 0; i < bp_cnt; i++) {
+    bp[i] = 0;
+    swj.MemWrite32 (FP_COMP(i), 0);
+  }
+  attached = true;
+  return true;
+}
+
+bool GDBServer::IsHalted (void)
+{
+  uint32_t val;
+  if (swj.MemRead32 (DHCSR, &val) != SWJ_OK)
+    return false;
+  return (val & S_HALT) ? true : false;
+}
+
+bool GDBServer::Halt (void)
+{
+  int i;
+
+  if (swj.MemWrite32 (DHCSR, DBGKEY | C_HALT | C_DEBUGEN) != SWJ_OK)
+    return false;
+  for (i = 0; i < POLL_MAX; i++)
+    if (IsHalted ())
+      return true;
+  return false;
+}
+
+bool GDBServer::Resume (bool step)
+{
+  int i;
+
+  // Mask interrupts while stepping
+  if (step) {
+    if ((swj.MemWrite32 (DHCSR, DBGKEY | C_MASKINTS | C_HALT | C_DEBUGEN) != SWJ_OK) ||
+        (swj.MemWrite32 (DHCSR, DBGKEY | C_MASKINTS | C_STEP | C_DEBUGEN) != SWJ_OK))
+      return false;
+    for (i = 0; i < POLL_MAX; i++)
+      if (IsHalted ())
+        return true;
+    return false;
+  }
+
+  // Memory may change underneath backdoor
+  halted = false;
+  return (swj.MemWrite32 (DHCSR, DBGKEY | C_DEBUGEN) == SWJ_OK);
+}
+
+bool GDBServer::RegRead (uint8_t reg, uint32_t *val)
+{
+  uint32_t stat;
+  int i;
+
+  if (swj.MemWrite32 (DCRSR, reg) != SWJ_OK)
+    return false;
+  for (i = 0; i < POLL_MAX; i++) {
+    if (swj.MemRead32 (DHCSR, &stat) != SWJ_OK)
+      return false;
+    if (stat & S_REGRDY)
+      return (swj.MemRead32 (DCRDR, val) == SWJ_OK);
+  }
+  return false;
+}
+
+bool GDBServer::RegWrite (uint8_t reg, uint32_t val)
+{
+  uint32_t stat;
+  int i;
+
+  if ((swj.MemWrite32 (DCRDR, val) != SWJ_OK) ||
+      (swj.MemWrite32 (DCRSR, DCRSR_WRITE | reg) != SWJ_OK))
+    return false;
+  for (i = 0; i < POLL_MAX; i++) {
+    if (swj.MemRead32 (DHCSR, &stat) != SWJ_OK)
+      return false;
+    if (stat & S_REGRDY)
+      return true;
+  }
+  return false;
+}
+
+bool GDBServer::MemRead (uint32_t addr, uint8_t *buf, uint32_t len)
+{
+  uint32_t i, off;
+
+  // Bypass DAP for backed regions while halted
+  for (i = 0; halted && (i < backdoor.size ()); i++) {
+    if ((addr >= backdoor[i].base) && (len <= backdoor[i].size) &&
+        ((addr - backdoor[i].base) <= (backdoor[i].size - len))) {
+      for (off = addr - backdoor[i].base; len; off++, len--)
+        *buf++ = backdoor[i].mem[off / 4] >> ((off & 3) * 8);
+      return true;
+    }
+  }
+  return (swj.MemRead (addr, buf, len) == SWJ_OK);
+}
+
+bool GDBServer::MemWrite (uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+  uint32_t i, off;
+
+  // Bypass DAP for backed regions while halted
+  for (i = 0; halted && (i < backdoor.size ()); i++) {
+    if ((addr >= backdoor[i].base) && (len <= backdoor[i].size) &&
+        ((addr - backdoor[i].base) <= (backdoor[i].size - len))) {
+      for (off = addr - backdoor[i].base; len; off++, len--) {
+        backdoor[i].mem[off / 4] &= ~(0xff << ((off & 3) * 8));
+        backdoor[i].mem[off / 4] |= *buf++ << ((off & 3) * 8);
+      }
+      return true;
+    }
+  }
+  return (swj.MemWrite (addr, buf, len) == SWJ_OK);
+}
+
+bool GDBServer::Breakpoint (uint32_t addr, bool set)
+{
+  uint32_t comp;
+  int i;
+
+  // FPB only covers code region
+  if (addr >= 0x20000000)
+    return false;
+  comp = (addr & 0x1FFFFFFC) | ((addr & 2) ? 0x80000000 : 0x40000000) | 1;
+
+  // Find matching/free comparator
+  for (i = 0; i < bp_cnt; i++)
+    if (set ? (bp[i] == 0) : (bp[i] == comp))
+      break;
+  if (i == bp_cnt)
+    return false;
+  bp[i] = set ? comp : 0;
+  return (swj.MemWrite32 (FP_COMP(i), bp[i]) == SWJ_OK);
+}
+
+//
+// Packet handlers
+//
+std::string GDBServer::ReadRegs (void)
+{
+  uint32_t val;
+  std::string s;
+  int i;
+
+  for (i = 0; i < REG_CNT; i++) {
+    if (!RegRead (i, &val))
+      return "E01";
+    s += hex_encode ((uint8_t *)&val, 4);
+  }
+  return s;
+}
+
+std::string GDBServer::WriteRegs (const char *hex)
+{
+  uint32_t val;
+  int i;
+
+  for (i = 0; i < REG_CNT; i++, hex += 8) {
+    if (hex_decode (hex, (uint8_t *)&val, 4) != 4)
+      break;
+    if (!RegWrite (i, val))
+      return "E01";
+  }
+  return "OK";
+}
+
+std::string GDBServer::ReadMem (const char *args)
+{
+  uint32_t addr, len;
+  char *end;
+  std::vector<uint8_t> buf;
+
+  // m addr,len
+  addr = strtoul (args, &end, 16);
+  len = strtoul (end + 1, NULL, 16);
+  if (len > PACKET_SIZE)
+    return "E03";
+  buf.resize (len);
+  return MemRead (addr, buf.data (), len) ? hex_encode (buf.data (), len) : "E01";
+}
+
+std::string GDBServer::WriteMem (const char *args)
+{
+  uint32_t addr, len;
+  char *end;
+  std::vector<uint8_t> buf;
+
+  // M addr,len:data
+  addr = strtoul (args, &end, 16);
+  len = strtoul (end + 1, &end, 16);
+  if (len > PACKET_SIZE)
+    return "E03";
+  buf.resize (len);
+  if (hex_decode (end + 1, buf.data (), len) != len)
+    return "E02";
+  return MemWrite (addr, buf.data (), len) ? "OK" : "E01";
+}
+
+std::string GDBServer::ReadFeatures (const char *args)
+{
+  uint32_t off, len, size = sizeof (target_xml) - 1;
+  char *end;
+
+  // target.xml:offset,length
+  if (strncmp (args, "target.xml:", 11))
+    return "E00";
+  off = strtoul (args + 11, &end, 16);
+  len = strtoul (end + 1, NULL, 16);
+  if (off >= size)
+    return "l";
+  if (len >= size - off)
+    return std::string ("l") + &target_xml[off];
+  return std::string ("m") + std::string (&target_xml[off], len);
+}
+
+std::string GDBServer::Monitor (const char *hex)
+{
+  char cmd[64] = {0};
+  int i;
+
+  hex_decode (hex, (uint8_t *)cmd, sizeof (cmd) - 1);
+
+  // Reset and halt at reset vector
+  if (!strcmp (cmd, "reset")) {
+    if ((swj.MemWrite32 (DEMCR, 1) != SWJ_OK) ||
+        (swj.MemWrite32 (AIRCR, 0x05FA0004) != SWJ_OK))
+      return "E01";
+    swj.Invalidate ();
+    for (i = 0; i < POLL_MAX; i++)
+      if (IsHalted ())
+        break;
+    swj.MemWrite32 (DEMCR, 0);
+
+    // Never came out of reset halted, may be running
+    if (i == POLL_MAX) {
+      halted = false;
+      return "E01";
+    }
+    halted = true;
+    return "OK";
+  }
+  return "";
+}
+
+std::string GDBServer::Handle (std::string &cmd)
+{
+  const char *args = cmd.c_str () + 1;
+  uint32_t addr, val;
+  char *end;
+
+  // First packet from client
+  if (!cmd.compare (0, 10, "qSupported")) {
+    if ((!attached && !Attach ()) || !Halt ())
+      return "E01";
+    halted = true;
+    return "PacketSize=1000;qXfer:features:read+";
+  }
+  else if (!attached)
+    return "E01";
+
+  switch (cmd[0]) {
+    case '?':
+      return "S05";
+    case 'g':
+      return ReadRegs ();
+    case 'G':
+      return WriteRegs (args);
+    case 'p':
+      addr = strtoul (args, NULL, 16);
+      if ((addr >= REG_CNT) || !RegRead (addr, &val))
+        return "E01";
+      return hex_encode ((uint8_t *)&val, 4);
+    case 'P':
+      addr = strtoul (args, &end, 16);
+      if ((addr >= REG_CNT) || (hex_decode (end + 1, (uint8_t *)&val, 4) != 4) ||
+          !RegWrite (addr, val))
+        return "E01";
+      return "OK";
+    case 'm':
+      return ReadMem (args);
+    case 'M':
+      return WriteMem (args);
+    case 'c':
+      return Resume (false) ? "" : "E01";
+    case 's':
+      return Resume (true) ? "S05" : "E01";
+    case 'Z':
+    case 'z':
+      // Only hardware breakpoints
+      if ((cmd[1] != '0') && (cmd[1] != '1'))
+        return "";
+      addr = strtoul (args + 2, NULL, 16);
+      return Breakpoint (addr, cmd[0] == 'Z') ? "OK" : "E01";
+    case 'H':
+      return "OK";
+    case 'D':
+      Resume (false);
+      attached = false;
+      return "OK";
+    case 'q':
+      if (!cmd.compare (0, 31, "qXfer:features:read:target.xml"))
+        return ReadFeatures (args + 19);
+      else if (!cmd.compare (0, 9, "qAttached"))
+        return "1";
+      else if (!cmd.compare (0, 7, "qSymbol"))
+        return "OK";
+      else if (!cmd.compare (0, 6, "qRcmd,"))
+        return Monitor (args + 5);
+      return "";
+  }
+  return "";
+}
@@ -0,0 +1,72 @@
+/**
+ *  GDB remote serial protocol server. Instead of forwarding bitbang
+ *  packets from openocd over TCP this server runs the ADIv5 transfers
+ *  itself and toggles the JTAG/SWD pins at the server period. Memory
+ *  ranges backed by sim arrays can be accessed directly while the
+ *  core is halted.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+#ifndef GDBSERVER_H
+#define GDBSERVER_H
+
+#include <string>
+#include <vector>
+#include "JTAGServer.h"
+#include "SWJDriver.h"
+
+// Memory accessed directly through sim array
+typedef struct {
+  uint32_t base;
+  uint32_t size;
+  uint32_t *mem;
+} backdoor_t;
+
+class GDBServer : public JTAGServer {
+
+ private:
+  SWJDriver swj;
+  bool attached, halted;
+  std::string pkt;
+  int csum_cnt;
+  std::vector<backdoor_t> backdoor;
+  uint32_t bp[8];
+  int bp_cnt;
+
+  // Socket hooks
+  void Recv (int sockfd, char *buf, int len);
+  void Flush (int sockfd);
+
+  // Packet layer
+  void Reply (int sockfd, std::string resp);
+  std::string Handle (std::string &cmd);
+
+  // Target control
+  bool Attach (void);
+  bool Halt (void);
+  bool Resume (bool step);
+  bool IsHalted (void);
+  bool RegRead (uint8_t reg, uint32_t *val);
+  bool RegWrite (uint8_t reg, uint32_t val);
+  bool MemRead (uint32_t addr, uint8_t *buf, uint32_t len);
+  bool MemWrite (uint32_t addr, const uint8_t *buf, uint32_t len);
+  bool Breakpoint (uint32_t addr, bool set);
+
+  // Packet handlers
+  std::string ReadRegs (void);
+  std::string WriteRegs (const char *hex);
+  std::string ReadMem (const char *args);
+  std::string WriteMem (const char *args);
+  std::string ReadFeatures (const char *args);
+  std::string Monitor (const char *hex);
+
+ public:
+  bool swd;
+  GDBServer (uint32_t period, bool debug=0);
+  ~GDBServer () {}
+  void AddBackdoor (uint32_t base, uint32_t size, uint32_t *mem);
+};
+
+#endif /* GDBSERVER_H */
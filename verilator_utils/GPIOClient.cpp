@@ -8,36 +8,22 @@
  */
 
 #include "GPIOClient.h"
+#include "Socket.h"
 #include "err.h"
 
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
 
-void GPIOClient::Start (uint16_t port)
+void GPIOClient::Start (const char *endpoint)
 {
-  struct sockaddr_in a4;
-
-  // Create socket
-  gpiosock = socket (AF_INET, SOCK_STREAM, 0);
-  if (gpiosock < 0)
-    fail ("Unable to create gpiosock!");
+  // Connect to TCP port or unix socket
+  gpiosock = SocketConnect (endpoint);
 
   int status = fcntl(gpiosock, F_SETFL, fcntl(gpiosock, F_GETFL, 0) | O_NONBLOCK);
   if (status == -1)
     printf ("Error calling fcntl\n");
-
-  // Setup address
-  inet_pton (AF_INET, "127.0.0.1", &a4.sin_addr);
-  a4.sin_family = AF_INET;
-  a4.sin_port = htons (port);
-
-  // Connect to server
-  if (connect (gpiosock, (const sockaddr *)&a4, sizeof (a4)) != 0)
-    fail ("Failed to connect to localhost:%d", port);
-  printf ("Connected to remote GPIO :%d\n", port);
+  printf ("Connected to remote GPIO %s\n", endpoint);
 }
 
 void GPIOClient::Stop (void)
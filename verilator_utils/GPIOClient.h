@@ -21,7 +21,7 @@ class GPIOClient {
   virtual ~GPIOClient () { if (gpiosock != -1) Stop (); }
 
   // Access functions
-  void Start (uint16_t port);
+  void Start (const char *endpoint);
   void Stop (void);
   void doGPIOClient (uint64_t t,
                      uint64_t *input, size_t input_cnt,
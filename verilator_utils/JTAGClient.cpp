@@ -9,30 +9,16 @@
  */
 
 #include "JTAGClient.h"
+#include "Socket.h"
 #include "err.h"
 
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <unistd.h>
 
-void JTAGClient::Start (uint16_t port)
+void JTAGClient::Start (const char *endpoint)
 {
-  struct sockaddr_in a4;
-
-  // Create socket
-  jtagsock = socket (AF_INET, SOCK_STREAM, 0);
-  if (jtagsock < 0)
-    fail ("Unable to create jtagsock!");
-
-  // Setup address
-  inet_pton (AF_INET, "127.0.0.1", &a4.sin_addr);
-  a4.sin_family = AF_INET;
-  a4.sin_port = htons (port);
-
-  // Connect to server
-  if (connect (jtagsock, (const sockaddr *)&a4, sizeof (a4)) != 0)
-    fail ("Failed to connect to localhost:%d", port);
-  printf ("Connected to remote JTAG :%d\n", port);
+  // Connect to TCP port or unix socket
+  jtagsock = SocketConnect (endpoint);
+  printf ("Connected to remote JTAG %s\n", endpoint);
 }
 
 void JTAGClient::Stop (void)
@@ -19,7 +19,7 @@ class JTAGClient {
   virtual ~JTAGClient () { if (jtagsock != -1) Stop (); }
 
   // Access functions
-  void Start (uint16_t port);
+  void Start (const char *endpoint);
   void Stop (void);
   void doJTAGClient (uint64_t t, uint8_t tck, uint8_t *tdo, uint8_t tdi, uint8_t *tms, uint8_t tmsoe);
 };
@@ -14,6 +14,14 @@
 #include "Server.h"
 
 class JTAGServer : public Server {
+
+ protected:
+  // Derived servers reuse the bitbang pin interface
+  JTAGServer (const char *name, uint32_t period, bool debug) : Server (name, period, debug) {}
+
+  // One byte commands, TDO samples return one byte
+  int CmdLen (const std::deque<uint8_t> &p) { return p.empty () ? 0 : 1; }
+  int Responses (const uint8_t *cmd, int) { return ((*cmd == 'R') || (*cmd == 'S')) ? 1 : 0; }
   
  public:
   JTAGServer (uint32_t period, bool debug=0) : Server ("JTAGServer", period, debug) {}
@@ -0,0 +1,646 @@
+/**
+ *  Serial Wire/JTAG debug port driver. Each DP/AP transfer is expanded
+ *  into openocd bitbang pin operations:
+ *
+ *  '0'-'7' = TCK|TMS|TDI
+ *  'R'     = Sample TDO
+ *  'S'     = Sample TDO|SWDIO
+ *  'r'/'s' = Release/assert system reset
+ *
+ *  The sim side executes these with JTAGServer::doJTAGServer() at the
+ *  server period and returns samples on the response queue.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <stdio.h>
+#include <sched.h>
+
+#include "SWJDriver.h"
+
+// JTAG-DP instructions
+#define IR_ABORT   0x8
+#define IR_DPACC   0xA
+#define IR_APACC   0xB
+#define IR_IDCODE  0xE
+#define IR_LEN     4
+
+// JTAG-DP ACK encoding
+#define JTAG_ACK_OK    2
+#define JTAG_ACK_WAIT  1
+
+// SWD ACK encoding (LSB first on the wire)
+#define SWD_ACK_OK     1
+#define SWD_ACK_WAIT   2
+#define SWD_ACK_FAULT  4
+
+// Read RDBUFF via DPACC
+#define RDBUFF_READ  ((3 << 1) | 1)
+
+// Number of words streamed per batch
+#define BLOCK_MAX    256
+
+SWJDriver::SWJDriver (mc::ReaderWriterQueue<uint8_t> &ops,
+                      mc::ReaderWriterQueue<uint8_t> &resp, bool &running)
+  : ops(ops), resp(resp), running(running)
+{
+  jtag = true;
+  retries = 100;
+  apsel = 0;
+  ir = 0xff;
+  Invalidate ();
+}
+
+void SWJDriver::Invalidate (void)
+{
+  select_valid = false;
+  csw_valid = false;
+  tar_valid = false;
+}
+
+void SWJDriver::Op (uint8_t tck, uint8_t tms, uint8_t tdi)
+{
+  ops.enqueue ('0' | (tck << 2) | (tms << 1) | tdi);
+}
+
+void SWJDriver::Sample (void)
+{
+  ops.enqueue (jtag ? 'R' : 'S');
+}
+
+uint64_t SWJDriver::Collect (int len)
+{
+  uint64_t val = 0;
+  uint8_t c;
+  int i;
+
+  // Wait for samples from sim
+  for (i = 0; i < len; i++) {
+    while (!resp.try_dequeue (c)) {
+      if (!running)
+        return ~0ULL;
+      sched_yield ();
+    }
+
+    // TDO on bit0, SWDIO on bit1
+    if (jtag ? ((c - '0') & 1) : ((c - '0') & 2))
+      val |= (1ULL << i);
+  }
+  return val;
+}
+
+void SWJDriver::Idle (int cycles)
+{
+  if (jtag)
+    JTAGTMS (0, cycles);
+  else
+    SWDOut (0, cycles);
+}
+
+void SWJDriver::Reset (bool assert)
+{
+  ops.enqueue (assert ? 's' : 'r');
+}
+
+//
+// JTAG layer
+//
+void SWJDriver::JTAGClock (uint8_t tms, uint8_t tdi, bool capture)
+{
+  // TDO is valid while TCK is low
+  Op (0, tms, tdi);
+  if (capture)
+    Sample ();
+  Op (1, tms, tdi);
+}
+
+void SWJDriver::JTAGTMS (uint32_t seq, int len)
+{
+  int i;
+  for (i = 0; i < len; i++)
+    JTAGClock ((seq >> i) & 1, 0, false);
+}
+
+// Queue scan from RUNTEST_IDLE back to RUNTEST_IDLE
+void SWJDriver::JTAGShift (bool ir, uint64_t out, int len)
+{
+  int i;
+
+  // Move to SHIFT-IR/SHIFT-DR
+  if (ir)
+    JTAGTMS (0x3, 4);
+  else
+    JTAGTMS (0x1, 3);
+
+  // Shift data, last bit moves to EXIT1
+  for (i = 0; i < len; i++)
+    JTAGClock (i == (len - 1), (out >> i) & 1, true);
+
+  // UPDATE -> RUNTEST_IDLE
+  JTAGTMS (0x1, 2);
+}
+
+uint64_t SWJDriver::JTAGScan (bool ir, uint64_t out, int len)
+{
+  JTAGShift (ir, out, len);
+  return Collect (len);
+}
+
+void SWJDriver::JTAGSetIR (uint8_t val)
+{
+  if (ir != val) {
+    JTAGScan (true, val, IR_LEN);
+    ir = val;
+  }
+}
+
+int SWJDriver::JTAGTransfer (bool APnDP, uint8_t addr, bool RnW, uint32_t *data)
+{
+  uint64_t in, out;
+  uint32_t i;
+
+  // Issue DPACC/APACC scan
+  JTAGSetIR (APnDP ? IR_APACC : IR_DPACC);
+  in = ((uint64_t)(RnW ? 0 : *data) << 3) | (((addr >> 2) & 3) << 1) | (RnW ? 1 : 0);
+  for (i = 0; i < retries; i++) {
+    out = JTAGScan (false, in, 35);
+    if ((out & 7) != JTAG_ACK_WAIT)
+      break;
+  }
+  if (i == retries)
+    return SWJ_WAIT;
+
+  // Result of the previous scan is returned by RDBUFF
+  JTAGSetIR (IR_DPACC);
+  for (i = 0; i < retries; i++) {
+    out = JTAGScan (false, RDBUFF_READ, 35);
+    if ((out & 7) != JTAG_ACK_WAIT)
+      break;
+  }
+  if (i == retries)
+    return SWJ_WAIT;
+  if ((out & 7) != JTAG_ACK_OK)
+    return SWJ_FAULT;
+
+  // Save result
+  if (RnW)
+    *data = (uint32_t)(out >> 3);
+  return SWJ_OK;
+}
+
+// Pipelined AP accesses. Each scan returns the result of the
+// previous one so N accesses take N+1 scans. Scans are queued
+// optimistically, any WAIT fails the whole block.
+int SWJDriver::JTAGBlock (uint8_t addr, uint32_t *data, int cnt, bool RnW)
+{
+  uint64_t out;
+  int n, rv = SWJ_OK;
+
+  // Queue all scans
+  JTAGSetIR (IR_APACC);
+  for (n = 0; n < cnt; n++)
+    JTAGShift (false, ((uint64_t)(RnW ? 0 : data[n]) << 3) |
+               (((addr >> 2) & 3) << 1) | (RnW ? 1 : 0), 35);
+  JTAGSetIR (IR_DPACC);
+  JTAGShift (false, RDBUFF_READ, 35);
+
+  // Collect every queued result to stay in step, keep first error
+  for (n = 0; n <= cnt; n++) {
+    out = Collect (35);
+    if (rv != SWJ_OK)
+      continue;
+    if ((out & 7) == JTAG_ACK_WAIT)
+      rv = SWJ_WAIT;
+    else if ((n > 0) && ((out & 7) != JTAG_ACK_OK))
+      rv = SWJ_FAULT;
+    else if ((n > 0) && RnW)
+      data[n - 1] = (uint32_t)(out >> 3);
+  }
+  return rv;
+}
+
+//
+// SWD layer
+//
+void SWJDriver::SWDOut (uint64_t val, int len)
+{
+  int i;
+
+  // Target samples on rising edge
+  for (i = 0; i < len; i++) {
+    Op (0, (val >> i) & 1, 0);
+    Op (1, (val >> i) & 1, 0);
+  }
+}
+
+uint64_t SWJDriver::SWDIn (int len)
+{
+  int i;
+
+  // Target drives on rising edge, sample while low
+  for (i = 0; i < len; i++) {
+    Op (0, 1, 0);
+    Sample ();
+    Op (1, 1, 0);
+  }
+  return Collect (len);
+}
+
+int SWJDriver::SWDTransfer (bool APnDP, uint8_t addr, bool RnW, uint32_t *data)
+{
+  uint8_t req, ack;
+  uint64_t val;
+  uint32_t i;
+
+  // Start, APnDP, RnW, A[3:2], parity, stop, park
+  req = (APnDP ? 2 : 0) | (RnW ? 4 : 0) | (((addr >> 2) & 3) << 3);
+  req |= 0x81 | (__builtin_parity (req) << 5);
+
+  for (i = 0; i < retries; i++) {
+
+    // Send request, turnaround + ACK
+    SWDOut (req, 8);
+    ack = (SWDIn (4) >> 1) & 7;
+
+    if (ack == SWD_ACK_OK) {
+      if (RnW) {
+        // Data, parity, turnaround
+        val = SWDIn (34);
+        SWDOut (0, 8);
+        if (__builtin_parity ((uint32_t)val) != ((val >> 32) & 1))
+          return SWJ_FAULT;
+        *data = (uint32_t)val;
+      }
+      else {
+        // Turnaround, data, parity
+        SWDIn (1);
+        SWDOut ((uint64_t)*data | ((uint64_t)__builtin_parity (*data) << 32), 33);
+        SWDOut (0, 8);
+      }
+      return SWJ_OK;
+    }
+
+    // Turnaround back to host
+    SWDIn (1);
+    if (ack == SWD_ACK_FAULT)
+      return SWJ_FAULT;
+    else if (ack != SWD_ACK_WAIT)
+      return SWJ_NOCONNECT;
+  }
+  return SWJ_WAIT;
+}
+
+int SWJDriver::SWDBlock (uint8_t addr, uint32_t *data, int cnt, bool RnW)
+{
+  uint32_t dummy;
+  int n, rv;
+
+  // Writes are posted
+  if (!RnW) {
+    for (n = 0; n < cnt; n++)
+      if ((rv = SWDTransfer (true, addr, false, &data[n])) != SWJ_OK)
+        return rv;
+    return SWJ_OK;
+  }
+
+  // Each AP read returns the previous result
+  for (n = 0; n < cnt; n++)
+    if ((rv = SWDTransfer (true, addr, true, n ? &data[n - 1] : &dummy)) != SWJ_OK)
+      return rv;
+  return SWDTransfer (false, DP_RDBUFF, true, &data[cnt - 1]);
+}
+
+//
+// DP/AP access
+//
+int SWJDriver::Connect (bool jtag, uint32_t *idcode)
+{
+  uint32_t val;
+  int i, rv;
+
+  // Reset cached state
+  this->jtag = jtag;
+  Invalidate ();
+
+  if (jtag) {
+    // SWD -> JTAG then TEST_LOGIC_RESET -> RUNTEST_IDLE
+    JTAGTMS (0xffffffff, 32);
+    JTAGTMS (0xffffffff, 24);
+    JTAGTMS (0xe73c, 16);
+    JTAGTMS (0xff, 8);
+    JTAGTMS (0, 1);
+    ir = IR_IDCODE;
+  }
+  else {
+    // JTAG -> SWD, line reset, idle
+    SWDOut (0xffffffffffffffULL, 56);
+    SWDOut (0xe79e, 16);
+    SWDOut (0xffffffffffffffULL, 56);
+    SWDOut (0, 8);
+  }
+
+  // Reading IDCODE takes SW-DP out of reset state
+  if ((rv = DPRead (DP_IDCODE, &val)) != SWJ_OK)
+    return rv;
+  if (idcode)
+    *idcode = val;
+  if ((rv = ClearErrors ()) != SWJ_OK)
+    return rv;
+
+  // Power up debug and system domains
+  if ((rv = DPWrite (DP_CTRL_STAT, 0x50000000)) != SWJ_OK)
+    return rv;
+  for (i = 0; i < (int)retries; i++) {
+    if ((rv = DPRead (DP_CTRL_STAT, &val)) != SWJ_OK)
+      return rv;
+    if ((val & 0xA0000000) == 0xA0000000)
+      return SWJ_OK;
+  }
+  return SWJ_NOCONNECT;
+}
+
+int SWJDriver::DPRead (uint8_t addr, uint32_t *data)
+{
+  // IDCODE has a dedicated JTAG instruction
+  if (jtag && (addr == DP_IDCODE)) {
+    JTAGSetIR (IR_IDCODE);
+    *data = (uint32_t)JTAGScan (false, 0, 32);
+    return SWJ_OK;
+  }
+  return jtag ? JTAGTransfer (false, addr, true, data) :
+    SWDTransfer (false, addr, true, data);
+}
+
+int SWJDriver::DPWrite (uint8_t addr, uint32_t data)
+{
+  // Track SELECT
+  if (addr == DP_SELECT) {
+    select = data;
+    select_valid = true;
+  }
+
+  // ABORT has a dedicated JTAG instruction
+  if (jtag && (addr == DP_ABORT)) {
+    JTAGSetIR (IR_ABORT);
+    JTAGScan (false, (uint64_t)data << 3, 35);
+    return SWJ_OK;
+  }
+  return jtag ? JTAGTransfer (false, addr, false, &data) :
+    SWDTransfer (false, addr, false, &data);
+}
+
+int SWJDriver::ClearErrors (void)
+{
+  // Sticky errors are write-1-to-clear in CTRL/STAT on JTAG-DP
+  Invalidate ();
+  if (jtag)
+    return DPWrite (DP_CTRL_STAT, 0x50000032);
+  else
+    return DPWrite (DP_ABORT, 0x1e);
+}
+
+int SWJDriver::SetSelect (uint8_t addr)
+{
+  uint32_t val = (apsel << 24) | (addr & 0xf0);
+
+  // Skip if bank already selected
+  if (select_valid && (select == val))
+    return SWJ_OK;
+  return DPWrite (DP_SELECT, val);
+}
+
+int SWJDriver::APRead (uint8_t addr, uint32_t *data)
+{
+  int rv;
+
+  if ((rv = SetSelect (addr)) != SWJ_OK)
+    return rv;
+  if (jtag)
+    return JTAGTransfer (true, addr, true, data);
+
+  // Posted read, result in RDBUFF
+  if ((rv = SWDTransfer (true, addr, true, data)) != SWJ_OK)
+    return rv;
+  return SWDTransfer (false, DP_RDBUFF, true, data);
+}
+
+int SWJDriver::APWrite (uint8_t addr, uint32_t data)
+{
+  int rv;
+
+  if ((rv = SetSelect (addr)) != SWJ_OK)
+    return rv;
+  rv = jtag ? JTAGTransfer (true, addr, false, &data) :
+    SWDTransfer (true, addr, false, &data);
+
+  // Track MEM-AP state
+  if ((addr == AP_CSW) && (rv == SWJ_OK)) {
+    csw = data;
+    csw_valid = true;
+  }
+  else if (addr == AP_TAR) {
+    tar = data;
+    tar_valid = (rv == SWJ_OK);
+  }
+  return rv;
+}
+
+// Repeated access to the same AP register
+int SWJDriver::APReadBlock (uint8_t addr, uint32_t *data, int cnt)
+{
+  int rv;
+
+  if (cnt == 0)
+    return SWJ_OK;
+  if ((rv = SetSelect (addr)) != SWJ_OK)
+    return rv;
+
+  // TAR advances underneath the cache
+  if (addr == AP_DRW)
+    tar_valid = false;
+  return jtag ? JTAGBlock (addr, data, cnt, true) : SWDBlock (addr, data, cnt, true);
+}
+
+int SWJDriver::APWriteBlock (uint8_t addr, uint32_t *data, int cnt)
+{
+  int rv;
+
+  if (cnt == 0)
+    return SWJ_OK;
+  if ((rv = SetSelect (addr)) != SWJ_OK)
+    return rv;
+
+  // TAR advances underneath the cache
+  if (addr == AP_DRW)
+    tar_valid = false;
+  return jtag ? JTAGBlock (addr, data, cnt, false) : SWDBlock (addr, data, cnt, false);
+}
+
+//
+// MEM-AP access
+//
+int SWJDriver::SetCSW (uint32_t size)
+{
+  uint32_t val = CSW_DEFAULT | CSW_INC | size;
+
+  if (csw_valid && (csw == val))
+    return SWJ_OK;
+  return APWrite (AP_CSW, val);
+}
+
+int SWJDriver::SetTAR (uint32_t addr)
+{
+  if (tar_valid && (tar == addr))
+    return SWJ_OK;
+  return APWrite (AP_TAR, addr);
+}
+
+void SWJDriver::IncTAR (uint32_t bytes)
+{
+  // Wrap is implementation defined past 1KB
+  tar += bytes;
+  if ((tar & (TAR_WRAP - 1)) == 0)
+    tar_valid = false;
+}
+
+int SWJDriver::MemRead32 (uint32_t addr, uint32_t *data)
+{
+  int rv;
+
+  if (((rv = SetCSW (CSW_SIZE32)) != SWJ_OK) ||
+      ((rv = SetTAR (addr)) != SWJ_OK) ||
+      ((rv = APRead (AP_DRW, data)) != SWJ_OK)) {
+    Invalidate ();
+    return rv;
+  }
+  IncTAR (4);
+  return SWJ_OK;
+}
+
+int SWJDriver::MemWrite32 (uint32_t addr, uint32_t data)
+{
+  int rv;
+
+  if (((rv = SetCSW (CSW_SIZE32)) != SWJ_OK) ||
+      ((rv = SetTAR (addr)) != SWJ_OK) ||
+      ((rv = APWrite (AP_DRW, data)) != SWJ_OK)) {
+    Invalidate ();
+    return rv;
+  }
+  IncTAR (4);
+  return SWJ_OK;
+}
+
+int SWJDriver::MemBlock (uint32_t addr, uint32_t *data, int cnt, bool RnW)
+{
+  int n, rv;
+
+  // Stream DRW accesses from current TAR
+  if (((rv = SetCSW (CSW_SIZE32)) != SWJ_OK) ||
+      ((rv = SetTAR (addr)) != SWJ_OK) ||
+      ((rv = SetSelect (AP_DRW)) != SWJ_OK))
+    return rv;
+  rv = jtag ? JTAGBlock (AP_DRW, data, cnt, RnW) : SWDBlock (AP_DRW, data, cnt, RnW);
+  if (rv == SWJ_OK) {
+    IncTAR (cnt * 4);
+    return SWJ_OK;
+  }
+
+  // Target stalled - TAR is unknown, retry one word at a time
+  Invalidate ();
+  if (rv != SWJ_WAIT)
+    return rv;
+  if ((rv = ClearErrors ()) != SWJ_OK)
+    return rv;
+  for (n = 0; n < cnt; n++) {
+    rv = RnW ? MemRead32 (addr + (n * 4), &data[n]) : MemWrite32 (addr + (n * 4), data[n]);
+    if (rv != SWJ_OK)
+      return rv;
+  }
+  return SWJ_OK;
+}
+
+// Words this far into a 1KB TAR block
+static uint32_t block_words (uint32_t addr, uint32_t len)
+{
+  uint32_t cnt = (TAR_WRAP - (addr & (TAR_WRAP - 1))) / 4;
+  if (cnt > len / 4)
+    cnt = len / 4;
+  if (cnt > BLOCK_MAX)
+    cnt = BLOCK_MAX;
+  return cnt;
+}
+
+int SWJDriver::MemRead (uint32_t addr, uint8_t *buf, uint32_t len)
+{
+  uint32_t words[BLOCK_MAX], val, cnt, i;
+  int rv;
+
+  while (len) {
+
+    // Unaligned head/tail as byte accesses
+    if ((addr & 3) || (len < 4)) {
+      if (((rv = SetCSW (CSW_SIZE8)) != SWJ_OK) ||
+          ((rv = SetTAR (addr)) != SWJ_OK) ||
+          ((rv = APRead (AP_DRW, &val)) != SWJ_OK)) {
+        Invalidate ();
+        return rv;
+      }
+      IncTAR (1);
+      *buf++ = (val >> ((addr & 3) * 8)) & 0xff;
+      addr++;
+      len--;
+      continue;
+    }
+
+    // Stream words up to TAR wrap
+    cnt = block_words (addr, len);
+    if ((rv = MemBlock (addr, words, cnt, true)) != SWJ_OK)
+      return rv;
+    for (i = 0; i < cnt; i++) {
+      *buf++ = words[i] & 0xff;
+      *buf++ = (words[i] >> 8) & 0xff;
+      *buf++ = (words[i] >> 16) & 0xff;
+      *buf++ = (words[i] >> 24) & 0xff;
+    }
+    addr += cnt * 4;
+    len -= cnt * 4;
+  }
+  return SWJ_OK;
+}
+
+int SWJDriver::MemWrite (uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+  uint32_t words[BLOCK_MAX], cnt, i;
+  int rv;
+
+  while (len) {
+
+    // Unaligned head/tail as byte accesses
+    if ((addr & 3) || (len < 4)) {
+      if (((rv = SetCSW (CSW_SIZE8)) != SWJ_OK) ||
+          ((rv = SetTAR (addr)) != SWJ_OK) ||
+          ((rv = APWrite (AP_DRW, (uint32_t)*buf << ((addr & 3) * 8))) != SWJ_OK)) {
+        Invalidate ();
+        return rv;
+      }
+      IncTAR (1);
+      buf++;
+      addr++;
+      len--;
+      continue;
+    }
+
+    // Stream words up to TAR wrap
+    cnt = block_words (addr, len);
+    for (i = 0; i < cnt; i++, buf += 4)
+      words[i] = buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+    if ((rv = MemBlock (addr, words, cnt, false)) != SWJ_OK)
+      return rv;
+    addr += cnt * 4;
+    len -= cnt * 4;
+  }
+  return SWJ_OK;
+}
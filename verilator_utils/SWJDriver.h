@@ -0,0 +1,118 @@
+/**
+ *  Serial Wire/JTAG debug port driver. Generates ADIv5 DP/AP transfers
+ *  as openocd bitbang pin operations. Operations are pushed to the sim
+ *  through the same queues JTAGServer uses so servers can drive the
+ *  target pins directly instead of shuttling each edge over TCP.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+#ifndef SWJDRIVER_H
+#define SWJDRIVER_H
+
+#include <stdint.h>
+#include "readerwriterqueue.h"
+
+// Transfer status - same encoding as adiv5_pkg
+typedef enum {
+  SWJ_FAULT     = 1,
+  SWJ_WAIT      = 2,
+  SWJ_OK        = 4,
+  SWJ_NOCONNECT = 7
+} swj_stat_t;
+
+// DP registers
+#define DP_IDCODE     0x0
+#define DP_ABORT      0x0
+#define DP_CTRL_STAT  0x4
+#define DP_SELECT     0x8
+#define DP_RDBUFF     0xc
+
+// MEM-AP registers
+#define AP_CSW        0x00
+#define AP_TAR        0x04
+#define AP_DRW        0x0c
+#define AP_BASE       0xf8
+#define AP_IDR        0xfc
+
+// CSW fields
+#define CSW_SIZE8     0x0
+#define CSW_SIZE16    0x1
+#define CSW_SIZE32    0x2
+#define CSW_SIZE_MSK  0x7
+#define CSW_INC       0x10
+#define CSW_DEFAULT   0xA2000000
+
+// TAR auto-increment is only guaranteed within a 1KB block
+#define TAR_WRAP      0x400
+
+class SWJDriver {
+
+ private:
+  mc::ReaderWriterQueue<uint8_t> &ops, &resp;
+  bool &running;
+  bool jtag;
+  uint32_t retries;
+
+  // Cached DP/AP state
+  uint8_t  ir;
+  uint32_t select, csw, tar;
+  bool     select_valid, csw_valid, tar_valid;
+
+  // Pin level
+  void Op (uint8_t tck, uint8_t tms, uint8_t tdi);
+  void Sample (void);
+  uint64_t Collect (int len);
+
+  // JTAG
+  void JTAGClock (uint8_t tms, uint8_t tdi, bool capture);
+  void JTAGTMS (uint32_t seq, int len);
+  void JTAGShift (bool ir, uint64_t out, int len);
+  uint64_t JTAGScan (bool ir, uint64_t out, int len);
+  void JTAGSetIR (uint8_t val);
+  int JTAGTransfer (bool APnDP, uint8_t addr, bool RnW, uint32_t *data);
+  int JTAGBlock (uint8_t addr, uint32_t *data, int cnt, bool RnW);
+
+  // SWD
+  void SWDOut (uint64_t val, int len);
+  uint64_t SWDIn (int len);
+  int SWDTransfer (bool APnDP, uint8_t addr, bool RnW, uint32_t *data);
+  int SWDBlock (uint8_t addr, uint32_t *data, int cnt, bool RnW);
+
+  // MEM-AP helpers
+  int SetSelect (uint8_t addr);
+  int SetCSW (uint32_t size);
+  int SetTAR (uint32_t addr);
+  void IncTAR (uint32_t bytes);
+  int MemBlock (uint32_t addr, uint32_t *data, int cnt, bool RnW);
+
+ public:
+  uint8_t apsel;
+  SWJDriver (mc::ReaderWriterQueue<uint8_t> &ops, mc::ReaderWriterQueue<uint8_t> &resp, bool &running);
+  ~SWJDriver () {}
+
+  // Setup transport and power up debug domain
+  int Connect (bool jtag, uint32_t *idcode=NULL);
+  void Invalidate (void);
+  void SetRetries (uint32_t cnt) { retries = cnt ? cnt : 1; }
+  void Idle (int cycles);
+  void Reset (bool assert);
+
+  // Raw DP/AP access
+  int DPRead (uint8_t addr, uint32_t *data);
+  int DPWrite (uint8_t addr, uint32_t data);
+  int APRead (uint8_t addr, uint32_t *data);
+  int APWrite (uint8_t addr, uint32_t data);
+  int APReadBlock (uint8_t addr, uint32_t *data, int cnt);
+  int APWriteBlock (uint8_t addr, uint32_t *data, int cnt);
+  int ClearErrors (void);
+
+  // MEM-AP access
+  int MemRead32 (uint32_t addr, uint32_t *data);
+  int MemWrite32 (uint32_t addr, uint32_t data);
+  int MemRead (uint32_t addr, uint8_t *buf, uint32_t len);
+  int MemWrite (uint32_t addr, const uint8_t *buf, uint32_t len);
+};
+
+#endif /* SWJDRIVER_H */
@@ -13,12 +13,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <sys/fcntl.h>
+#include <poll.h>
 #include <iostream>
 
 #include "Server.h"
+#include "Socket.h"
 #include "err.h"
 
 Server::Server (const char *name, uint32_t period, bool debug)
@@ -26,6 +29,11 @@ Server::Server (const char *name, uint32_t period, bool debug)
   this->name = name;
   this->period = period;
   this->debug = debug;
+  this->endpoint = NULL;
+  this->running = 0;
+  this->max_clients = MAX_CLIENTS;
+  this->next_id = 0;
+  this->rr = 0;
 }
 
 Server::~Server ()
@@ -35,15 +43,16 @@ Server::~Server ()
     running = 0;
     shutdown (sockfd, SHUT_RDWR);
     pthread_join (thread_id, NULL);
+    SocketCleanup (endpoint);
   }
 }
 
-void Server::Start (uint16_t port)
+void Server::Start (const char *endpoint)
 {
   int rv;
 
-  /* Save port */
-  this->port = port;
+  /* Save TCP port or unix:/path */
+  this->endpoint = endpoint;
 
   /* Spawn new thread - Hacky but works... */
   #pragma GCC diagnostic ignored "-Wpmf-conversions"
@@ -54,89 +63,224 @@ void Server::Start (uint16_t port)
 
 void Server::Send (int sockfd, char *buf, int len)
 {
-  int rv;
+  client_t *c = Client (sockfd);
 
   /* Debug */
   if (debug) {
     buf[len] = '\0';
     printf ("resp=[%s]\n", buf);
   }
-  
-  /* Write a response to the client */
-  rv = write (sockfd, buf, len);
-  if (rv < 0) {
-    fail ("ERROR writing to socket");
+
+  /* Queue behind unsent bytes, a slow reader must not stall the sim */
+  if (c) {
+    c->wbuf.append (buf, len);
+    Drain (c);
   }
 }
 
-void Server::Listen (void)
+// Write queued bytes until the socket would block
+void Server::Drain (client_t *c)
 {
-  int nsockfd, n, i, enable = 1;
-  socklen_t clilen;
-  char cmd[256], resp[256];
-  struct sockaddr_in serv_addr, cli_addr;
+  int rv;
 
-  /* Set running */
-  running = 1;
-  
-  /* First call to socket() function */
-  sockfd = socket(AF_INET, SOCK_STREAM, 0);   
-  if (sockfd < 0) {
-    fail("ERROR opening socket");
+  while (c->wbuf.length ()) {
+    rv = write (c->fd, c->wbuf.data (), c->wbuf.length ());
+    if (rv < 0) {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+        return;
+      fail ("ERROR writing to socket");
+    }
+    c->wbuf.erase (0, rv);
   }
-  if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int)) < 0)
-    fail("setsockopt(SO_REUSEADDR) failed");
- 
-  /* Initialize socket structure */
-  bzero((char *) &serv_addr, sizeof(serv_addr));
-  serv_addr.sin_family = AF_INET;
-  serv_addr.sin_addr.s_addr = INADDR_ANY;
-  serv_addr.sin_port = htons(this->port);
+}
 
-  /* Print message */
-  printf ("%s listening on port: %u...\n", this->name, this->port);
+client_t *Server::Client (int sockfd)
+{
+  size_t i;
+  for (i = 0; i < clients.size (); i++)
+    if (clients[i].fd == sockfd)
+      return &clients[i];
+  return NULL;
+}
+
+void Server::Recv (int sockfd, char *buf, int len)
+{
+  client_t *c = Client (sockfd);
+
+  // Hold until scheduled
+  if (c)
+    c->pending.insert (c->pending.end (), buf, buf + len);
+}
+
+// Round robin whole commands into sim queue
+void Server::Schedule (void)
+{
+  size_t i, cnt = clients.size ();
+  std::vector<uint8_t> cmd;
+  client_t *c;
+  int j, len, n;
+
+  for (i = 0; i < cnt; i++) {
+    c = &clients[(rr + i) % cnt];
 
-  /* Now bind the host address using bind() call.*/
-  if (bind(sockfd, (struct sockaddr *) &serv_addr, sizeof(serv_addr)) < 0) {
-    fail("ERROR on binding");
+    // Byte stream, only the oldest client writes
+    if (CmdLen (c->pending) < 0) {
+      if (c != &clients[0]) {
+        c->pending.clear ();
+        continue;
+      }
+      while (!c->pending.empty ()) {
+        if (!tx.enqueue (c->pending.front ()))
+          fail ("%s: failed to queue", this->name);
+        c->pending.pop_front ();
+      }
+      continue;
+    }
+
+    // Never split a command between clients
+    for (j = 0; (j < CLIENT_QUANTUM) && ((len = CmdLen (c->pending)) > 0); j += len) {
+      cmd.assign (c->pending.begin (), c->pending.begin () + len);
+      c->pending.erase (c->pending.begin (), c->pending.begin () + len);
+      for (n = 0; n < len; n++)
+        if (!tx.enqueue (cmd[n]))
+          fail ("%s: failed to queue", this->name);
+
+      // Track who gets the response
+      if ((n = Responses (cmd.data (), len)) > 0) {
+        if (!expect.empty () && (expect.back ().first == c->id))
+          expect.back ().second += n;
+        else
+          expect.push_back (std::make_pair (c->id, n));
+      }
+    }
   }
-  
-  /* Now start listening for the clients, here process will
-   * go in sleep mode and will wait for the incoming connection
-   */
-  listen(sockfd,5);
-  clilen = sizeof(cli_addr);
-  
-  /* Accept actual connection from the client */
- restart_connection:
-  nsockfd = accept(sockfd, (struct sockaddr *)&cli_addr, &clilen);
-  if (nsockfd < 0) {
-    fail("ERROR on accept");
-    goto done;
+  if (cnt)
+    rr = (rr + 1) % cnt;
+}
+
+// Return responses to requesting client, broadcast unsolicited bytes
+// to every listener
+void Server::Route (void)
+{
+  uint8_t val;
+  size_t i;
+
+  while (rx.size_approx () && rx.try_dequeue (val)) {
+    if (expect.empty ()) {
+      for (i = 0; i < clients.size (); i++)
+        clients[i].out += val;
+      continue;
+    }
+    for (i = 0; i < clients.size (); i++)
+      if (clients[i].id == expect.front ().first)
+        clients[i].out += val;
+    if (--expect.front ().second == 0)
+      expect.pop_front ();
+  }
+}
+
+void Server::Flush (int sockfd)
+{
+  client_t *c;
+
+  // Empty receive buffer
+  Route ();
+
+  // Flush to socket
+  c = Client (sockfd);
+  if (c && c->out.length ()) {
+    Send (sockfd, (char *)c->out.c_str (), c->out.length ());
+    c->out.clear ();
+  }
+}
+
+void Server::Accept (void)
+{
+  struct sockaddr_storage cli_addr;
+  socklen_t clilen = sizeof (cli_addr);
+  client_t c;
+  int fd;
+
+  fd = accept (sockfd, (struct sockaddr *)&cli_addr, &clilen);
+  if (fd < 0) {
+    if (running)
+      printf ("%s: accept failed\n", this->name);
+    return;
+  }
+
+  // Refuse when full
+  if ((int)clients.size () >= max_clients) {
+    printf ("%s: too many clients, refused\n", this->name);
+    close (fd);
+    return;
   }
 
   // Make socket non-blocking
-  fcntl(nsockfd, F_SETFL, O_NONBLOCK);
+  fcntl (fd, F_SETFL, O_NONBLOCK);
+  c.fd = fd;
+  c.id = next_id++;
+  clients.push_back (c);
+  printf ("%s connected (%lu clients%s).\n", this->name, clients.size (),
+          ((clients.size () > 1) && (CmdLen (c.pending) < 0)) ? ", read-only" : "");
+}
+
+void Server::Close (int idx)
+{
+  close (clients[idx].fd);
+  clients.erase (clients.begin () + idx);
+  printf ("%s connection closed (%lu clients).\n", this->name, clients.size ());
+}
+
+void Server::Listen (void)
+{
+  std::vector<struct pollfd> fds;
+  char cmd[256];
+  size_t i;
+  int n;
+
+  /* Set running */
+  running = 1;
   
-  // Print client is connected
-  printf ("%s connected.\n", this->name);
-      
-  // Continue to listen until connection is broken
-  while (running) {
+  /* Bind to TCP port or unix socket */
+  sockfd = SocketListen (this->endpoint, 5);
 
-    /* If connection is established then start communicating */
-    bzero (cmd, sizeof (cmd));
-    n = read (nsockfd, cmd, sizeof (cmd) - 1);
+  /* Print message */
+  printf ("%s listening on %s...\n", this->name, this->endpoint);
 
-    // Otherside closed connection
-    if (n == 0) {
-      close (nsockfd);
-      printf ("Connection closed, restarting...\n");
-      goto restart_connection;
+  while (running) {
+
+    // Listening socket first then clients
+    fds.resize (clients.size () + 1);
+    fds[0].fd = sockfd;
+    fds[0].events = POLLIN;
+    for (i = 0; i < clients.size (); i++) {
+      fds[i + 1].fd = clients[i].fd;
+      fds[i + 1].events = POLLIN | (clients[i].wbuf.length () ? POLLOUT : 0);
     }
-    
-    /* Process packet */
-    if (n > 0) {
+
+    // Spin while connected to keep response latency low
+    if (poll (&fds[0], fds.size (), clients.size () ? 0 : 100) < 0)
+      continue;
+    if (fds[0].revents & POLLIN)
+      Accept ();
+
+    // Read from each client, walk backwards so Close() is safe
+    for (i = fds.size () - 1; i > 0; i--) {
+
+      // Socket drained, write what is left
+      if (fds[i].revents & POLLOUT)
+        Drain (&clients[i - 1]);
+      if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+        continue;
+      n = read (fds[i].fd, cmd, sizeof (cmd) - 1);
+
+      // Otherside closed connection
+      if ((n == 0) || ((n < 0) && (errno != EAGAIN))) {
+        Close (i - 1);
+        continue;
+      }
+      else if (n < 0)
+        continue;
 
       // NULL terminate
       if (debug) {
@@ -144,25 +288,21 @@ void Server::Listen (void)
         printf ("Recvd=[%s] len=%d\n", cmd, n);
       }
 
-      // Process each command
-      for (i = 0; i < n; i++)
-        if (!tx.enqueue (cmd[i]))
-          printf ("Failed to queue\n");
+      // Process commands
+      Recv (fds[i].fd, cmd, n);
     }
-    
+
+    // Interleave clients into sim
+    Schedule ();
+
     // Empty receive buffer
-    if (rx.size_approx ()) {
-      uint8_t val;
-
-      // Create response packet
-      for (i = 0; (i < sizeof (resp)) && rx.try_dequeue (val); i++)
-        resp[i] = val;
-      
-      // Flush to socket
-      Send (nsockfd, resp, i);
-    }
+    for (i = 0; i < clients.size (); i++)
+      Flush (clients[i].fd);
   }
-  
- done:
+
+  // Drop remaining clients
+  while (clients.size ())
+    Close (clients.size () - 1);
+  close (sockfd);
   printf ("%s terminating.\n", this->name);
 }
@@ -13,28 +13,67 @@
 
 #include <pthread.h>
 #include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
 #include "readerwriterqueue.h"
 
+// Maximum concurrent connections per service
+#define MAX_CLIENTS  8
+
+// Command bytes moved to sim per framed client per round
+#define CLIENT_QUANTUM  64
+
+typedef struct {
+  int fd;
+  uint32_t id;
+  std::deque<uint8_t> pending;  // Received, not yet queued to sim
+  std::string out;              // Responses waiting for socket
+  std::string wbuf;             // Sent, socket not yet writable
+} client_t;
+
 class Server {
 
  private:
   const char *name;
   int sockfd;
-  uint16_t port;
+  const char *endpoint;
   pthread_t thread_id;
   bool debug;
+  std::vector<client_t> clients;
+  std::deque<std::pair<uint32_t, int> > expect;
+  uint32_t next_id, rr;
   void Listen (void);
-  void Send (int sockfd, char *buf, int len);
+  void Accept (void);
+  void Close (int idx);
+  void Schedule (void);
+  void Route (void);
+  void Drain (client_t *c);
+  client_t *Client (int sockfd);
 
  protected:
   bool running;
+  int max_clients;
   mc::ReaderWriterQueue<uint8_t> rx, tx;
 
+  // Socket hooks - default shuttles raw bytes between socket and sim
+  void Send (int sockfd, char *buf, int len);
+  virtual void Recv (int sockfd, char *buf, int len);
+  virtual void Flush (int sockfd);
+
+  // Bytes in the complete command at the head of pending, 0 if not yet
+  // complete. Byte streams return -1 and take a single writer, other
+  // clients only listen.
+  virtual int CmdLen (const std::deque<uint8_t> &) { return -1; }
+
+  // Sim response bytes generated by a framed command
+  virtual int Responses (const uint8_t *, int) { return 0; }
+
  public:
   uint32_t period;
   Server (const char *name, uint32_t period, bool debug=0);
   virtual ~Server ();
-  void Start (uint16_t port);
+  void Start (const char *endpoint);
 };
 
 #endif /* SERVER_H */
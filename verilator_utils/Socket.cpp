@@ -0,0 +1,108 @@
+/**
+ *  Socket endpoint helpers shared by servers and clients. An endpoint
+ *  is either a TCP port on localhost ("2345") or a Unix domain socket
+ *  path ("unix:/tmp/jtag.sock"). Unix sockets skip the loopback TCP
+ *  stack which matters for synchronous per-cycle round trips.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "Socket.h"
+#include "err.h"
+
+static const char *unix_path (const char *endpoint)
+{
+  if (!strncmp (endpoint, UNIX_PREFIX, strlen (UNIX_PREFIX)))
+    return endpoint + strlen (UNIX_PREFIX);
+  return NULL;
+}
+
+// Fill in address for either socket type
+static socklen_t endpoint_addr (const char *endpoint, struct sockaddr_storage *addr, bool any)
+{
+  struct sockaddr_un *un = (struct sockaddr_un *)addr;
+  struct sockaddr_in *in = (struct sockaddr_in *)addr;
+  const char *path = unix_path (endpoint);
+
+  memset (addr, 0, sizeof (*addr));
+  if (path) {
+    if (strlen (path) >= sizeof (un->sun_path))
+      fail ("Socket path too long: %s", path);
+    un->sun_family = AF_UNIX;
+    strcpy (un->sun_path, path);
+    return sizeof (*un);
+  }
+  in->sin_family = AF_INET;
+  in->sin_port = htons (atoi (endpoint));
+  if (any)
+    in->sin_addr.s_addr = INADDR_ANY;
+  else
+    inet_pton (AF_INET, "127.0.0.1", &in->sin_addr);
+  return sizeof (*in);
+}
+
+int SocketListen (const char *endpoint, int backlog)
+{
+  struct sockaddr_storage addr;
+  socklen_t len;
+  int fd, enable = 1;
+
+  // Create socket
+  len = endpoint_addr (endpoint, &addr, true);
+  fd = socket (addr.ss_family, SOCK_STREAM, 0);
+  if (fd < 0)
+    fail ("ERROR opening socket");
+
+  // Reuse TCP port/remove stale socket file
+  if (addr.ss_family == AF_INET) {
+    if (setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof (int)) < 0)
+      fail ("setsockopt(SO_REUSEADDR) failed");
+  }
+  else
+    unlink (unix_path (endpoint));
+
+  if (bind (fd, (struct sockaddr *)&addr, len) < 0)
+    fail ("ERROR on binding %s", endpoint);
+  listen (fd, backlog);
+  return fd;
+}
+
+int SocketConnect (const char *endpoint)
+{
+  struct sockaddr_storage addr;
+  socklen_t len;
+  int fd, enable = 1;
+
+  // Create socket
+  len = endpoint_addr (endpoint, &addr, false);
+  fd = socket (addr.ss_family, SOCK_STREAM, 0);
+  if (fd < 0)
+    fail ("Unable to create socket!");
+
+  // Connect to server
+  if (connect (fd, (const struct sockaddr *)&addr, len) != 0)
+    fail ("Failed to connect to %s", endpoint);
+
+  // Small packets are latency bound
+  if (addr.ss_family == AF_INET)
+    setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof (int));
+  return fd;
+}
+
+void SocketCleanup (const char *endpoint)
+{
+  const char *path = unix_path (endpoint);
+  if (path)
+    unlink (path);
+}
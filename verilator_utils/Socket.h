@@ -0,0 +1,25 @@
+/**
+ *  Socket endpoint helpers shared by servers and clients. An endpoint
+ *  is either a TCP port on localhost ("2345") or a Unix domain socket
+ *  path ("unix:/tmp/jtag.sock"). Unix sockets skip the loopback TCP
+ *  stack which matters for synchronous per-cycle round trips.
+ *
+ *  All rights reserved.
+ *  Tiny Labs Inc
+ *  2020
+ */
+#ifndef SOCKET_H
+#define SOCKET_H
+
+#define UNIX_PREFIX  "unix:"
+
+// Create listening socket
+int SocketListen (const char *endpoint, int backlog);
+
+// Connect to listening socket
+int SocketConnect (const char *endpoint);
+
+// Remove Unix socket path if any
+void SocketCleanup (const char *endpoint);
+
+#endif /* SOCKET_H */
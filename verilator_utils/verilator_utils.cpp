@@ -11,20 +11,26 @@
 VerilatorUtils::VerilatorUtils(uint32_t *mem)
   : mem(mem), t(0), timeout(0), fstDump(false), fstDumpStart(0), fstDumpStop(0),
     fstFileName((char *)FST_DEFAULT_NAME),
-    jtagServerEnable(false), jtagServerPort(2345),
-    jtagClientEnable(false), jtagClientPort(2345),
-    uartServerEnable(false), uartServerPort(7777),
-    gpioServerEnable(false), gpioServerPort(8888),
-    gpioClientEnable(false), gpioClientPort(8888)
+    jtagServerEnable(false), jtagServerEndpoint("2345"),
+    gdbServerEnable(false), gdbServerEndpoint("3333"),
+    dapServerEnable(false), dapServerEndpoint("5555"),
+    jtagClientEnable(false), jtagClientEndpoint("2345"),
+    uartServerEnable(false), uartServerEndpoint("7777"),
+    gpioServerEnable(false), gpioServerEndpoint("8888"),
+    gpioClientEnable(false), gpioClientEndpoint("8888"),
+    adiv5TargetEnable(false)
 {
   tfp = new VerilatedFstC;
 
   // Instantiate services
   jtag_server = new JTAGServer (8);
+  gdb_server = new GDBServer (8);
+  dap_server = new DAPServer (8);
   uart_server = new UARTServer (4);
   jtag_client = new JTAGClient (1);
   gpio_server = new GPIOServer (2);
   gpio_client = new GPIOClient (2);
+  adiv5_target = new ADIv5Target;
 
   // Enable tracing
   Verilated::traceEverOn(true);
@@ -39,6 +45,10 @@ VerilatorUtils::~VerilatorUtils() {
     // Stop remote servers/clients
     if (jtag_server)
         delete jtag_server;
+    if (gdb_server)
+        delete gdb_server;
+    if (dap_server)
+        delete dap_server;
     if (uart_server)
         delete uart_server;
     if (jtag_client)
@@ -47,6 +57,8 @@ VerilatorUtils::~VerilatorUtils() {
         delete gpio_client;
     if (gpio_server)
         delete gpio_server;
+    if (adiv5_target)
+        delete adiv5_target;
 }
 
 bool VerilatorUtils::doJTAGServer (uint8_t *tck, uint8_t tdo, uint8_t *tdi, uint8_t *tms, uint8_t *srst) {
@@ -58,6 +70,24 @@ bool VerilatorUtils::doJTAGServer (uint8_t *tck, uint8_t tdo, uint8_t *tdi, uint
   return true;
 }
 
+bool VerilatorUtils::doGDBServer (uint8_t *tck, uint8_t tdo, uint8_t *tdi, uint8_t *tms, uint8_t *srst) {
+  uint8_t dummy;
+  if (!srst)
+    srst = &dummy;
+  if (gdbServerEnable && ((t % gdb_server->period) == 0))
+    gdb_server->doJTAGServer (t, tck, tdo, tdi, tms, srst);
+  return true;
+}
+
+bool VerilatorUtils::doDAPServer (uint8_t *tck, uint8_t tdo, uint8_t *tdi, uint8_t *tms, uint8_t *srst) {
+  uint8_t dummy;
+  if (!srst)
+    srst = &dummy;
+  if (dapServerEnable && ((t % dap_server->period) == 0))
+    dap_server->doJTAGServer (t, tck, tdo, tdi, tms, srst);
+  return true;
+}
+
 bool VerilatorUtils::doUARTServer (uint8_t tx, uint8_t *rx)
 {
   if (uartServerEnable) // UART handles period calculations internally
@@ -67,7 +97,10 @@ bool VerilatorUtils::doUARTServer (uint8_t tx, uint8_t *rx)
 
 bool VerilatorUtils::doJTAGClient (uint8_t tck, uint8_t *tdo, uint8_t tdi, uint8_t *tms, uint8_t tmsoe)
 {
-  if (jtagClientEnable && ((t % jtag_client->period) == 0))
+  // Local model replaces remote target
+  if (adiv5TargetEnable)
+    adiv5_target->doJTAGClient (t, tck, tdo, tdi, tms, tmsoe);
+  else if (jtagClientEnable && ((t % jtag_client->period) == 0))
     jtag_client->doJTAGClient (t, tck, tdo, tdi, tms, tmsoe);
   return true;
 }
@@ -165,6 +198,8 @@ bool VerilatorUtils::loadBin(char *fileName) {
 #define OPT_TIMEOUT 512
 #define OPT_ELFLOAD 513
 #define OPT_BINLOAD 514
+#define OPT_GDBSWD  515
+#define OPT_ADIV5   516
 
 static struct argp_option options[] = {
   { 0, 0, 0, 0, "Simulation control:", 1 },
@@ -176,13 +211,17 @@ static struct argp_option options[] = {
   { "fststart", 's', "VAL", 0, "Delay FST generation until VAL" },
   { "fststop", 't', "VAL", 0, "Terminate FST generation at VAL" },
   { 0, 0, 0, 0, "Remote debugging:", 3 },
-  { "jtag-server", 'j', "PORT", OPTION_ARG_OPTIONAL, "Enable openocd JTAG server, opt. specify PORT" },
-  { "jtag-client", 'r', "PORT", OPTION_ARG_OPTIONAL, "Connect to remote JTAG server opt. specify PORT" },
+  { "jtag-server", 'j', "ADDR", OPTION_ARG_OPTIONAL, "Enable openocd JTAG server, opt. specify PORT or unix:PATH" },
+  { "jtag-client", 'r', "ADDR", OPTION_ARG_OPTIONAL, "Connect to remote JTAG server opt. specify PORT or unix:PATH" },
+  { "adiv5-model", OPT_ADIV5, "WAIT,FAULT", OPTION_ARG_OPTIONAL, "Use local ADIv5 target model instead of JTAG client, opt. WAIT/FAULT injection in percent" },
+  { "gdb-server", 'd', "ADDR", OPTION_ARG_OPTIONAL, "Enable GDB server driving JTAG pins, opt. specify PORT or unix:PATH" },
+  { "gdb-swd", OPT_GDBSWD, 0, 0, "GDB server uses SWD instead of JTAG" },
+  { "dap-server", 'a', "ADDR", OPTION_ARG_OPTIONAL, "Enable DAP transfer server, opt. specify PORT or unix:PATH" },
   { 0, 0, 0, 0, "Remote host communication:", 4 },  
-  { "uart-server", 'u', "PORT", OPTION_ARG_OPTIONAL, "Enable uart host server, opt. specify PORT" },
+  { "uart-server", 'u', "ADDR", OPTION_ARG_OPTIONAL, "Enable uart host server, opt. specify PORT or unix:PATH" },
   { 0, 0, 0, 0, "Remote GPIO link:", 5 },  
-  { "gpio-server", 'g', "PORT", OPTION_ARG_OPTIONAL, "Enable GPIO server opt. specify PORT" },
-  { "gpio-client", 'x', "PORT", OPTION_ARG_OPTIONAL, "Connect to remote GPIO server opt. specify PORT" },
+  { "gpio-server", 'g', "ADDR", OPTION_ARG_OPTIONAL, "Enable GPIO server opt. specify PORT or unix:PATH" },
+  { "gpio-client", 'x', "ADDR", OPTION_ARG_OPTIONAL, "Connect to remote GPIO server opt. specify PORT or unix:PATH" },
   { 0 },
 };
 
@@ -222,36 +261,64 @@ int VerilatorUtils::parseOpts(int key, char *arg, struct argp_state *state) {
   case 'j':
     utils->jtagServerEnable = true;
     if (arg)
-      utils->jtagServerPort = atoi(arg);
-    utils->jtag_server->Start (utils->jtagServerPort);
+      utils->jtagServerEndpoint = arg;
+    utils->jtag_server->Start (utils->jtagServerEndpoint);
+    break;
+
+  case 'd':
+    utils->gdbServerEnable = true;
+    if (arg)
+      utils->gdbServerEndpoint = arg;
+    utils->gdb_server->Start (utils->gdbServerEndpoint);
+    break;
+
+  case OPT_GDBSWD:
+    utils->gdb_server->swd = true;
+    break;
+
+  case 'a':
+    utils->dapServerEnable = true;
+    if (arg)
+      utils->dapServerEndpoint = arg;
+    utils->dap_server->Start (utils->dapServerEndpoint);
     break;
 
   case 'u':
     utils->uartServerEnable = true;
     if (arg)
-      utils->uartServerPort = atoi (arg);
-    utils->uart_server->Start (utils->uartServerPort);
+      utils->uartServerEndpoint = arg;
+    utils->uart_server->Start (utils->uartServerEndpoint);
     break;
 
   case 'r':
     utils->jtagClientEnable = true;
     if (arg)
-      utils->jtagClientPort = atoi (arg);
-    utils->jtag_client->Start (utils->jtagClientPort);
+      utils->jtagClientEndpoint = arg;
+    utils->jtag_client->Start (utils->jtagClientEndpoint);
+    break;
+    
+  case OPT_ADIV5:
+    utils->adiv5TargetEnable = true;
+    if (arg) {
+      char *end;
+      utils->adiv5_target->wait_pct = strtol(arg, &end, 10);
+      if (*end == ',')
+        utils->adiv5_target->fault_pct = strtol(end + 1, NULL, 10);
+    }
     break;
     
   case 'g':
     utils->gpioServerEnable = true;
     if (arg)
-      utils->gpioServerPort = atoi (arg);
-    utils->gpio_server->Start (utils->gpioServerPort);
+      utils->gpioServerEndpoint = arg;
+    utils->gpio_server->Start (utils->gpioServerEndpoint);
     break;
     
   case 'x':
     utils->gpioClientEnable = true;
     if (arg)
-      utils->gpioClientPort = atoi (arg);
-    utils->gpio_client->Start (utils->gpioClientPort);
+      utils->gpioClientEndpoint = arg;
+    utils->gpio_client->Start (utils->gpioClientEndpoint);
     break;
     
   default:
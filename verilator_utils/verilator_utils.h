@@ -5,10 +5,13 @@
 #include <verilated.h>
 #include <verilated_fst_c.h>
 #include "JTAGServer.h"
+#include "GDBServer.h"
+#include "DAPServer.h"
 #include "UARTServer.h"
 #include "JTAGClient.h"
 #include "GPIOServer.h"
 #include "GPIOClient.h"
+#include "ADIv5Target.h"
 
 extern struct argp verilator_utils_argp;
 
@@ -20,15 +23,20 @@ public:
   VerilatedFstC* tfp;
 
   JTAGServer *jtag_server = NULL;
+  GDBServer *gdb_server = NULL;
+  DAPServer *dap_server = NULL;
   UARTServer *uart_server = NULL;
   JTAGClient *jtag_client = NULL;
   GPIOClient *gpio_client = NULL;
   GPIOServer *gpio_server = NULL;
+  ADIv5Target *adiv5_target = NULL;
   
   bool doCycle();
   bool doGPIOServer (uint64_t *input, size_t input_cnt, uint64_t output, size_t output_cnt);
   bool doGPIOClient (uint64_t *input, size_t input_cnt, uint64_t output, size_t output_cnt);
   bool doJTAGServer (uint8_t *tck, uint8_t tdo, uint8_t *tdi, uint8_t *tms, uint8_t *srst=NULL);
+  bool doGDBServer (uint8_t *tck, uint8_t tdo, uint8_t *tdi, uint8_t *tms, uint8_t *srst=NULL);
+  bool doDAPServer (uint8_t *tck, uint8_t tdo, uint8_t *tdi, uint8_t *tms, uint8_t *srst=NULL);
   bool doUARTServer (uint8_t tx, uint8_t *rx);
   bool doJTAGClient (uint8_t tck, uint8_t *tdo, uint8_t tdi, uint8_t *tms, uint8_t tmsoe = true);
   uint64_t getTime() { return t; }
@@ -38,7 +46,8 @@ public:
   uint64_t getFstDumpStop() { return fstDumpStop; }
   char *getFstFileName() { return fstFileName; }
   bool getJtagEnable() { return jtagServerEnable; }
-  int getJtagPort() { return jtagServerPort; }
+  const char *getJtagEndpoint() { return jtagServerEndpoint; }
+  bool getADIv5Enable() { return adiv5TargetEnable; }
 
   static int parseOpts(int key, char *arg, struct argp_state *state);
 
@@ -53,15 +62,20 @@ private:
   bool fstDumping;
 
   bool jtagServerEnable;
-  int jtagServerPort;
+  const char *jtagServerEndpoint;
+  bool gdbServerEnable;
+  const char *gdbServerEndpoint;
+  bool dapServerEnable;
+  const char *dapServerEndpoint;
   bool uartServerEnable;
-  int uartServerPort;
+  const char *uartServerEndpoint;
   bool jtagClientEnable;
-  int jtagClientPort;
+  const char *jtagClientEndpoint;
   bool gpioServerEnable;
-  int gpioServerPort;
+  const char *gpioServerEndpoint;
   bool gpioClientEnable;
-  int gpioClientPort;
+  const char *gpioClientEndpoint;
+  bool adiv5TargetEnable;
   
   uint32_t *mem;
 